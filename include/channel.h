@@ -183,17 +183,18 @@ extern const char* const PartFmt2serv;
  * channels across the top.  This matrix holds all the information about
  * which users are on what channels, and what modes that user has on that
  * channel (if they are op'd, voice'd and cached information if they are
- * banned or not)
+ * banned or not).  Each channel holds an array of pointers to its
+ * members; each user has a linked list of its channels.
  */
 struct Membership {
   struct Client*     user;		/**< The user */
   struct Channel*    channel;		/**< The channel */
-  struct Membership* next_member;	/**< The next user on this channel */
-  struct Membership* prev_member;	/**< The previous user on this channel*/
   struct Membership* next_channel;	/**< Next channel this user is on */
   struct Membership* prev_channel;	/**< Previous channel this user is on*/
   unsigned int       status;		/**< Flags for op'd, voice'd, etc */
   unsigned short     oplevel;		/**< Op level */
+  unsigned int       local_index;	/**< Index in channel's locals array */
+  unsigned int       member_index;	/**< Index in channel's members array */
 };
 
 #define MAXOPLEVELDIGITS    3
@@ -263,6 +264,35 @@ struct Invite {
   char inviter[NICKLEN+USERLEN+HOSTLEN+3]; /**< hostmask of inviter */
 };
 
+/** Number of NAMES reply variants kept per channel: the full list
+ * and the visible-only list.
+ */
+#define NAMES_VARIANTS		2
+#define NAMES_VARIANT_VIS	0x01	/**< Only +i-less members listed */
+
+/** Pre-formatted RPL_NAMREPLY member lists for a channel.
+ *
+ * Each built variant is a run of NUL-terminated fragments, each of
+ * which fits in one reply.  The channel holds one reference; do_names()
+ * takes another while it sends, so the cache may be invalidated at any
+ * time.
+ */
+struct NamesCache {
+  unsigned int ref;			  /**< Reference count */
+  unsigned int count[NAMES_VARIANTS];	  /**< Fragments in each variant */
+  size_t size[NAMES_VARIANTS];		  /**< Bytes in each variant */
+  char *text[NAMES_VARIANTS];		  /**< Fragments, NULL if not built */
+};
+
+/** Count of the members of a channel behind one server link.
+ * Zombies are not counted.
+ */
+struct ChanLink {
+  struct Client*     link;		/**< Directly connected server */
+  unsigned int       members;		/**< Members reached through link */
+  unsigned int       deaf;		/**< How many of those are deaf */
+};
+
 /** Information about a channel */
 struct Channel {
   struct Channel*    next;	/**< next channel in the global channel list */
@@ -272,10 +302,21 @@ struct Channel {
   time_t             creationtime; /**< Creation time of this channel */
   time_t             topic_time;   /**< Modification time of the topic */
   unsigned int       users;	   /**< Number of clients on this channel */
-  struct Membership* members;	   /**< Pointer to the clients on this channel*/
+  struct Membership** members;	   /**< Clients on this channel */
+  unsigned int       nmembers;	   /**< Number of entries in members */
+  unsigned int       members_size; /**< Number of entries allocated */
+  struct Membership** locals;	   /**< Members that are local users */
+  unsigned int       nlocals;	   /**< Number of entries in locals */
+  unsigned int       locals_size;  /**< Number of entries allocated */
+  struct ChanLink*   links;	   /**< Member counts for each server link */
+  unsigned int       nlinks;	   /**< Number of entries in links */
+  unsigned int       links_size;   /**< Number of entries allocated */
   struct Invite*     invites;	   /**< List of invites on this channel */
   struct Ban*        banlist;      /**< List of bans on this channel */
   struct Mode        mode;	   /**< This channels mode */
+  struct NamesCache* names_cache;  /**< Cached NAMES replies, or NULL */
+  unsigned int       burst_mark;   /**< Set while a burst in progress has
+                                        not yet sent this channel */
   char               topic[TOPICLEN + 1]; /**< Channels topic */
   char               topic_nick[NICKLEN + 1]; /**< Nick of the person who set
 						*  The topic
@@ -419,6 +460,11 @@ extern int modebuf_flush(struct ModeBuf *mbuf);
 extern void modebuf_extract(struct ModeBuf *mbuf, char *buf);
 
 extern void mode_ban_invalidate(struct Channel *chan);
+extern struct NamesCache *names_cache_get(struct Channel *chan);
+extern void names_cache_release(struct NamesCache *cache);
+extern void names_cache_invalidate(struct Channel *chan);
+extern void channel_update_deaf(struct Client *cptr);
+extern void names_cache_invalidate_user(struct Client *cptr);
 extern void mode_invite_clear(struct Channel *chan);
 
 extern int mode_parse(struct ModeBuf *mbuf, struct Client *cptr,
@@ -443,6 +489,9 @@ extern void joinbuf_join(struct JoinBuf *jbuf, struct Channel *chan,
 extern int joinbuf_flush(struct JoinBuf *jbuf);
 extern struct Ban *make_ban(const char *banstr);
 extern struct Ban *find_ban(struct Client *cptr, struct Ban *banlist);
+extern struct BanSet *banset_create(struct Ban *banlist);
+extern void banset_free(struct BanSet *set);
+extern struct Ban *banset_find(struct BanSet *set, struct Client *cptr);
 extern int apply_ban(struct Ban **banlist, struct Ban *newban, int free);
 extern void free_ban(struct Ban *ban);
 
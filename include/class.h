@@ -99,6 +99,9 @@ extern void init_class(void);
 extern const struct ConnectionClass* get_class_list(void);
 extern void class_mark_delete(void);
 extern void class_delete_marked(void);
+extern void class_save_all(void);
+extern void class_forget_saved(void);
+extern void class_restore_all(void);
 
 extern struct ConnectionClass *do_find_class(const char *name, int extras);
 extern char *get_conf_class(const struct ConfItem *aconf);
@@ -194,7 +194,7 @@ struct Connection
   unsigned int        con_ping_freq; /**< cached ping freq */
   unsigned short      con_lastsq;    /**< # 2k blocks when sendqueued
                                         called last. */
-  unsigned char       con_targets[MAXTARGETS]; /**< Hash values of
+  unsigned int        con_targets[MAXTARGETS]; /**< Hash values of
 						  current targets. */
   char con_sock_ip[SOCKIPLEN + 1];   /**< Remote IP address as a string. */
   char con_sockhost[HOSTLEN + 1];    /**< This is the host name from
@@ -239,7 +239,7 @@ struct Client {
   short          cli_status;      /**< Client type */
   char cli_name[HOSTLEN + 1];     /**< Unique name of the client, nick or host */
   char cli_username[USERLEN + 1]; /**< Username determined by ident lookup */
-  char cli_info[REALLEN + 1];     /**< Free form additional client information */
+  const char* cli_info;           /**< Free form additional client information (interned) */
 };
 
 /** Magic constant to identify valid Client structures. */
@@ -265,6 +265,8 @@ struct Client {
 #define cli_serv(cli)		((cli)->cli_serv)
 /** Return true if client has uworld privileges. */
 #define cli_uworld(cli)         (cli_serv(cli) && (cli_serv(cli)->flags & SFLAG_UWORLD))
+/** Return non-zero if we are still sending our burst to the server. */
+#define cli_bursting(cli)       (cli_serv(cli) && (cli_serv(cli)->flags & SFLAG_BURSTING))
 /** Get Whowas link for client. */
 #define cli_whowas(cli)		((cli)->cli_whowas)
 /** Get client numnick. */
@@ -0,0 +1,74 @@
+/*
+ * IRC - Internet Relay Chat, include/conf_index.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+/** @file
+ * @brief Indexes of Client and Kill blocks by IP, host and realname.
+ */
+#ifndef INCLUDED_conf_index_h
+#define INCLUDED_conf_index_h
+#ifndef INCLUDED_ircd_defs_h
+#include "ircd_defs.h"          /* HOSTLEN */
+#endif
+
+struct irc_in_addr;
+struct ConfIndexNode;
+struct ConfIndexBucket;
+
+/** Entry in a configuration index (see struct ConfIndex). */
+struct ConfIndexEntry {
+  struct ConfIndexEntry *next; /**< Next entry in the same bucket. */
+  void                  *item; /**< Indexed ConfItem or DenyConf. */
+  unsigned int           seq;  /**< Position of the item in its list. */
+};
+
+/** Index of Client or Kill blocks, so that a client only has to be
+ * checked against blocks that could possibly apply to it.  Blocks with
+ * an IP mask are kept in a bit trie; blocks with a literal host name,
+ * a "*.domain" host mask or a literal realname are kept in a hash
+ * table; everything else is checked for every client.  Each entry
+ * remembers its position in its list, and lookups return entries in
+ * that order, so a first-match search gives the same answer as a scan
+ * of the list.
+ */
+struct ConfIndex {
+  int                      stale;   /**< Set when the list changes. */
+  struct ConfIndexEntry   *entries; /**< Array of all indexed items. */
+  struct ConfIndexNode    *root;    /**< Root of the IP mask trie. */
+  struct ConfIndexBucket **buckets; /**< Hash table of keyed items. */
+  unsigned int             bsize;   /**< Number of slots in #buckets. */
+  struct ConfIndexEntry   *generic; /**< Items that are always checked. */
+};
+
+/** Largest number of buckets a configuration index lookup returns:
+ * the generic list, one per trie level, up to two for the whole host
+ * name, one per other character of it, and one for the realname.
+ */
+#define CONF_INDEX_CANDIDATES (1 + 129 + HOSTLEN + 1 + 1)
+
+extern void conf_index_clear(struct ConfIndex *ci);
+extern void conf_index_init(struct ConfIndex *ci, unsigned int count);
+extern void conf_index_place(struct ConfIndex *ci, unsigned int seq,
+                             const struct irc_in_addr *addr, int bits,
+                             const char *host, const char *realname);
+extern int conf_index_lookup(struct ConfIndex *ci,
+                             const struct irc_in_addr *addr,
+                             const char *host, const char *realname,
+                             struct ConfIndexEntry **cand);
+extern struct ConfIndexEntry *conf_index_next(struct ConfIndexEntry **cand,
+                                              int ncand);
+
+#endif /* INCLUDED_conf_index_h */
@@ -0,0 +1,75 @@
+/* - Internet Relay Chat, include/eventlog.h
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 1, or (at your option)
+ *   any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+/** @file
+ * @brief Layout of the binary connection event log.
+ *
+ * This header is shared by the server and by tools/eventlog.c, so it
+ * must not depend on anything but the C library.  Fields are stored
+ * in the byte order of the server that wrote the file; the header
+ * records that order so a reader can tell whether it matches.
+ */
+#ifndef INCLUDED_eventlog_h
+#define INCLUDED_eventlog_h
+
+#ifndef INCLUDED_stdint_h
+#include <stdint.h>
+#define INCLUDED_stdint_h
+#endif
+
+/** Magic string at the start of every event log file. */
+#define EVENTLOG_MAGIC     "IRCEVLG1"
+/** Value of EventLogHeader::eh_byteorder as written by the server. */
+#define EVENTLOG_BYTEORDER 0x01020304
+
+/** Kinds of events recorded in the event log. */
+enum EventLogType {
+  EVENTLOG_CONNECT = 1, /**< Connection accepted by a listener. */
+  EVENTLOG_REGISTER,    /**< Local client finished registration. */
+  EVENTLOG_EXIT         /**< Local connection closed. */
+};
+
+/** Set in EventLogRecord::er_flags for registered users. */
+#define EVENTLOG_F_USER   0x01
+/** Set in EventLogRecord::er_flags for server links. */
+#define EVENTLOG_F_SERVER 0x02
+
+/** Header at the start of an event log file (128 bytes). */
+struct EventLogHeader {
+  char     eh_magic[8];      /**< EVENTLOG_MAGIC, not NUL terminated. */
+  uint32_t eh_byteorder;     /**< EVENTLOG_BYTEORDER in writer's order. */
+  uint32_t eh_recsize;       /**< sizeof(struct EventLogRecord). */
+  uint32_t eh_count;         /**< Number of records in the file. */
+  uint32_t eh_reserved;      /**< Unused; zero. */
+  uint64_t eh_created;       /**< Time the file was started. */
+  char     eh_server[96];    /**< Name of the server writing the file. */
+};
+
+/** One fixed-size event record (72 bytes). */
+struct EventLogRecord {
+  uint64_t      er_time;      /**< Time of the event. */
+  uint64_t      er_sendB;     /**< Bytes sent to the connection. */
+  uint64_t      er_receiveB;  /**< Bytes received from the connection. */
+  unsigned char er_ip[16];    /**< Remote address, IPv6 network order. */
+  uint32_t      er_duration;  /**< Seconds connected (exit events). */
+  uint16_t      er_port;      /**< Local port the connection came in on. */
+  uint8_t       er_type;      /**< One of enum EventLogType. */
+  uint8_t       er_flags;     /**< EVENTLOG_F_* flags. */
+  char          er_numeric[8];/**< Numeric nick, NUL terminated. */
+  char          er_class[16]; /**< Connection class, NUL terminated. */
+};
+
+#endif /* INCLUDED_eventlog_h */
@@ -76,4 +76,39 @@ extern void *DoRealloc(void *, size_t, const char*, int);
   dbg_realloc(p, size, file, line)
 #endif /* defined(MDEBUG) */
 
+/** Size (and alignment) of each slab used by a SlabCache. */
+#define SLAB_SIZE (2 * 1024 * 1024)
+/** Number of buckets in slab_occupancy()'s histogram. */
+#define SLAB_BUCKETS 6
+
+struct Slab;
+
+/** Cache of equally sized objects carved out of large slabs.
+ * Declare caches with SLAB_CACHE_INIT(); a cache is set up when its
+ * first slab is allocated.
+ */
+struct SlabCache {
+  const char *sc_name;          /**< Name of cache, for statistics. */
+  size_t sc_size;               /**< Size of each object. */
+  struct SlabCache *sc_next;    /**< Next cache in slab_cache_list(). */
+  unsigned int sc_per_slab;     /**< Number of objects in each slab. */
+  unsigned int sc_slabs;        /**< Number of slabs allocated. */
+  unsigned int sc_min_slabs;    /**< Slabs to keep even when empty. */
+  unsigned int sc_empty;        /**< Slabs with no objects in use. */
+  size_t sc_inuse;              /**< Number of objects in use. */
+  size_t sc_peak;               /**< Highest value of sc_inuse. */
+  struct Slab *sc_all;          /**< All slabs in the cache. */
+  struct Slab *sc_partial;      /**< Slabs with free objects. */
+};
+
+/** Static initializer for a SlabCache holding objects of \a type. */
+#define SLAB_CACHE_INIT(name, type) { (name), sizeof(type) }
+
+extern void slab_reserve(struct SlabCache *cache, size_t count);
+extern void *slab_alloc(struct SlabCache *cache);
+extern void slab_free(struct SlabCache *cache, void *obj);
+extern const struct SlabCache *slab_cache_list(void);
+extern void slab_occupancy(const struct SlabCache *cache,
+                           unsigned int hist[SLAB_BUCKETS]);
+
 #endif /* INCLUDED_ircd_alloc_h */
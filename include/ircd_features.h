@@ -40,6 +40,12 @@ extern struct Client his;
 #define feature_str(NAME) NAME
 #define feature_uint(NAME) NAME
 
+/** Incremented whenever a feature value changes.  Code that caches
+ * values computed from features compares this with the generation it
+ * last saw to know when to recompute them.
+ */
+extern unsigned int feature_generation;
+
 extern void feature_init(void);
 
 extern int feature_set(struct Client* from, const char* const* fields,
@@ -0,0 +1,43 @@
+/*
+ * IRC - Internet Relay Chat, include/ircd_intern.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+/** @file
+ * @brief Shared, reference-counted copies of common strings.
+ *
+ * Many users share the same host, username, account or real name.
+ * Interning keeps one copy of each distinct string, so equal
+ * interned strings are also equal pointers.  Interned strings must
+ * never be modified; use intern_set() to replace one.
+ */
+#ifndef INCLUDED_ircd_intern_h
+#define INCLUDED_ircd_intern_h
+#ifndef INCLUDED_sys_types_h
+#include <sys/types.h>          /* size_t */
+#define INCLUDED_sys_types_h
+#endif
+
+/** The interned empty string.  It is not reference counted, so it
+ * may be stored without calling intern_ref(). */
+extern const char intern_empty[];
+
+extern const char *intern_string(const char *str, size_t maxlen);
+extern const char *intern_ref(const char *str);
+extern void intern_release(const char *str);
+extern void intern_set(const char **field, const char *str, size_t maxlen);
+extern void intern_count_memory(size_t *count, size_t *refs, size_t *bytes);
+
+#endif /* INCLUDED_ircd_intern_h */
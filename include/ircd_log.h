@@ -29,6 +29,9 @@
 #include <stdlib.h> /* abort */
 #define INCLUDED_stdlib_h
 #endif
+#ifndef INCLUDED_eventlog_h
+#include "eventlog.h"
+#endif
 
 struct Client;
 
@@ -71,6 +74,11 @@ extern void log_debug_init(int usetty);
 extern void log_init(const char *process_name);
 extern void log_reopen(void);
 extern void log_close(void);
+extern void log_writer_start(void);
+extern void log_feature_buffer(void);
+extern void log_count_memory(struct Client *cptr);
+extern void log_event(enum EventLogType type, struct Client *cptr);
+extern void log_feature_eventlog(void);
 
 extern void log_write(enum LogSys subsys, enum LogLevel severity,
 		      unsigned int flags, const char *fmt, ...);
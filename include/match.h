@@ -26,6 +26,16 @@ int mmatch(const char *old_mask, const char *new_mask);
 extern int matchcomp(char *cmask, int *minlen, int *charset, const char *mask);
 extern int matchexec(const char *string, const char *cmask, int minlen);
 
+struct MaskSet;
+
+extern struct MaskSet *maskset_create(void);
+extern void maskset_free(struct MaskSet *set);
+extern unsigned int maskset_add(struct MaskSet *set, const char *mask);
+extern unsigned int maskset_count(const struct MaskSet *set);
+extern int maskset_first(struct MaskSet *set, const char *string);
+extern unsigned int maskset_all(struct MaskSet *set, const char *string,
+                                unsigned int *found, unsigned int max);
+
 extern int ipmask_check(const struct irc_in_addr *addr, const struct irc_in_addr *mask, unsigned char bits);
 
 #endif /* INCLUDED_match_h */
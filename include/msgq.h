@@ -81,6 +81,9 @@ extern void msgq_append(struct Client *dest, struct MsgBuf *mb,
 			const char *format, ...);
 extern void msgq_clean(struct MsgBuf *mb);
 extern void msgq_add(struct MsgQ *mq, struct MsgBuf *mb, int prio);
+extern void msgq_add_coalesced(struct MsgQ *mq, struct MsgBuf *mb, int prio);
+extern void msgq_compact(struct MsgQ *mq);
+extern int msgq_pressure(void);
 extern void msgq_count_memory(struct Client *cptr,
                               size_t *msg_alloc, size_t *msg_used);
 extern void msgq_histogram(struct Client *cptr, const struct StatDesc *sd,
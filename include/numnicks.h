@@ -39,6 +39,11 @@
 /** Maximum length of a full user numnick. */
 #define NUMNICKLEN 5            /* strlen("YYXXX") */
 
+/** Number of bits of a client numnick that select a slot in a page. */
+#define NN_PAGE_BITS 6
+/** Number of client slots in each page of a server's numnick table. */
+#define NN_PAGE_SIZE (1 << NN_PAGE_BITS)
+
 /*
  * Macros
  */
@@ -63,6 +68,19 @@
  */
 struct Client;
 
+/** A block of #NN_PAGE_SIZE consecutive client numnicks on one server.
+ * Pages are only allocated while they hold at least one client, and
+ * each server keeps the pages it has in Server::nn_live, so walking
+ * a server's clients costs time in proportion to how many it has
+ * rather than to its advertised capacity.
+ */
+struct NumNickPage {
+  struct NumNickPage*  next;    /**< Next page in Server::nn_live. */
+  struct NumNickPage** prev_p;  /**< Link that points to this page. */
+  unsigned int         count;   /**< Number of clients in slots[]. */
+  struct Client* slots[NN_PAGE_SIZE]; /**< Clients, by low bits of numnick. */
+};
+
 /*
  * Proto types
  */
@@ -72,6 +90,7 @@ extern void RemoveYXXClient(struct Client* server, const char* yxx);
 extern void SetServerYXX(struct Client* cptr, 
                          struct Client* server, const char* yxx);
 extern void ClearServerYXX(const struct Client* server);
+extern void FreeServerYXX(struct Client* server);
 
 extern void SetYXXCapacity(struct Client* myself, unsigned int max_clients);
 extern void SetYXXServerName(struct Client* myself, unsigned int numeric);
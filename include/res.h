@@ -112,6 +112,7 @@ extern void clear_nameservers(void);
 extern void add_nameserver(const char *ipaddr);
 extern void add_local_domain(char *hname, size_t size);
 extern size_t cres_mem(struct Client* cptr);
+extern void resolver_cache_resize(void);
 extern void delete_resolver_queries(const void *vptr);
 extern void report_dns_servers(struct Client *source_p, const struct StatDesc *sd, char *param);
 extern void gethost_byname(const char *name, dns_callback_f callback, void *ctx);
@@ -16,6 +16,7 @@
 struct Client;
 struct SLink;
 struct Message;
+struct ListenerFlags;
 
 /*
  * General defines
@@ -176,6 +177,7 @@ extern struct wline*    GlobalWebircList;
  */
 
 extern int init_conf(void);
+extern int conf_check(const char *client);
 
 extern const struct LocalConf* conf_get_local(void);
 extern const struct CRuleConf* conf_get_crule_list(void);
@@ -198,6 +200,7 @@ extern struct ConfItem* find_conf_exact(const char* name, struct Client *cptr, i
 extern enum AuthorizationCheckResult conf_check_client(struct Client *cptr);
 extern int  conf_check_server(struct Client *cptr);
 extern int rehash(struct Client *cptr, int sig);
+extern void report_rehash(struct Client *to);
 extern int find_kill(struct Client *cptr);
 extern const char *find_quarantine(const char* chname);
 extern const struct wline *find_webirc(const struct irc_in_addr *addr, const char *passwd);
@@ -206,6 +209,14 @@ extern void conf_parse_userhost(struct ConfItem *aconf, char *host);
 extern struct ConfItem *conf_debug_iline(const char *client);
 extern void free_mapping(struct s_map *smap);
 
+extern void conf_defer_jupe(const char *nicks);
+extern void conf_defer_nameserver(const char *server);
+extern void conf_defer_port(int port, const char *vhost, const char *mask,
+                            const struct ListenerFlags *flags);
+extern void conf_defer_motd(const char *hostmask, const char *path);
+extern void conf_defer_feature(int argc, const char * const *argv);
+extern void conf_defer_iauth(int argc, const char * const *argv, int workers);
+
 extern void yyerror(const char *msg);
 extern void yyserror(const char *fmt, ...);
 extern void yywarning(const char *fmt, ...);
@@ -65,6 +65,8 @@ struct ServerStatistics {
   unsigned int is_fake;         /**< MODE 'fakes' */
   unsigned int is_asuc;         /**< successful auth requests */
   unsigned int is_abad;         /**< bad auth requests */
+  unsigned int is_aqueue;       /**< auth requests that had to wait */
+  unsigned int is_askip;        /**< auth requests skipped (no identd) */
   unsigned int is_loc;          /**< local connections made */
   unsigned int uping_recv;      /**< UDP Pings received */
 };
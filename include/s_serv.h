@@ -10,6 +10,11 @@
 
 struct ConfItem;
 struct Client;
+struct Channel;
+
+/** Stop generating a server's burst while its sendq is at least this
+ * many bytes long. */
+#define BURST_SENDQ 65536
 
 extern unsigned int max_connection_count;
 extern unsigned int max_client_count;
@@ -21,6 +26,10 @@ extern int exit_new_server(struct Client* cptr, struct Client* sptr,
                            const char* host, time_t timestamp, const char* fmt, ...);
 extern int a_kills_b_too(struct Client *a, struct Client *b);
 extern int server_estab(struct Client *cptr, struct ConfItem *aconf);
+extern void burst_next_channels(struct Client *cptr);
+extern void burst_channel(struct Channel *chptr);
+extern void burst_forget_channel(struct Channel *chptr);
+extern void burst_abort(struct Client *cptr);
 
 
 #endif /* INCLUDED_s_serv_h */
@@ -25,6 +25,7 @@ extern struct SLink *opsarray[];
 extern void send_buffer(struct Client* to, struct MsgBuf* buf, int prio);
 
 extern void kill_highest_sendq(int servers_too);
+extern void compact_sendqs(void);
 extern void flush_connections(struct Client* cptr);
 extern void send_queued(struct Client *to);
 
@@ -37,13 +37,16 @@ struct User;
 struct Membership;
 struct Invite;
 struct SLink;
+struct NumNickPage;
+struct SilenceMatch;
 
 /** Describes a server on the network. */
 struct Server {
   struct Client*  up;           /**< Server one closer to me */
   struct DLink*   down;         /**< List with downlink servers */
   struct DLink*   updown;       /**< own Dlink in up->serv->down struct */
-  struct Client** client_list;  /**< List with client pointers on this server */
+  struct NumNickPage** nn_pages; /**< Pages of client pointers, by numnick */
+  struct NumNickPage* nn_live;  /**< Pages holding at least one client */
   struct User*    user;         /**< who activated this connection */
   time_t          timestamp;    /**< Remotely determined connect try time */
   time_t          ghost;        /**< Local time at which a new server
@@ -66,6 +69,7 @@ struct Server {
 
 #define SFLAG_UWORLD         0x0001  /**< Server has UWorld privileges */
 #define SFLAG_REMOTE_OPER    0x0002  /**< Server has remote (de-)opering privileges */
+#define SFLAG_BURSTING       0x0004  /**< Our burst to server is still being sent */
 
 /** Describes a user on the network. */
 struct User {
@@ -73,19 +77,22 @@ struct User {
   struct Membership* channel;        /**< chain of channel pointer blocks */
   struct Invite*     invited;        /**< chain of invite pointer blocks */
   struct Ban*        silence;        /**< chain of silence pointer blocks */
+  struct SilenceMatch* silence_match; /**< compiled silence list, or NULL */
   char*              away;           /**< pointer to away message */
   time_t             last;           /**< last time user sent a message */
   unsigned int       refcnt;         /**< Number of times this block is referenced */
   unsigned int       joined;         /**< number of channels joined */
+  unsigned int       mask_stamp;     /**< changes with nick, host or account */
   /** Remote account name.  Before registration is complete, this is
    * either empty or contains the username from the USER command.
    * After registration, that may be prefixed with ~ or it may be
-   * overwritten with the ident response.
+   * overwritten with the ident response.  This and the next three
+   * fields are interned strings (see ircd_intern.h).
    */
-  char               username[USERLEN + 1];
-  char               host[HOSTLEN + 1];       /**< displayed hostname */
-  char               realhost[HOSTLEN + 1];   /**< actual hostname */
-  char               account[ACCOUNTLEN + 1]; /**< IRC account name */
+  const char*        username;
+  const char*        host;           /**< displayed hostname */
+  const char*        realhost;       /**< actual hostname */
+  const char*        account;        /**< IRC account name */
   time_t	     acc_create;              /**< IRC account timestamp */
 };
 
@@ -0,0 +1,49 @@
+/*
+ * IRC - Internet Relay Chat, include/target.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+/** @file
+ * @brief Recent target lists and the target change rate limit.
+ *
+ * Each local user remembers the hashes of its MAXTARGETS most recent
+ * targets, most recent first.  The first RESERVEDTARGETS entries are
+ * targets the user chose; the rest also hold users who recently sent
+ * to it, so that it may answer them freely.  Sending to a target not
+ * in the list uses up a free target.  Free targets come back one per
+ * TARGET_DELAY seconds, up to MAXTARGETS; this is tracked as the time
+ * when the next target change is allowed.
+ */
+#ifndef INCLUDED_target_h
+#define INCLUDED_target_h
+#ifndef INCLUDED_sys_types_h
+#include <sys/types.h>          /* time_t */
+#define INCLUDED_sys_types_h
+#endif
+
+/** Results from target_use(). */
+enum TargetResult {
+  TARGET_OK,                    /**< A free target was used. */
+  TARGET_TOOFAST,               /**< No free target; tell the user. */
+  TARGET_TOOFAST_QUIET          /**< No free target; do not tell the user. */
+};
+
+extern unsigned int target_hash(const void *target);
+extern int target_find(unsigned int *targets, unsigned int hash);
+extern void target_push(unsigned int *targets, unsigned int hash);
+extern void target_add_reply(unsigned int *targets, unsigned int hash);
+extern enum TargetResult target_use(time_t *next_target, time_t now);
+
+#endif /* INCLUDED_target_h */
@@ -48,11 +48,11 @@ struct Client;
 struct Whowas {
   unsigned int hashv;           /**< Hash value for nickname. */
   char *name;                   /**< Client's old nickname. */
-  char *username;               /**< Client's username. */
-  char *hostname;               /**< Client's hostname. */
-  char *realhost;               /**< Client's real hostname. */
+  const char *username;         /**< Client's username (interned). */
+  const char *hostname;         /**< Client's hostname (interned). */
+  const char *realhost;         /**< Client's real hostname (interned). */
   char *servername;             /**< Name of client's server. */
-  char *realname;               /**< Client's realname (user info). */
+  const char *realname;         /**< Client's realname (interned). */
   char *away;                   /**< Client's away message. */
   time_t logoff;                /**< When the client logged off. */
   struct Client *online;        /**< Needed for get_history() (nick chasing). */
@@ -41,7 +41,7 @@
 /** Stores free target information for a particular user. */
 struct IPTargetEntry {
   unsigned int  count; /**< Number of free targets targets. */
-  unsigned char targets[MAXTARGETS]; /**< Array of recent targets. */
+  unsigned int  targets[MAXTARGETS]; /**< Array of recent targets. */
 };
 
 /** Stores recent information about a particular IP address. */
@@ -544,7 +544,8 @@ void ip_registry_connect_succeeded(struct Client *cptr)
 
   assert(entry);
   if (entry->target) {
-    memcpy(cli_targets(cptr), entry->target->targets, MAXTARGETS);
+    memcpy(cli_targets(cptr), entry->target->targets,
+           sizeof(entry->target->targets));
     free_targets = entry->target->count;
     tr = " tr";
   }
@@ -594,7 +595,8 @@ void ip_registry_disconnect(struct Client *cptr)
     }
     assert(0 != entry->target);
 
-    memcpy(entry->target->targets, cli_targets(cptr), MAXTARGETS);
+    memcpy(entry->target->targets, cli_targets(cptr),
+           sizeof(entry->target->targets));
     /*
      * This calculation can be pretty unfair towards large multi-user hosts, but
      * there is "nothing" we can do without also allowing spam bots to send more
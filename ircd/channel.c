@@ -46,12 +46,14 @@
 #include "s_conf.h"
 #include "s_debug.h"
 #include "s_misc.h"
+#include "s_serv.h"
 #include "s_user.h"
 #include "send.h"
 #include "struct.h"
 #include "whowas.h"
 
 /* #include <assert.h> -- Now using assert in ircd_log.h */
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -59,10 +61,9 @@
 /** Linked list containing the full list of all channels */
 struct Channel* GlobalChannelList = 0;
 
-/** Number of struct Membership*'s allocated */
-static unsigned int membershipAllocCount;
-/** Freelist for struct Membership*'s */
-static struct Membership* membershipFreeList;
+/** Slab cache for struct Membership*'s */
+static struct SlabCache membershipSlab =
+  SLAB_CACHE_INIT("Membership", struct Membership);
 /** Freelist for struct Ban*'s */
 static struct Ban* free_bans;
 /** Number of ban structures allocated. */
@@ -95,9 +96,9 @@ set_ban_mask(struct Ban *ban, const char *banstr)
 static int
 find_delayed_joins(const struct Channel *chan)
 {
-  const struct Membership *memb;
-  for (memb = chan->members; memb; memb = memb->next_member)
-    if (IsDelayedJoin(memb))
+  unsigned int ii;
+  for (ii = 0; ii < chan->nmembers; ++ii)
+    if (IsDelayedJoin(chan->members[ii]))
       return 1;
   return 0;
 }
@@ -117,6 +118,7 @@ void CheckDelayedJoins(struct Channel *chan)
 void RevealDelayedJoin(struct Membership *member)
 {
   ClearDelayedJoin(member);
+  names_cache_invalidate(member->channel);
   sendcmdto_channel(member->user, CMD_JOIN, member->channel,
                     member->user, SKIP_SERVERS,
                     ":%H", member->channel);
@@ -199,12 +201,12 @@ struct Membership* find_member_link(struct Channel* chptr, const struct Client*
    * at a time.
    */
   if (IsChannelService(cptr)) {
-    m = chptr->members;
-    while (m) {
+    unsigned int ii;
+    for (ii = 0; ii < chptr->nmembers; ++ii) {
+      m = chptr->members[ii];
       assert(m->channel == chptr);
       if (m->user == cptr)
         return m;
-      m = m->next_member;
     }
   }
   /* Users on the other hand aren't allowed on more than 15 channels.  50%
@@ -269,7 +271,7 @@ int sub1_from_channel(struct Channel* chptr)
 {
   if (chptr->users > 1)         /* Can be 0, called for an empty channel too */
   {
-    assert(0 != chptr->members);
+    assert(0 != chptr->nmembers);
     --chptr->users;
     return 1;
   }
@@ -334,7 +336,15 @@ int destruct_channel(struct Channel* chptr)
 {
   struct Ban *ban, *next;
 
-  assert(0 == chptr->members);
+  assert(0 == chptr->nmembers);
+  assert(0 == chptr->nlocals);
+  assert(0 == chptr->nlinks);
+
+  names_cache_invalidate(chptr);
+  burst_forget_channel(chptr);
+  MyFree(chptr->members);
+  MyFree(chptr->locals);
+  MyFree(chptr->links);
 
   /*
    * Now, find all invite links from channel structure
@@ -379,6 +389,28 @@ struct Membership* find_channel_member(struct Client* cptr, struct Channel* chpt
   return (member && !IsZombie(member)) ? member : 0;
 }
 
+/** Build the strings that bans are matched against for a user.
+ * @param[in] cptr The client to describe.
+ * @param[out] nu Receives nick!user (NICKLEN + USERLEN + 2 bytes).
+ * @param[out] iphost Receives the IP address (SOCKIPLEN + 1 bytes).
+ * @param[out] tmphost Buffer for the account host (HOSTLEN + 1 bytes).
+ * @return Alternate host to match against, or NULL if there is none.
+ */
+static const char *ban_strings(struct Client *cptr, char *nu, char *iphost,
+                               char *tmphost)
+{
+  ircd_snprintf(0, nu, NICKLEN + USERLEN + 2, "%s!%s",
+                cli_name(cptr), cli_user(cptr)->username);
+  ircd_ntoa_r(iphost, &cli_ip(cptr));
+  if (!IsAccount(cptr))
+    return NULL;
+  if (HasHiddenHost(cptr))
+    return cli_user(cptr)->realhost;
+  ircd_snprintf(0, tmphost, HOSTLEN, "%s.%s",
+                cli_user(cptr)->account, feature_str(FEAT_HIDDEN_HOST));
+  return tmphost;
+}
+
 /** Searches for a ban from a ban list that matches a user.
  * @param[in] cptr The client to test.
  * @param[in] banlist The list of bans to test.
@@ -390,23 +422,11 @@ struct Ban *find_ban(struct Client *cptr, struct Ban *banlist)
   char        tmphost[HOSTLEN + 1];
   char        iphost[SOCKIPLEN + 1];
   char       *hostmask;
-  char       *sr;
+  const char *sr;
   struct Ban *found;
 
   /* Build nick!user and alternate host names. */
-  ircd_snprintf(0, nu, sizeof(nu), "%s!%s",
-                cli_name(cptr), cli_user(cptr)->username);
-  ircd_ntoa_r(iphost, &cli_ip(cptr));
-  if (!IsAccount(cptr))
-    sr = NULL;
-  else if (HasHiddenHost(cptr))
-    sr = cli_user(cptr)->realhost;
-  else
-  {
-    ircd_snprintf(0, tmphost, HOSTLEN, "%s.%s",
-                  cli_user(cptr)->account, feature_str(FEAT_HIDDEN_HOST));
-    sr = tmphost;
-  }
+  sr = ban_strings(cptr, nu, iphost, tmphost);
 
   /* Walk through ban list. */
   for (found = NULL; banlist; banlist = banlist->next) {
@@ -437,6 +457,131 @@ struct Ban *find_ban(struct Client *cptr, struct Ban *banlist)
   return found;
 }
 
+/** A ban list compiled for checking many users against it.
+ * The host part of each ban goes into a mask set, so only bans whose
+ * host part matches one of the user's hosts have their nick!user part
+ * checked.  Bans are numbered in list order.
+ */
+struct BanSet {
+  struct MaskSet *hosts;        /**< Host part of each ban. */
+  struct Ban    **bans;         /**< Ban for each number. */
+  unsigned int   *found;        /**< Scratch space for maskset_all(). */
+  unsigned int   *ipmasks;      /**< Numbers of bans with BAN_IPMASK. */
+  unsigned int    n_ipmasks;    /**< Number of entries in ipmasks. */
+};
+
+/** Compile a ban list.
+ * The result must be freed with banset_free() before the list changes.
+ * @param[in] banlist List of bans to compile.
+ * @return Newly allocated ban set.
+ */
+struct BanSet *banset_create(struct Ban *banlist)
+{
+  struct BanSet *set;
+  struct Ban *ban;
+  unsigned int count = 1, num;
+
+  for (ban = banlist; ban; ban = ban->next)
+    count++;
+  set = (struct BanSet *) MyCalloc(1, sizeof(*set));
+  set->hosts = maskset_create();
+  set->bans = (struct Ban **) MyMalloc(count * sizeof(*set->bans));
+  set->found = (unsigned int *) MyMalloc(count * sizeof(*set->found));
+  set->ipmasks = (unsigned int *) MyMalloc(count * sizeof(*set->ipmasks));
+  for (ban = banlist; ban; ban = ban->next) {
+    /* find_ban() can never match a ban without a nick!user part. */
+    if (!ban->nu_len || ban->banstr[ban->nu_len] != '@')
+      continue;
+    num = maskset_add(set->hosts, ban->banstr + ban->nu_len + 1);
+    set->bans[num] = ban;
+    if (ban->flags & BAN_IPMASK)
+      set->ipmasks[set->n_ipmasks++] = num;
+  }
+  return set;
+}
+
+/** Free a compiled ban list.
+ * @param[in] set Ban set to free (may be NULL).
+ */
+void banset_free(struct BanSet *set)
+{
+  if (!set)
+    return;
+  maskset_free(set->hosts);
+  MyFree(set->bans);
+  MyFree(set->found);
+  MyFree(set->ipmasks);
+  MyFree(set);
+}
+
+/** Check the nick!user part of a ban whose host part matched.
+ * @param[in] set Ban set being searched.
+ * @param[in] num Number of the ban in \a set.
+ * @param[in] nu nick!user of the user being checked.
+ * @param[in,out] first Number of the first positive ban found so far.
+ * @return Non-zero if the ban is a matching exception, zero otherwise.
+ */
+static int banset_check(struct BanSet *set, unsigned int num,
+                        const char *nu, unsigned int *first)
+{
+  struct Ban *ban = set->bans[num];
+  int res;
+
+  /* A later positive ban cannot change the result. */
+  if (num >= *first && !(ban->flags & BAN_EXCEPTION))
+    return 0;
+  ban->banstr[ban->nu_len] = '\0';
+  res = match(ban->banstr, nu);
+  ban->banstr[ban->nu_len] = '@';
+  if (res)
+    return 0;
+  if (ban->flags & BAN_EXCEPTION)
+    return 1;
+  *first = num;
+  return 0;
+}
+
+/** Searches a compiled ban list for a ban that matches a user.
+ * This gives the same result as find_ban() on the list that \a set
+ * was compiled from.
+ * @param[in] set Compiled ban list to search.
+ * @param[in] cptr The client to test.
+ * @return Pointer to a matching ban, or NULL if none exist.
+ */
+struct Ban *banset_find(struct BanSet *set, struct Client *cptr)
+{
+  char        nu[NICKLEN + USERLEN + 2];
+  char        tmphost[HOSTLEN + 1];
+  char        iphost[SOCKIPLEN + 1];
+  const char *hosts[3];
+  unsigned int n_hosts, ih, ii, count, first = UINT_MAX;
+
+  if (!maskset_count(set->hosts))
+    return NULL;
+  hosts[2] = ban_strings(cptr, nu, iphost, tmphost);
+  hosts[0] = cli_user(cptr)->host;
+  hosts[1] = iphost;
+  n_hosts = hosts[2] ? 3 : 2;
+
+  /* Check every ban whose host part matches any of the user's hosts;
+   * any matching exception means no ban matches.
+   */
+  for (ih = 0; ih < n_hosts; ++ih) {
+    count = maskset_all(set->hosts, hosts[ih], set->found,
+                        maskset_count(set->hosts));
+    for (ii = 0; ii < count; ++ii)
+      if (banset_check(set, set->found[ii], nu, &first))
+        return NULL;
+  }
+  for (ii = 0; ii < set->n_ipmasks; ++ii) {
+    struct Ban *ban = set->bans[set->ipmasks[ii]];
+    if (ipmask_check(&cli_ip(cptr), &ban->address, ban->addrbits)
+        && banset_check(set, set->ipmasks[ii], nu, &first))
+      return NULL;
+  }
+  return (first == UINT_MAX) ? NULL : set->bans[first];
+}
+
 /**
  * This function returns true if the user is banned on the said channel.
  * This function will check the ban cache if applicable, otherwise will
@@ -460,6 +605,80 @@ static int is_banned(struct Membership* member)
   }
 }
 
+/** Find or create the member count for a server link on a channel.
+ * @param[in] chptr Channel to look in.
+ * @param[in] link Directly connected server.
+ * @return Member count for \a link.
+ */
+static struct ChanLink *channel_link(struct Channel *chptr,
+                                     struct Client *link)
+{
+  unsigned int ii;
+
+  for (ii = 0; ii < chptr->nlinks; ++ii)
+    if (chptr->links[ii].link == link)
+      return &chptr->links[ii];
+  if (chptr->nlinks == chptr->links_size) {
+    chptr->links_size = chptr->links_size ? chptr->links_size * 2 : 4;
+    chptr->links = MyRealloc(chptr->links,
+                             chptr->links_size * sizeof(*chptr->links));
+  }
+  chptr->links[ii].link = link;
+  chptr->links[ii].members = 0;
+  chptr->links[ii].deaf = 0;
+  chptr->nlinks++;
+  return &chptr->links[ii];
+}
+
+/** Start counting a member in its server link's member count.
+ * @param[in] member Non-zombie membership of a remote user.
+ */
+static void member_link_add(struct Membership *member)
+{
+  struct ChanLink *cl = channel_link(member->channel, cli_from(member->user));
+
+  cl->members++;
+  if (IsDeaf(member->user))
+    cl->deaf++;
+}
+
+/** Stop counting a member in its server link's member count.
+ * Links left with no members are removed.
+ * @param[in] member Non-zombie membership of a remote user.
+ */
+static void member_link_del(struct Membership *member)
+{
+  struct Channel *chptr = member->channel;
+  struct ChanLink *cl = channel_link(chptr, cli_from(member->user));
+
+  assert(cl->members > 0);
+  if (IsDeaf(member->user))
+    cl->deaf--;
+  if (!--cl->members)
+    *cl = chptr->links[--chptr->nlinks];
+}
+
+/** Update member counts after a remote user's deaf mode changes.
+ * @param[in] cptr Remote user whose deaf mode was just changed.
+ */
+void channel_update_deaf(struct Client *cptr)
+{
+  struct Membership *member;
+  struct ChanLink *cl;
+
+  assert(!MyConnect(cptr));
+  for (member = cli_user(cptr)->channel; member;
+       member = member->next_channel) {
+    if (IsZombie(member))
+      continue;
+    cl = channel_link(member->channel, cli_from(cptr));
+    if (IsDeaf(cptr))
+      cl->deaf++;
+    else
+      cl->deaf--;
+  }
+}
+
 /** add a user to a channel.
  * adds a user to a channel by adding another link to the channels member
  * chain.
@@ -477,13 +696,7 @@ void add_user_to_channel(struct Channel* chptr, struct Client* who,
 
   if (cli_user(who)) {
    
-    struct Membership* member = membershipFreeList;
-    if (member)
-      membershipFreeList = member->next_member;
-    else {
-      member = (struct Membership*) MyMalloc(sizeof(struct Membership));
-      ++membershipAllocCount;
-    }
+    struct Membership* member = slab_alloc(&membershipSlab);
 
     assert(0 != member);
     member->user         = who;
@@ -491,11 +704,13 @@ void add_user_to_channel(struct Channel* chptr, struct Client* who,
     member->status       = flags;
     SetOpLevel(member, oplevel);
 
-    member->next_member  = chptr->members;
-    if (member->next_member)
-      member->next_member->prev_member = member;
-    member->prev_member  = 0; 
-    chptr->members       = member;
+    if (chptr->nmembers == chptr->members_size) {
+      chptr->members_size = chptr->members_size ? chptr->members_size * 2 : 8;
+      chptr->members = MyRealloc(chptr->members,
+                                 chptr->members_size * sizeof(*chptr->members));
+    }
+    member->member_index = chptr->nmembers;
+    chptr->members[chptr->nmembers++] = member;
 
     member->next_channel = (cli_user(who))->channel;
     if (member->next_channel)
@@ -503,8 +718,20 @@ void add_user_to_channel(struct Channel* chptr, struct Client* who,
     member->prev_channel = 0;
     (cli_user(who))->channel = member;
 
+    if (MyConnect(who)) {
+      if (chptr->nlocals == chptr->locals_size) {
+        chptr->locals_size = chptr->locals_size ? chptr->locals_size * 2 : 8;
+        chptr->locals = MyRealloc(chptr->locals,
+                                  chptr->locals_size * sizeof(*chptr->locals));
+      }
+      member->local_index = chptr->nlocals;
+      chptr->locals[chptr->nlocals++] = member;
+    } else if (!IsZombie(member))
+      member_link_add(member);
+
     if (chptr->destruct_event)
       remove_destruct_event(chptr);
+    names_cache_invalidate(chptr);
     ++chptr->users;
     ++((cli_user(who))->joined);
   }
@@ -522,14 +749,12 @@ static int remove_member_from_channel(struct Membership* member)
   assert(0 != member);
   chptr = member->channel;
   /*
-   * unlink channel member list
+   * remove from the channel member array
    */
-  if (member->next_member)
-    member->next_member->prev_member = member->prev_member;
-  if (member->prev_member)
-    member->prev_member->next_member = member->next_member;
-  else
-    member->channel->members = member->next_member; 
+  assert(chptr->members[member->member_index] == member);
+  chptr->members[member->member_index] = chptr->members[--chptr->nmembers];
+  chptr->members[member->member_index]->member_index = member->member_index;
+  names_cache_invalidate(chptr);
 
   /*
    * If this is the last delayed-join user, may have to clear WASDELJOINS.
@@ -537,6 +762,16 @@ static int remove_member_from_channel(struct Membership* member)
   if (IsDelayedJoin(member))
     CheckDelayedJoins(chptr);
 
+  /*
+   * remove from the local member array or the link member counts
+   */
+  if (MyConnect(member->user)) {
+    assert(chptr->locals[member->local_index] == member);
+    chptr->locals[member->local_index] = chptr->locals[--chptr->nlocals];
+    chptr->locals[member->local_index]->local_index = member->local_index;
+  } else if (!IsZombie(member))
+    member_link_del(member);
+
   /*
    * unlink client channel list
    */
@@ -549,8 +784,7 @@ static int remove_member_from_channel(struct Membership* member)
 
   --(cli_user(member->user))->joined;
 
-  member->next_member = membershipFreeList;
-  membershipFreeList = member;
+  slab_free(&membershipSlab, member);
 
   return sub1_from_channel(chptr);
 }
@@ -562,13 +796,30 @@ static int remove_member_from_channel(struct Membership* member)
  */
 static int channel_all_zombies(struct Channel* chptr)
 {
-  struct Membership* member;
+  unsigned int ii;
 
-  for (member = chptr->members; member; member = member->next_member) {
-    if (!IsZombie(member))
+  /* Link member counts leave out zombies, so only locals need checking. */
+  for (ii = 0; ii < chptr->nlocals; ++ii)
+    if (!IsZombie(chptr->locals[ii]))
       return 0;
+  return chptr->nlinks == 0;
+}
+
+/** Remove a membership, and the whole channel if only zombies remain.
+ * @param member A member of a channel.
+ */
+static void remove_member_and_zombies(struct Membership* member)
+{
+  struct Channel* chptr = member->channel;
+
+  if (remove_member_from_channel(member) && channel_all_zombies(chptr)) {
+    /*
+     * XXX - this looks dangerous but isn't if we got the referential
+     * integrity right for channels
+     */
+    while (remove_member_from_channel(chptr->members[chptr->nmembers - 1]))
+      ;
   }
-  return 1;
 }
       
 
@@ -586,18 +837,8 @@ void remove_user_from_channel(struct Client* cptr, struct Channel* chptr)
   struct Membership* member;
   assert(0 != chptr);
 
-  if ((member = find_member_link(chptr, cptr))) {
-    if (remove_member_from_channel(member)) {
-      if (channel_all_zombies(chptr)) {
-        /*
-         * XXX - this looks dangerous but isn't if we got the referential
-         * integrity right for channels
-         */
-        while (remove_member_from_channel(chptr->members))
-          ;
-      }
-    }
-  }
+  if ((member = find_member_link(chptr, cptr)))
+    remove_member_and_zombies(member);
 }
 
 /** Remove a user from all channels they are on.
@@ -612,8 +853,9 @@ void remove_user_from_all_channels(struct Client* cptr)
   assert(0 != cptr);
   assert(0 != cli_user(cptr));
 
+  /* The membership is at hand, so there is no need to look it up. */
   while ((chan = (cli_user(cptr))->channel))
-    remove_user_from_channel(cptr, chan->channel);
+    remove_member_and_zombies(chan);
 }
 
 /** Check if this user is a legitimate chanop
@@ -872,33 +1114,92 @@ int compare_member_oplevel(const void *mp1, const void *mp2)
   return (member1->oplevel < member2->oplevel) ? -1 : 1;
 }
 
+/** Scratch space for send_channel_modes(), reused between channels. */
+static struct {
+  struct Membership** members; /**< Members grouped by voice and op. */
+  unsigned int        size;    /**< Number of entries allocated. */
+} BurstMembers;
+
+/** Output line for send_channel_modes(). */
+struct BurstLine {
+  char   buf[BUFSIZE];  /**< Text of the line, without CR LF. */
+  size_t len;           /**< Length of text in buf. */
+  size_t prefix;        /**< Length of the "<Y> B <channel> <TS>" prefix. */
+};
+
+/** Maximum length of a BURST line, not counting the trailing CR LF. */
+#define BURST_LINE_MAX (BUFSIZE - 2)
+
+/** Append a string to a BURST line.
+ * @param[in,out] bl Line to append to.
+ * @param[in] str NUL-terminated string to append.
+ */
+static void burst_line_puts(struct BurstLine *bl, const char *str)
+{
+  while (*str)
+    bl->buf[bl->len++] = *str++;
+}
+
+/** Append a decimal number to a BURST line.
+ * @param[in,out] bl Line to append to.
+ * @param[in] val Number to append.
+ */
+static void burst_line_putu(struct BurstLine *bl, unsigned int val)
+{
+  char tmp[12];
+  int ii = 0;
+
+  do
+    tmp[ii++] = '0' + val % 10;
+  while ((val /= 10));
+  while (ii)
+    bl->buf[bl->len++] = tmp[--ii];
+}
+
+/** Send a BURST line and reset it to just its prefix.
+ * @param[in] cptr Server to send to.
+ * @param[in,out] bl Line to send.
+ */
+static void burst_line_send(struct Client *cptr, struct BurstLine *bl)
+{
+  struct MsgBuf *mb;
+
+  bl->buf[bl->len] = '\0';
+  mb = msgq_make(&me, "%s", bl->buf);
+  send_buffer(cptr, mb, 0);
+  msgq_clean(mb);
+  bl->len = bl->prefix;
+}
+
 /* send "cptr" a full list of the modes for channel chptr.
  *
  * Sends a BURST line to cptr, bursting all the modes for the channel.
  *
+ * Members are sent in four groups: plain, voiced, opped and opped
+ * with voice, the opped groups in increasing op-level so that all
+ * op-level increments stay positive.  Each group starts with its
+ * ":mode", as does every group continued on a new line.
+ *
  * @param cptr	Client pointer
  * @param chptr	Channel pointer
  */
 void send_channel_modes(struct Client *cptr, struct Channel *chptr)
 {
-  /* The order in which modes are generated is now mandatory */
-  static unsigned int current_flags[4] =
-      { 0, CHFL_VOICE, CHFL_CHANOP, CHFL_CHANOP | CHFL_VOICE };
-  int                first = 1;
-  int                full  = 1;
-  int                flag_cnt = 0;
-  int                new_mode = 0;
-  size_t             len;
+  struct BurstLine   bl;
   struct Membership* member;
-  struct Ban*        lp2;
+  struct Membership** group;
+  struct Ban*        ban;
   char modebuf[MODEBUFLEN];
   char parabuf[MODEBUFLEN];
-  struct MsgBuf *mb;
-  int                 number_of_ops = 0;
-  int                 opped_members_index = 0;
-  struct Membership** opped_members = NULL;
-  int                 last_oplevel = 0;
-  int                 send_oplevels = 0;
+  unsigned int       count[4] = { 0, 0, 0, 0 };
+  unsigned int       start[4];
+  unsigned int       fill[4];
+  unsigned int       flag_cnt, ii, pos;
+  int                sorted[4] = { 1, 1, 1, 1 };
+  int                send_oplevels = 0;
+  int                new_mode;
+  int                last_oplevel = 0;
+  size_t             len;
 
   assert(0 != cptr);
   assert(0 != chptr); 
@@ -906,180 +1207,120 @@ void send_channel_modes(struct Client *cptr, struct Channel *chptr)
   if (IsLocalChannel(chptr->chname))
     return;
 
-  member = chptr->members;
-  lp2 = chptr->banlist;
-
+  /* The order in which modes are generated is now mandatory.
+   * Sort the members into their groups: count them first, then
+   * place each one after the members of the groups before it. */
+  for (ii = 0; ii < chptr->nmembers; ++ii) {
+    member = chptr->members[ii];
+    if (IsChanOp(member) && OpLevel(member) < MAXOPLEVEL)
+      send_oplevels = 1; /* someone is below the weakest level */
+    ++count[(IsChanOp(member) ? 2 : 0) + (HasVoice(member) ? 1 : 0)];
+  }
+  if (BurstMembers.size < chptr->users) {
+    MyFree(BurstMembers.members);
+    BurstMembers.size = chptr->users + 64;
+    BurstMembers.members = (struct Membership**)
+      MyMalloc(BurstMembers.size * sizeof(struct Membership*));
+  }
+  group = BurstMembers.members;
+  for (ii = pos = 0; ii < 4; pos += count[ii++])
+    start[ii] = fill[ii] = pos;
+  for (ii = 0; ii < chptr->nmembers; ++ii) {
+    member = chptr->members[ii];
+    flag_cnt = (IsChanOp(member) ? 2 : 0) + (HasVoice(member) ? 1 : 0);
+    pos = fill[flag_cnt]++;
+    group[pos] = member;
+    /* Note whether the ops come out in op-level order already,
+     * as they almost always do. */
+    if (flag_cnt > 1 && pos > start[flag_cnt]
+        && OpLevel(group[pos - 1]) > OpLevel(member))
+      sorted[flag_cnt] = 0;
+  }
+  if (send_oplevels)
+    for (ii = 2; ii < 4; ++ii)
+      if (!sorted[ii])
+        qsort(group + start[ii], count[ii], sizeof(struct Membership*),
+              compare_member_oplevel);
+
+  /* prefix: "<Y> B <channel> <TS>" */
+  bl.len = bl.prefix = ircd_snprintf(0, bl.buf, sizeof(bl.buf),
+                                     "%s " TOK_BURST " %s %Tu", NumServ(&me),
+                                     chptr->chname, chptr->creationtime);
+
+  /* Add simple modes (Aiklmnpstu) to the first line */
   *modebuf = *parabuf = '\0';
   channel_modes(cptr, modebuf, parabuf, sizeof(parabuf), chptr, 0);
-
-  for (first = 1; full; first = 0)      /* Loop for multiple messages */
-  {
-    full = 0;                   /* Assume by default we get it
-                                 all in one message */
-
-    /* (Continued) prefix: "<Y> B <channel> <TS>" */
-    /* is there any better way we can do this? */
-    mb = msgq_make(&me, "%C " TOK_BURST " %H %Tu", &me, chptr,
-		   chptr->creationtime);
-
-    if (first && modebuf[1])    /* Add simple modes (Aiklmnpstu)
-                                 if first message */
-    {
-      /* prefix: "<Y> B <channel> <TS>[ <modes>[ <params>]]" */
-      msgq_append(&me, mb, " %s", modebuf);
-
-      if (*parabuf)
-	msgq_append(&me, mb, " %s", parabuf);
+  if (modebuf[1]) {
+    bl.buf[bl.len++] = ' ';
+    burst_line_puts(&bl, modebuf);
+    if (*parabuf) {
+      bl.buf[bl.len++] = ' ';
+      burst_line_puts(&bl, parabuf);
     }
+  }
 
-    /*
-     * Attach nicks, comma separated " nick[:modes],nick[:modes],..."
-     *
-     * First find all opless members.
-     * Run 2 times over all members, to group the members with
-     * and without voice together.
-     * Then run 2 times over all opped members (which are ordered
-     * by op-level) to also group voice and non-voice together.
-     */
-    for (first = 1; flag_cnt < 4; new_mode = 1, ++flag_cnt)
-    {
-      while (member)
-      {
-	if (flag_cnt < 2 && IsChanOp(member))
-	{
-	  /*
-	   * The first loop (to find all non-voice/op), we count the ops.
-	   * The second loop (to find all voiced non-ops), store the ops
-	   * in a dynamic array.
-	   */
-	  if (flag_cnt == 0)
-	    ++number_of_ops;
-	  else
-	    opped_members[opped_members_index++] = member;
-          /* We also send oplevels if anyone is below the weakest level.  */
-          if (OpLevel(member) < MAXOPLEVEL)
-            send_oplevels = 1;
-	}
-	/* Only handle the members with the flags that we are interested in. */
-        if ((member->status & CHFL_VOICED_OR_OPPED) == current_flags[flag_cnt])
-	{
-	  if (msgq_bufleft(mb) < NUMNICKLEN + 3 + MAXOPLEVELDIGITS)
-	    /* The 3 + MAXOPLEVELDIGITS is a possible ",:v999". */
-	  {
-	    full = 1;           /* Make sure we continue after
-				   sending it so far */
-	    /* Ensure the new BURST line contains the current
-	     * ":mode", except when there is no mode yet. */
-	    new_mode = (flag_cnt > 0) ? 1 : 0;
-	    break;              /* Do not add this member to this message */
-	  }
-	  msgq_append(&me, mb, "%c%C", first ? ' ' : ',', member->user);
-	  first = 0;              /* From now on, use commas to add new nicks */
-
-	  /*
-	   * Do we have a nick with a new mode ?
-	   * Or are we starting a new BURST line?
-	   */
-	  if (new_mode)
-	  {
-	    /*
-	     * This means we are at the _first_ member that has only
-	     * voice, or the first member that has only ops, or the
-	     * first member that has voice and ops (so we get here
-	     * at most three times, plus once for every start of
-	     * a continued BURST line where only these modes is current.
-	     * In the two cases where the current mode includes ops,
-	     * we need to add the _absolute_ value of the oplevel to the mode.
-	     */
-	    char tbuf[3 + MAXOPLEVELDIGITS] = ":";
-	    int loc = 1;
-
-	    if (HasVoice(member))	/* flag_cnt == 1 or 3 */
-	      tbuf[loc++] = 'v';
-	    if (IsChanOp(member))	/* flag_cnt == 2 or 3 */
-	    {
-              /* append the absolute value of the oplevel */
-              if (send_oplevels)
-                loc += ircd_snprintf(0, tbuf + loc, sizeof(tbuf) - loc, "%u", last_oplevel = member->oplevel);
-              else
-                tbuf[loc++] = 'o';
-	    }
-	    tbuf[loc] = '\0';
-	    msgq_append(&me, mb, tbuf);
-	    new_mode = 0;
-	  }
-	  else if (send_oplevels && flag_cnt > 1 && last_oplevel != member->oplevel)
-	  {
-	    /*
-	     * This can't be the first member of a (continued) BURST
-	     * message because then either flag_cnt == 0 or new_mode == 1
-	     * Now we need to append the incremental value of the oplevel.
-	     */
-            char tbuf[2 + MAXOPLEVELDIGITS];
-	    ircd_snprintf(0, tbuf, sizeof(tbuf), ":%u", member->oplevel - last_oplevel);
-	    last_oplevel = member->oplevel;
-	    msgq_append(&me, mb, tbuf);
-	  }
-	}
-	/* Go to the next `member'. */
-	if (flag_cnt < 2)
-	  member = member->next_member;
-	else
-	  member = opped_members[++opped_members_index];
-      }
-      if (full)
-	break;
+  /* Attach nicks, comma separated " nick[:modes],nick[:modes],..." */
+  pos = bl.len;
+  for (flag_cnt = 0; flag_cnt < 4; ++flag_cnt) {
+    new_mode = flag_cnt > 0;
+    for (ii = 0; ii < count[flag_cnt]; ++ii) {
+      member = group[start[flag_cnt] + ii];
 
-      /* Point `member' at the start of the list again. */
-      if (flag_cnt == 0)
-      {
-	member = chptr->members;
-	/* Now, after one loop, we know the number of ops and can
-	 * allocate the dynamic array with pointer to the ops. */
-	opped_members = (struct Membership**)
-	  MyMalloc((number_of_ops + 1) * sizeof(struct Membership*));
-	opped_members[number_of_ops] = NULL;	/* Needed for loop termination */
-      }
-      else
-      {
-	/* At the end of the second loop, sort the opped members with
-	 * increasing op-level, so that we will output them in the
-	 * correct order (and all op-level increments stay positive) */
-	if (flag_cnt == 1)
-	  qsort(opped_members, number_of_ops,
-	        sizeof(struct Membership*), compare_member_oplevel);
-	/* The third and fourth loop run only over the opped members. */
-	member = opped_members[(opped_members_index = 0)];
+      /* Room for ",YYXXX:v999"? */
+      if (bl.len + 1 + NUMNICKLEN + 2 + MAXOPLEVELDIGITS > BURST_LINE_MAX) {
+        burst_line_send(cptr, &bl);
+        pos = bl.len;
+        /* Repeat the current ":mode" on the new line. */
+        new_mode = flag_cnt > 0;
       }
-
-    } /* loop over 0,+v,+o,+ov */
-
-    if (!full)
-    {
-      /* Attach all bans, space separated " :%ban ban ..." */
-      for (first = 2; lp2; lp2 = lp2->next)
-      {
-        len = strlen(lp2->banstr);
-	if (msgq_bufleft(mb) < len + 1 + first)
-          /* The +1 stands for the added ' '.
-           * The +first stands for the added ":%".
-           */
-        {
-          full = 1;
-          break;
+      bl.buf[bl.len] = (bl.len == pos) ? ' ' : ',';
+      bl.len++;
+      burst_line_puts(&bl, cli_yxx(cli_user(member->user)->server));
+      burst_line_puts(&bl, cli_yxx(member->user));
+
+      if (new_mode) {
+        /* The first member of a group on this line carries the mode,
+         * with the absolute op-level for opped members. */
+        bl.buf[bl.len++] = ':';
+        if (HasVoice(member))
+          bl.buf[bl.len++] = 'v';
+        if (IsChanOp(member)) {
+          if (send_oplevels)
+            burst_line_putu(&bl, last_oplevel = OpLevel(member));
+          else
+            bl.buf[bl.len++] = 'o';
         }
-	msgq_append(&me, mb, " %s%s", first ? ":%" : "",
-		    lp2->banstr);
-	first = 0;
+        new_mode = 0;
+      } else if (send_oplevels && flag_cnt > 1
+                 && last_oplevel != OpLevel(member)) {
+        /* Later members only carry an op-level increment. */
+        bl.buf[bl.len++] = ':';
+        burst_line_putu(&bl, OpLevel(member) - last_oplevel);
+        last_oplevel = OpLevel(member);
       }
     }
+  }
+
+  /* Attach all bans, space separated " :%ban ban ..." */
+  for (ban = chptr->banlist, pos = 1; ban; ban = ban->next) {
+    len = strlen(ban->banstr);
+    /* The +1 stands for the added ' ', the +2 for the added ":%". */
+    if (bl.len + 1 + (pos ? 2 : 0) + len > BURST_LINE_MAX) {
+      burst_line_send(cptr, &bl);
+      pos = 1;
+    }
+    bl.buf[bl.len++] = ' ';
+    if (pos) {
+      bl.buf[bl.len++] = ':';
+      bl.buf[bl.len++] = '%';
+      pos = 0;
+    }
+    memcpy(bl.buf + bl.len, ban->banstr, len);
+    bl.len += len;
+  }
+
+  burst_line_send(cptr, &bl);
 
-    send_buffer(cptr, mb, 0);  /* Send this message */
-    msgq_clean(mb);
-  }                             /* Continue when there was something
-                                 that didn't fit (full==1) */
-  if (opped_members)
-    MyFree(opped_members);
   if (feature_bool(FEAT_TOPIC_BURST) && (chptr->topic[0] != '\0'))
       sendcmdto_one(&me, CMD_TOPIC, cptr, "%H %Tu %Tu :%s", chptr,
                     chptr->creationtime, chptr->topic_time, chptr->topic);
@@ -1439,13 +1680,18 @@ void make_zombie(struct Membership* member, struct Client* who,
   assert(0 != chptr);
 
   /* Default for case a): */
+  if (!IsZombie(member) && !MyConnect(who))
+    member_link_del(member);
   SetZombie(member);
+  names_cache_invalidate(chptr);
 
   /* Case b) or c) ?: */
   if (MyUser(who))      /* server 4 */
   {
-    if (IsServer(cptr)) /* Case b) ? */
+    if (IsServer(cptr)) { /* Case b) ? */
+      burst_channel(chptr);
       sendcmdto_one(who, CMD_PART, cptr, "%H", chptr);
+    }
     remove_user_from_channel(who, chptr);
     return;
   }
@@ -1477,12 +1723,12 @@ void make_zombie(struct Membership* member, struct Client* who,
  */
 int number_of_zombies(struct Channel *chptr)
 {
-  struct Membership* member;
+  unsigned int       ii;
   int                count = 0;
 
   assert(0 != chptr);
-  for (member = chptr->members; member; member = member->next_member) {
-    if (IsZombie(member))
+  for (ii = 0; ii < chptr->nmembers; ++ii) {
+    if (IsZombie(chptr->members[ii]))
       ++count;
   }
   return count;
@@ -1941,6 +2187,7 @@ modebuf_init(struct ModeBuf *mbuf, struct Client *source,
   assert(0 != dest);
 
   if (IsLocalChannel(chan->chname)) dest &= ~MODEBUF_DEST_SERVER;
+  else burst_channel(chan);
 
   mbuf->mb_add = 0;
   mbuf->mb_rem = 0;
@@ -2173,10 +2420,11 @@ modebuf_extract(struct ModeBuf *mbuf, char *buf)
 void
 mode_ban_invalidate(struct Channel *chan)
 {
-  struct Membership *member;
+  unsigned int ii;
 
-  for (member = chan->members; member; member = member->next_member)
-    ClearBanValid(member);
+  /* Only local members' ban status is ever cached. */
+  for (ii = 0; ii < chan->nlocals; ++ii)
+    ClearBanValid(chan->locals[ii]);
 }
 
 /** Simple function to drop invite structures
@@ -2193,6 +2441,65 @@ mode_invite_clear(struct Channel *chan)
     del_invite(chan->invites->user, chan);
 }
 
+/** Get the NAMES reply cache for a channel, creating it if needed.
+ * The returned cache is owned by the channel; callers that keep it
+ * across anything that may change the channel must take their own
+ * reference.
+ * @param[in] chan Channel whose cache to return.
+ * @return The channel's NAMES cache.
+ */
+struct NamesCache *
+names_cache_get(struct Channel *chan)
+{
+  if (!chan->names_cache) {
+    chan->names_cache = (struct NamesCache *) MyCalloc(1, sizeof(struct NamesCache));
+    chan->names_cache->ref = 1;
+  }
+  return chan->names_cache;
+}
+
+/** Drop a reference to a NAMES reply cache, freeing it if unused.
+ * @param[in] cache Cache to release.
+ */
+void
+names_cache_release(struct NamesCache *cache)
+{
+  int i;
+
+  assert(0 < cache->ref);
+  if (--cache->ref)
+    return;
+  for (i = 0; i < NAMES_VARIANTS; i++)
+    MyFree(cache->text[i]);
+  MyFree(cache);
+}
+
+/** Throw away the cached NAMES replies for a channel.
+ * Must be called whenever the membership of \a chan changes, or when
+ * a member's nick, host, visibility or channel status changes.
+ * @param[in] chan Channel whose cache is stale.
+ */
+void
+names_cache_invalidate(struct Channel *chan)
+{
+  if (chan->names_cache) {
+    names_cache_release(chan->names_cache);
+    chan->names_cache = NULL;
+  }
+}
+
+/** Throw away the cached NAMES replies for every channel a user is on.
+ * @param[in] cptr User whose nick or visibility changed.
+ */
+void
+names_cache_invalidate_user(struct Client *cptr)
+{
+  struct Membership *member;
+
+  for (member = cli_user(cptr)->channel; member; member = member->next_channel)
+    names_cache_invalidate(member->channel);
+}
+
 /* What we've done for mode_parse so far... */
 #define DONE_LIMIT	0x01	/**< We've set the limit */
 #define DONE_KEY_ADD	0x02	/**< We've set the key */
@@ -2566,7 +2873,7 @@ mode_parse_upass(struct ParseState *state, int *flag_p)
 static void
 mode_parse_apass(struct ParseState *state, int *flag_p)
 {
-  struct Membership *memb;
+  unsigned int ii;
   char *t_str;
 
   if (MyUser(state->sptr) && state->max_args <= 0) /* drop if too many args */
@@ -2705,9 +3012,9 @@ mode_parse_apass(struct ParseState *state, int *flag_p)
       if (MyUser(state->sptr))
         send_reply(state->sptr, RPL_APASSWARN_CLEAR);
       /* Revert everyone to MAXOPLEVEL. */
-      for (memb = state->chptr->members; memb; memb = memb->next_member) {
-        if (memb->status & MODE_CHANOP)
-          SetOpLevel(memb, MAXOPLEVEL);
+      for (ii = 0; ii < state->chptr->nmembers; ++ii) {
+        if (state->chptr->members[ii]->status & MODE_CHANOP)
+          SetOpLevel(state->chptr->members[ii], MAXOPLEVEL);
       }
     }
   }
@@ -3161,6 +3468,7 @@ mode_process_clients(struct ParseState *state)
       } else
 	member->status &= ~(state->cli_change[i].flag &
 			    (MODE_CHANOP | MODE_VOICE));
+      names_cache_invalidate(state->chptr);
     }
 
     /* accumulate the change */
@@ -3504,6 +3812,8 @@ joinbuf_join(struct JoinBuf *jbuf, struct Channel *chan, unsigned int flags)
   }
 
   is_local = IsLocalChannel(chan->chname);
+  if (!is_local)
+    burst_channel(chan);
 
   if (jbuf->jb_type == JOINBUF_TYPE_PART ||
       jbuf->jb_type == JOINBUF_TYPE_PARTALL) {
@@ -147,6 +147,76 @@ void class_delete_marked(void)
   }
 }
 
+/** Settings of a connection class from before a configuration reload. */
+struct ClassBackup {
+  struct ClassBackup     *next;  /**< Next saved class. */
+  struct ConnectionClass *cl;    /**< Class the settings belong to. */
+  struct ConnectionClass  saved; /**< Copy of the settings. */
+};
+
+/** Saved classes, while a new configuration is being read. */
+static struct ClassBackup *classBackups;
+
+/** Remember the settings of all connection classes.
+ * A configuration reload that fails can then put them back with
+ * class_restore_all().
+ */
+void class_save_all(void)
+{
+  struct ConnectionClass *p;
+  struct ClassBackup *b;
+
+  assert(0 != connClassList);
+  assert(0 == classBackups);
+
+  for (p = connClassList->next; p; p = p->next) {
+    b = (struct ClassBackup*) MyMalloc(sizeof(*b));
+    b->cl = p;
+    b->saved = *p;
+    DupString(b->saved.cc_name, ConClass(p));
+    if (CCUmode(p))
+      DupString(b->saved.default_umode, CCUmode(p));
+    b->next = classBackups;
+    classBackups = b;
+  }
+}
+
+/** Forget the settings saved by class_save_all(). */
+void class_forget_saved(void)
+{
+  struct ClassBackup *b;
+
+  while ((b = classBackups)) {
+    classBackups = b->next;
+    MyFree(b->saved.cc_name);
+    MyFree(b->saved.default_umode);
+    MyFree(b);
+  }
+}
+
+/** Restore the settings saved by class_save_all().
+ * Classes created since then are deleted.
+ */
+void class_restore_all(void)
+{
+  struct ConnectionClass *p;
+  struct ClassBackup *b;
+
+  class_mark_delete();
+  for (b = classBackups; b; b = b->next) {
+    p = b->cl;
+    MyFree(ConClass(p));
+    MyFree(CCUmode(p));
+    b->saved.next = p->next;
+    b->saved.ref_count = p->ref_count;
+    *p = b->saved;
+    b->saved.cc_name = NULL;
+    b->saved.default_umode = NULL;
+  }
+  class_forget_saved();
+  class_delete_marked();
+}
+
 /** Get connection class name for a configuration item.
  * @param[in] aconf Configuration item to check.
  * @return Name of connection class associated with \a aconf.
@@ -0,0 +1,290 @@
+/*
+ * IRC - Internet Relay Chat, ircd/conf_index.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+/** @file
+ * @brief Indexes of Client and Kill blocks by IP, host and realname.
+ */
+#include "config.h"
+
+#include "conf_index.h"
+#include "ircd_alloc.h"
+#include "ircd_chattr.h"
+#include "ircd_string.h"
+#include "res.h"
+
+/* #include <assert.h> -- Now using assert in ircd_log.h */
+#include <string.h>
+
+/** Node in the bit trie of IP masks. */
+struct ConfIndexNode {
+  struct ConfIndexNode  *child[2]; /**< Subtrees for next bit clear or set. */
+  struct ConfIndexEntry *entries;  /**< Items whose mask ends here. */
+};
+
+/** Kinds of key in a configuration index hash table. */
+enum ConfIndexKey {
+  CIK_HOST,     /**< Literal host name. */
+  CIK_SUFFIX,   /**< Domain suffix, starting with '.'. */
+  CIK_REALNAME  /**< Literal realname. */
+};
+
+/** Bucket of index entries sharing the same key. */
+struct ConfIndexBucket {
+  struct ConfIndexBucket *next;    /**< Next bucket in the same chain. */
+  const char             *key;     /**< Key, pointing into the item. */
+  unsigned int            hash;    /**< Hash value of #key. */
+  enum ConfIndexKey       kind;    /**< What #key is. */
+  struct ConfIndexEntry  *entries; /**< Items with this key. */
+};
+
+/** Hash one character of a key into a hash value.
+ * Keys are hashed from the end so that the hash of every suffix of a
+ * host name is found on the way to the hash of the whole name.
+ */
+#define CONF_INDEX_HASH(hash, ch) ((hash) * 31 + ToLower(ch))
+
+/** Free a subtree of an IP mask trie.
+ * @param[in] node Root of the subtree.
+ */
+static void conf_index_free_node(struct ConfIndexNode *node)
+{
+  if (!node)
+    return;
+  conf_index_free_node(node->child[0]);
+  conf_index_free_node(node->child[1]);
+  MyFree(node);
+}
+
+/** Discard the contents of a configuration index.
+ * @param[in] ci Index to clear.
+ */
+void conf_index_clear(struct ConfIndex *ci)
+{
+  struct ConfIndexBucket *bucket;
+  unsigned int i;
+
+  conf_index_free_node(ci->root);
+  for (i = 0; i < ci->bsize; i++)
+    while ((bucket = ci->buckets[i])) {
+      ci->buckets[i] = bucket->next;
+      MyFree(bucket);
+    }
+  MyFree(ci->buckets);
+  MyFree(ci->entries);
+  ci->root = 0;
+  ci->bsize = 0;
+  ci->generic = 0;
+}
+
+/** Prepare a configuration index to hold items.
+ * The caller then sets ConfIndexEntry::item for each entry in list
+ * order and calls conf_index_place() for each in reverse order.
+ * @param[in] ci Index to initialize.
+ * @param[in] count Number of items to index.
+ */
+void conf_index_init(struct ConfIndex *ci, unsigned int count)
+{
+  unsigned int i;
+
+  conf_index_clear(ci);
+  for (ci->bsize = 16; ci->bsize < count * 2; ci->bsize <<= 1)
+    ;
+  ci->buckets = (struct ConfIndexBucket **)
+    MyCalloc(ci->bsize, sizeof(*ci->buckets));
+  ci->entries = (struct ConfIndexEntry *)
+    MyCalloc(count ? count : 1, sizeof(*ci->entries));
+  for (i = 0; i < count; i++)
+    ci->entries[i].seq = i;
+}
+
+/** Compute the hash value of a whole key.
+ * @param[in] key Key to hash.
+ * @return Hash value.
+ */
+static unsigned int conf_index_hash(const char *key)
+{
+  unsigned int hash = 0;
+  int i;
+
+  for (i = strlen(key); i > 0; i--)
+    hash = CONF_INDEX_HASH(hash, key[i - 1]);
+  return hash;
+}
+
+/** Add an entry to the hash bucket for a key, creating it if needed.
+ * @param[in] ci Index to add to.
+ * @param[in] key Host name, domain suffix or realname.
+ * @param[in] kind What \a key is.
+ * @param[in] entry Entry to add.
+ */
+static void conf_index_add_key(struct ConfIndex *ci, const char *key,
+                               enum ConfIndexKey kind,
+                               struct ConfIndexEntry *entry)
+{
+  struct ConfIndexBucket *bucket;
+  unsigned int hash = conf_index_hash(key);
+
+  for (bucket = ci->buckets[hash & (ci->bsize - 1)]; bucket;
+       bucket = bucket->next)
+    if (bucket->hash == hash && bucket->kind == kind
+        && !ircd_strcmp(bucket->key, key))
+      break;
+  if (!bucket) {
+    bucket = (struct ConfIndexBucket *) MyCalloc(1, sizeof(*bucket));
+    bucket->key = key;
+    bucket->hash = hash;
+    bucket->kind = kind;
+    bucket->next = ci->buckets[hash & (ci->bsize - 1)];
+    ci->buckets[hash & (ci->bsize - 1)] = bucket;
+  }
+  entry->next = bucket->entries;
+  bucket->entries = entry;
+}
+
+/** Add an entry to the IP mask trie.
+ * @param[in] ci Index to add to.
+ * @param[in] addr Address part of the mask.
+ * @param[in] bits Number of significant bits in \a addr.
+ * @param[in] entry Entry to add.
+ */
+static void conf_index_add_ip(struct ConfIndex *ci,
+                              const struct irc_in_addr *addr, int bits,
+                              struct ConfIndexEntry *entry)
+{
+  struct ConfIndexNode **node = &ci->root;
+  int i, bit;
+
+  for (i = 0; ; i++) {
+    if (!*node)
+      *node = (struct ConfIndexNode *) MyCalloc(1, sizeof(**node));
+    if (i == bits)
+      break;
+    bit = (ntohs(addr->in6_16[i / 16]) >> (15 - i % 16)) & 1;
+    node = &(*node)->child[bit];
+  }
+  entry->next = (*node)->entries;
+  (*node)->entries = entry;
+}
+
+/** File an index entry under the most selective mask it has.
+ * Entries must be placed in reverse list order.  Every mask passed
+ * here must be one that a matching client is certain to satisfy.
+ * @param[in] ci Index to add to.
+ * @param[in] seq Position of the item (index into ConfIndex::entries).
+ * @param[in] addr IP mask address, or NULL.
+ * @param[in] bits Number of bits in \a addr; 0 or less for none.
+ * @param[in] host Host mask, or NULL.
+ * @param[in] realname Realname mask, or NULL.
+ */
+void conf_index_place(struct ConfIndex *ci, unsigned int seq,
+                      const struct irc_in_addr *addr, int bits,
+                      const char *host, const char *realname)
+{
+  struct ConfIndexEntry *entry = &ci->entries[seq];
+
+  if (addr && bits > 0 && bits <= 128)
+    conf_index_add_ip(ci, addr, bits, entry);
+  else if (host && host[0] == '*' && host[1] == '.'
+           && !strpbrk(host + 1, "*?\\"))
+    conf_index_add_key(ci, host + 1, CIK_SUFFIX, entry);
+  else if (host && !strpbrk(host, "*?\\"))
+    conf_index_add_key(ci, host, CIK_HOST, entry);
+  else if (realname && !strpbrk(realname, "*?\\"))
+    conf_index_add_key(ci, realname, CIK_REALNAME, entry);
+  else {
+    entry->next = ci->generic;
+    ci->generic = entry;
+  }
+}
+
+/** Find the index buckets that could hold items matching a client.
+ * @param[in] ci Index to search.
+ * @param[in] addr Client's IP address.
+ * @param[in] host Client's host name.
+ * @param[in] realname Client's realname, or NULL.
+ * @param[out] cand Array of CONF_INDEX_CANDIDATES bucket heads.
+ * @return Number of elements filled in \a cand.
+ */
+int conf_index_lookup(struct ConfIndex *ci,
+                      const struct irc_in_addr *addr,
+                      const char *host, const char *realname,
+                      struct ConfIndexEntry **cand)
+{
+  struct ConfIndexNode *node;
+  struct ConfIndexBucket *bucket;
+  unsigned int hash = 0;
+  int ncand = 0, i, bit;
+
+  if (ci->generic)
+    cand[ncand++] = ci->generic;
+
+  for (node = ci->root, i = 0; node; i++) {
+    if (node->entries)
+      cand[ncand++] = node->entries;
+    if (i == 128)
+      break;
+    bit = (ntohs(addr->in6_16[i / 16]) >> (15 - i % 16)) & 1;
+    node = node->child[bit];
+  }
+
+  for (i = strlen(host); i > 0; i--) {
+    hash = CONF_INDEX_HASH(hash, host[i - 1]);
+    if (host[i - 1] != '.' && i > 1)
+      continue;
+    for (bucket = ci->buckets[hash & (ci->bsize - 1)]; bucket;
+         bucket = bucket->next)
+      if (bucket->hash == hash
+          && (bucket->kind == CIK_SUFFIX ? host[i - 1] == '.' :
+              bucket->kind == CIK_HOST && i == 1)
+          && !ircd_strcmp(bucket->key, host + i - 1))
+        cand[ncand++] = bucket->entries;
+  }
+
+  if (realname) {
+    hash = conf_index_hash(realname);
+    for (bucket = ci->buckets[hash & (ci->bsize - 1)]; bucket;
+         bucket = bucket->next)
+      if (bucket->hash == hash && bucket->kind == CIK_REALNAME
+          && !ircd_strcmp(bucket->key, realname)) {
+        cand[ncand++] = bucket->entries;
+        break;
+      }
+  }
+
+  return ncand;
+}
+
+/** Take the next candidate, in list order, from a set of buckets.
+ * @param[in,out] cand Bucket heads from conf_index_lookup().
+ * @param[in] ncand Number of elements in \a cand.
+ * @return Next entry, or NULL when all buckets are exhausted.
+ */
+struct ConfIndexEntry *conf_index_next(struct ConfIndexEntry **cand,
+                                       int ncand)
+{
+  struct ConfIndexEntry *best = 0;
+  int i, best_i = 0;
+
+  for (i = 0; i < ncand; i++)
+    if (cand[i] && (!best || cand[i]->seq < best->seq)) {
+      best = cand[i];
+      best_i = i;
+    }
+  if (best)
+    cand[best_i] = best->next;
+  return best;
+}
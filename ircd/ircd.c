@@ -32,6 +32,7 @@
 #include "ircd_alloc.h"
 #include "ircd_events.h"
 #include "ircd_features.h"
+#include "ircd_intern.h"
 #include "ircd_log.h"
 #include "ircd_reply.h"
 #include "ircd_signal.h"
@@ -916,25 +917,30 @@ int main(int argc, char **argv) {
   initwhowas();
   initmsgtree();
   initstats();
+  cli_info(&me) = intern_empty;
 
   /* we need this for now, when we're modular this 
      should be removed -- hikari */
   ircd_crypt_init();
 
+  if (thisServer.bootopt & BOOT_CHKCONF) {
+    if (!conf_check(dbg_client)) {
+      log_write(LS_SYSTEM, L_CRIT, 0, "Failed to read configuration file %s",
+                configfile);
+      return 7;
+    }
+    fprintf(stderr, "Configuration file %s checked okay.\n", configfile);
+    return 0;
+  }
+
   if (!init_conf()) {
     log_write(LS_SYSTEM, L_CRIT, 0, "Failed to read configuration file %s",
 	      configfile);
     return 7;
   }
 
-  if (thisServer.bootopt & BOOT_CHKCONF) {
-    if (dbg_client)
-      conf_debug_iline(dbg_client);
-    fprintf(stderr, "Configuration file %s checked okay.\n", configfile);
-    return 0;
-  }
-
   debug_init(thisServer.bootopt & BOOT_TTY);
+  log_writer_start();
   if (check_pid()) {
     log_write(LS_SYSTEM, L_CRIT, 0, 
 		    "Failed to acquire PID file lock after fork");
@@ -30,7 +30,9 @@
 #include "s_debug.h"
 
 /* #include <assert.h> -- Now using assert in ircd_log.h */
+#include <stdint.h>
 #include <string.h>
+#include <sys/mman.h>
 
 static void nomem_handler(void);
 
@@ -103,3 +105,260 @@ void* DoRealloc(void *orig, size_t size, const char *file, int line)
   return t;
 }
 #endif
+
+/** Alignment of objects within a slab. */
+#define SLAB_ALIGN 16
+/** Round \a x up to a multiple of \a a (a power of two). */
+#define SLAB_ROUND(x, a) (((x) + (a) - 1) & ~((size_t)(a) - 1))
+/** Offset of the first object in a slab. */
+#define SLAB_HEADER SLAB_ROUND(sizeof(struct Slab), 64)
+/** Find the slab containing \a obj. */
+#define SLAB_OF(obj) \
+  ((struct Slab *)((uintptr_t)(obj) & ~((uintptr_t)SLAB_SIZE - 1)))
+
+/** Header at the start of each slab. */
+struct Slab {
+  struct Slab *s_next;          /**< Next slab in SlabCache::sc_all. */
+  struct Slab **s_prev_p;       /**< Pointer to this slab in sc_all. */
+  struct Slab *s_next_partial;  /**< Next slab in SlabCache::sc_partial. */
+  struct Slab **s_prev_partial; /**< Pointer to this slab in sc_partial. */
+  void *s_free;                 /**< Objects that were freed. */
+  unsigned int s_inuse;         /**< Number of objects in use. */
+  unsigned int s_carved;        /**< Number of objects ever handed out. */
+};
+
+/** List of caches that have allocated slabs. */
+static struct SlabCache *slabCaches;
+
+/** Return list of slab caches that have been used. */
+const struct SlabCache *
+slab_cache_list(void)
+{
+  return slabCaches;
+}
+
+#ifndef MDEBUG
+/** Link \a slab at the head of its cache's list of slabs with free
+ * objects.
+ * @param[in] cache Cache owning \a slab.
+ * @param[in] slab Slab to link.
+ */
+static void
+slab_link_partial(struct SlabCache *cache, struct Slab *slab)
+{
+  if ((slab->s_next_partial = cache->sc_partial))
+    cache->sc_partial->s_prev_partial = &slab->s_next_partial;
+  slab->s_prev_partial = &cache->sc_partial;
+  cache->sc_partial = slab;
+}
+
+/** Unlink \a slab from its cache's list of slabs with free objects.
+ * @param[in] slab Slab to unlink.
+ */
+static void
+slab_unlink_partial(struct Slab *slab)
+{
+  if ((*slab->s_prev_partial = slab->s_next_partial))
+    slab->s_next_partial->s_prev_partial = slab->s_prev_partial;
+  slab->s_prev_partial = 0;
+}
+
+/** Add a slab to \a cache.
+ * Slabs are aligned to their size so that slab_free() can find an
+ * object's slab from its address, and are marked as candidates for
+ * huge pages where the system supports that.
+ * @param[in] cache Cache to grow.
+ */
+static void
+slab_grow(struct SlabCache *cache)
+{
+  struct Slab *slab;
+  void *mem;
+
+  if (!cache->sc_per_slab) {
+    cache->sc_size = SLAB_ROUND(cache->sc_size, SLAB_ALIGN);
+    assert(cache->sc_size <= SLAB_SIZE - SLAB_HEADER);
+    cache->sc_per_slab = (SLAB_SIZE - SLAB_HEADER) / cache->sc_size;
+    cache->sc_next = slabCaches;
+    slabCaches = cache;
+  }
+
+  if (posix_memalign(&mem, SLAB_SIZE, SLAB_SIZE)) {
+    (*noMemHandler)();
+    return;
+  }
+#ifdef MADV_HUGEPAGE
+  madvise(mem, SLAB_SIZE, MADV_HUGEPAGE);
+#endif
+
+  slab = mem;
+  memset(slab, 0, sizeof(*slab));
+  if ((slab->s_next = cache->sc_all))
+    cache->sc_all->s_prev_p = &slab->s_next;
+  slab->s_prev_p = &cache->sc_all;
+  cache->sc_all = slab;
+  slab_link_partial(cache, slab);
+  cache->sc_slabs++;
+  cache->sc_empty++;
+}
+
+/** Make sure \a cache can hold \a count objects without growing.
+ * The slabs allocated here are kept even when they are empty.
+ * @param[in] cache Cache to fill.
+ * @param[in] count Number of objects to make room for.
+ */
+void
+slab_reserve(struct SlabCache *cache, size_t count)
+{
+  unsigned int slabs;
+
+  while (!cache->sc_per_slab
+         || (size_t)cache->sc_slabs * cache->sc_per_slab < count) {
+    slabs = cache->sc_slabs;
+    slab_grow(cache);
+    if (cache->sc_slabs == slabs)
+      break;
+  }
+  if (cache->sc_min_slabs < cache->sc_slabs)
+    cache->sc_min_slabs = cache->sc_slabs;
+}
+
+/** Allocate an object from \a cache.
+ * The object's contents are not initialized.
+ * @param[in] cache Cache to allocate from.
+ * @return Newly allocated object.
+ */
+void *
+slab_alloc(struct SlabCache *cache)
+{
+  struct Slab *slab;
+  void *obj;
+
+  if (!(slab = cache->sc_partial)) {
+    slab_grow(cache);
+    if (!(slab = cache->sc_partial))
+      return 0;
+  }
+
+  if ((obj = slab->s_free))
+    slab->s_free = *(void **)obj;
+  else
+    obj = (char *)slab + SLAB_HEADER + cache->sc_size * slab->s_carved++;
+
+  if (slab->s_inuse++ == 0)
+    cache->sc_empty--;
+  if (slab->s_inuse == cache->sc_per_slab)
+    slab_unlink_partial(slab);
+  if (++cache->sc_inuse > cache->sc_peak)
+    cache->sc_peak = cache->sc_inuse;
+  return obj;
+}
+
+/** Return an object to \a cache.
+ * A slab left empty is released if the cache has another empty slab
+ * and more slabs than were reserved.
+ * @param[in] cache Cache that \a obj was allocated from.
+ * @param[in] obj Object to free.
+ */
+void
+slab_free(struct SlabCache *cache, void *obj)
+{
+  struct Slab *slab = SLAB_OF(obj);
+
+  assert(slab->s_inuse > 0);
+  assert(cache->sc_inuse > 0);
+
+  *(void **)obj = slab->s_free;
+  slab->s_free = obj;
+  if (slab->s_inuse-- == cache->sc_per_slab)
+    slab_link_partial(cache, slab);
+  cache->sc_inuse--;
+
+  if (slab->s_inuse > 0)
+    return;
+  if (cache->sc_empty == 0 || cache->sc_slabs <= cache->sc_min_slabs) {
+    cache->sc_empty++;
+    return;
+  }
+
+  slab_unlink_partial(slab);
+  if ((*slab->s_prev_p = slab->s_next))
+    slab->s_next->s_prev_p = slab->s_prev_p;
+  cache->sc_slabs--;
+  free(slab);
+}
+
+/** Count slabs of \a cache by how full they are.
+ * Bucket 0 counts empty slabs, the last bucket counts full slabs, and
+ * the ones in between count partly used slabs in equal steps.
+ * @param[in] cache Cache to examine.
+ * @param[out] hist Receives number of slabs in each bucket.
+ */
+void
+slab_occupancy(const struct SlabCache *cache, unsigned int hist[SLAB_BUCKETS])
+{
+  const struct Slab *slab;
+
+  memset(hist, 0, SLAB_BUCKETS * sizeof(hist[0]));
+  for (slab = cache->sc_all; slab; slab = slab->s_next) {
+    if (slab->s_inuse == 0)
+      hist[0]++;
+    else if (slab->s_inuse == cache->sc_per_slab)
+      hist[SLAB_BUCKETS - 1]++;
+    else
+      hist[1 + (unsigned long)slab->s_inuse * (SLAB_BUCKETS - 2)
+           / cache->sc_per_slab]++;
+  }
+}
+#else /* defined(MDEBUG) */
+/* Debugging builds allocate each object on its own, so that the
+ * memory debugger can track them.
+ */
+
+/** Count objects that \a cache has room for (ignored).
+ * @param[in] cache Cache to fill.
+ * @param[in] count Number of objects to make room for.
+ */
+void
+slab_reserve(struct SlabCache *cache, size_t count)
+{
+}
+
+/** Allocate an object for \a cache.
+ * @param[in] cache Cache to allocate from.
+ * @return Newly allocated object.
+ */
+void *
+slab_alloc(struct SlabCache *cache)
+{
+  if (!cache->sc_per_slab) {
+    cache->sc_per_slab = 1;
+    cache->sc_next = slabCaches;
+    slabCaches = cache;
+  }
+  if (++cache->sc_inuse > cache->sc_peak)
+    cache->sc_peak = cache->sc_inuse;
+  return MyMalloc(cache->sc_size);
+}
+
+/** Free an object allocated from \a cache.
+ * @param[in] cache Cache that \a obj was allocated from.
+ * @param[in] obj Object to free.
+ */
+void
+slab_free(struct SlabCache *cache, void *obj)
+{
+  cache->sc_inuse--;
+  MyFree(obj);
+}
+
+/** Count slabs of \a cache by how full they are (always zero).
+ * @param[in] cache Cache to examine.
+ * @param[out] hist Receives number of slabs in each bucket.
+ */
+void
+slab_occupancy(const struct SlabCache *cache, unsigned int hist[SLAB_BUCKETS])
+{
+  memset(hist, 0, SLAB_BUCKETS * sizeof(hist[0]));
+}
+#endif /* defined(MDEBUG) */
@@ -28,6 +28,7 @@
 #include "hash.h"
 #include "ircd.h"
 #include "ircd_alloc.h"
+#include "ircd_intern.h"
 #include "ircd_log.h"
 #include "ircd_reply.h"
 #include "ircd_string.h"
@@ -37,6 +38,7 @@
 #include "numeric.h"
 #include "numnicks.h"
 #include "random.h"	/* random_seed_set */
+#include "res.h"	/* resolver_cache_resize */
 #include "s_bsd.h"
 #include "s_debug.h"
 #include "s_misc.h"
@@ -52,6 +54,11 @@
 
 struct Client his;
 
+/** Number of times feature values have changed; starts at 1 so that
+ * caches initialized to zero are stale.
+ */
+unsigned int feature_generation = 1;
+
 #define F_I(NAME, FLAGS, DEFAULT, NOTIFY) int FEAT_ ## NAME = DEFAULT;
 #define F_U(NAME, FLAGS, DEFAULT, NOTIFY) unsigned int FEAT_ ## NAME = DEFAULT;
 #define F_B(NAME, FLAGS, DEFAULT, NOTIFY) int FEAT_ ## NAME = DEFAULT;
@@ -180,7 +187,7 @@ feature_notify_servername(void)
 static void
 feature_notify_serverinfo(void)
 {
-  ircd_strncpy(cli_info(&his), feature_str(FEAT_HIS_SERVERINFO), REALLEN);
+  intern_set(&cli_info(&his), feature_str(FEAT_HIS_SERVERINFO), REALLEN);
 }
 
 /** Report the value of a log setting.
@@ -584,8 +591,11 @@ feature_set(struct Client* from, const char* const* fields, int count)
       break;
     }
 
-    if (change && feat->notify) /* call change notify function */
-      (*feat->notify)();
+    if (change) {
+      feature_generation++; /* invalidate values computed from features */
+      if (feat->notify) /* call change notify function */
+	(*feat->notify)();
+    }
 
     if (from)
       return feature_get(from, fields, count);
@@ -651,8 +661,11 @@ feature_reset(struct Client* from, const char* const* fields, int count)
       break;
     }
 
-    if (change && feat->notify) /* call change notify function */
-      (*feat->notify)();
+    if (change) {
+      feature_generation++; /* invalidate values computed from features */
+      if (feat->notify) /* call change notify function */
+	(*feat->notify)();
+    }
 
     if (from)
       return feature_get(from, fields, count);
@@ -774,8 +787,11 @@ feature_mark(void)
       break;
     }
 
-    if (change && features[i].notify)
-      (*features[i].notify)(); /* call change notify function */
+    if (change) {
+      feature_generation++; /* invalidate values computed from features */
+      if (features[i].notify)
+	(*features[i].notify)(); /* call change notify function */
+    }
   }
 }
 
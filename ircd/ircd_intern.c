@@ -0,0 +1,188 @@
+/*
+ * IRC - Internet Relay Chat, ircd/ircd_intern.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+/** @file
+ * @brief Shared, reference-counted copies of common strings.
+ */
+#include "config.h"
+
+#include "ircd_intern.h"
+#include "ircd_alloc.h"
+#include "ircd_log.h"
+
+/* #include <assert.h> -- Now using assert in ircd_log.h */
+#include <stddef.h>  /* offsetof */
+#include <string.h>
+
+/** Initial number of hash buckets; must be a power of two. */
+#define INTERN_MIN_BUCKETS 1024
+
+/** One interned string. */
+struct InternString {
+  struct InternString *next;    /**< Next string in the same bucket. */
+  unsigned int refs;            /**< Number of references to the string. */
+  unsigned int hash;            /**< Hash of the text. */
+  char text[1];                 /**< The string itself. */
+};
+
+/** Find the InternString holding \a str. */
+#define intern_entry(str) \
+  ((struct InternString *)((str) - offsetof(struct InternString, text)))
+
+const char intern_empty[1] = "";
+
+/** Hash buckets of interned strings. */
+static struct InternString **buckets;
+/** Number of entries in #buckets (a power of two). */
+static size_t n_buckets;
+/** Number of distinct strings interned. */
+static size_t n_strings;
+/** Number of bytes allocated for interned strings. */
+static size_t n_bytes;
+
+/** Hash the first \a len bytes of \a str (FNV-1a). */
+static unsigned int intern_hash(const char *str, size_t len)
+{
+  unsigned int hash = 2166136261u;
+
+  while (len--)
+    hash = (hash ^ (unsigned char)*str++) * 16777619u;
+  return hash;
+}
+
+/** Double the number of hash buckets. */
+static void intern_grow(void)
+{
+  struct InternString **old = buckets, *entry, *next;
+  size_t old_size = n_buckets, ii;
+
+  n_buckets = n_buckets ? n_buckets * 2 : INTERN_MIN_BUCKETS;
+  buckets = MyCalloc(n_buckets, sizeof(*buckets));
+  for (ii = 0; ii < old_size; ++ii) {
+    for (entry = old[ii]; entry; entry = next) {
+      next = entry->next;
+      entry->next = buckets[entry->hash & (n_buckets - 1)];
+      buckets[entry->hash & (n_buckets - 1)] = entry;
+    }
+  }
+  MyFree(old);
+}
+
+/** Get a reference to the interned copy of a string.
+ * @param[in] str String to intern.
+ * @param[in] maxlen Maximum number of characters to keep from \a str.
+ * @return Interned string; release it with intern_release().
+ */
+const char *intern_string(const char *str, size_t maxlen)
+{
+  struct InternString *entry;
+  unsigned int hash;
+  size_t len;
+
+  assert(0 != str);
+  for (len = 0; len < maxlen && str[len]; ++len) ;
+  if (!len)
+    return intern_empty;
+
+  hash = intern_hash(str, len);
+  if (n_buckets) {
+    for (entry = buckets[hash & (n_buckets - 1)]; entry; entry = entry->next) {
+      if (entry->hash == hash && !strncmp(entry->text, str, len)
+          && !entry->text[len]) {
+        entry->refs++;
+        return entry->text;
+      }
+    }
+  }
+
+  if (n_strings >= n_buckets)
+    intern_grow();
+  entry = MyMalloc(offsetof(struct InternString, text) + len + 1);
+  entry->refs = 1;
+  entry->hash = hash;
+  memcpy(entry->text, str, len);
+  entry->text[len] = '\0';
+  entry->next = buckets[hash & (n_buckets - 1)];
+  buckets[hash & (n_buckets - 1)] = entry;
+  n_strings++;
+  n_bytes += offsetof(struct InternString, text) + len + 1;
+  return entry->text;
+}
+
+/** Add a reference to an interned string.
+ * @param[in] str Interned string (or NULL).
+ * @return \a str.
+ */
+const char *intern_ref(const char *str)
+{
+  if (str && str != intern_empty)
+    intern_entry(str)->refs++;
+  return str;
+}
+
+/** Drop a reference to an interned string, freeing it after the last.
+ * @param[in] str Interned string (or NULL).
+ */
+void intern_release(const char *str)
+{
+  struct InternString *entry, **pp;
+
+  if (!str || str == intern_empty)
+    return;
+  entry = intern_entry(str);
+  assert(entry->refs > 0);
+  if (--entry->refs)
+    return;
+
+  for (pp = &buckets[entry->hash & (n_buckets - 1)]; *pp != entry;
+       pp = &(*pp)->next)
+    assert(0 != *pp);
+  *pp = entry->next;
+  n_strings--;
+  n_bytes -= offsetof(struct InternString, text) + strlen(entry->text) + 1;
+  MyFree(entry);
+}
+
+/** Replace an interned string field with a new value.
+ * @param[in,out] field Field holding an interned string (or NULL).
+ * @param[in] str New value.
+ * @param[in] maxlen Maximum number of characters to keep from \a str.
+ */
+void intern_set(const char **field, const char *str, size_t maxlen)
+{
+  const char *old = *field;
+
+  *field = intern_string(str, maxlen);
+  intern_release(old);
+}
+
+/** Report memory used by interned strings.
+ * @param[out] count Receives number of distinct strings.
+ * @param[out] refs Receives number of references to them.
+ * @param[out] bytes Receives bytes used by strings and hash buckets.
+ */
+void intern_count_memory(size_t *count, size_t *refs, size_t *bytes)
+{
+  struct InternString *entry;
+  size_t ii;
+
+  *count = n_strings;
+  *bytes = n_bytes + n_buckets * sizeof(*buckets);
+  for (*refs = 0, ii = 0; ii < n_buckets; ++ii)
+    for (entry = buckets[ii]; entry; entry = entry->next)
+      *refs += entry->refs;
+}
@@ -27,12 +27,18 @@
 
 #include "ircd_log.h"
 #include "client.h"
+#include "class.h"
 #include "ircd_alloc.h"
+#include "ircd_events.h"
+#include "ircd_features.h"
 #include "ircd_reply.h"
+#include "ircd_signal.h"
 #include "ircd_snprintf.h"
 #include "ircd_string.h"
 #include "ircd.h"
+#include "listener.h"
 #include "numeric.h"
+#include "numnicks.h"
 #include "s_debug.h"
 #include "send.h"
 #include "struct.h"
@@ -40,13 +46,17 @@
 /* #include <assert.h> -- Now using assert in ircd_log.h */
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/uio.h>
+#include <signal.h>
 #include <syslog.h>
 #include <time.h>
 #include <unistd.h>
@@ -185,6 +195,669 @@ static struct logInfo_s {
   struct LogFile *dbfile;   /**< debug file */
 } logInfo = { 0, 0, LOG_USER, "ircd", 0 };
 
+/** Maximum number of iovecs the log writer passes to one writev(). */
+#define LOG_WRITER_IOV 64
+/** Size of the log writer's input buffer. */
+#define LOG_WRITER_BUFSIZE 65536
+/** Longest a blocking flush waits for the log writer, in milliseconds. */
+#define LOG_WRITER_WAIT 250
+
+/** Header of a record passed to the log writer process.
+ * The file name (if any) and the text follow the header.  A record
+ * with neither asks the writer to reopen its files.
+ */
+struct LogRecord {
+  int		 lr_syslog; /**< syslog() priority, or -1 to write a file. */
+  unsigned short lr_path;   /**< Length of file name. */
+  unsigned short lr_text;   /**< Length of text. */
+};
+
+/** State of the log writer process. */
+static struct LogWriter {
+  pid_t		 pid;	    /**< process ID of writer, or -1 */
+  int		 fd;	    /**< pipe to writer, or -1 */
+  char		*buf;	    /**< records not yet sent to the writer */
+  size_t	 size;	    /**< allocated size of buf */
+  size_t	 rec;	    /**< offset of first record not sent whole */
+  size_t	 head;	    /**< offset of first unsent byte in buf */
+  size_t	 tail;	    /**< offset of end of data in buf */
+  size_t	 peak;	    /**< most bytes ever waiting in buf */
+  unsigned int	 queued;    /**< records passed to the writer */
+  unsigned int	 dropped;   /**< records dropped because buf was full */
+  unsigned int	 sync;	    /**< records written directly */
+  unsigned int	 stalls;    /**< blocking flushes that timed out */
+  int		 stalled;   /**< writer made no progress since a timeout */
+  struct Timer	 timer;	    /**< timer to flush buf */
+} logWriter = { -1, -1 };
+
+/** Files opened by log_writer_output(). */
+static struct {
+  char		*path;	    /**< file name */
+  int		 fd;	    /**< file descriptor */
+  unsigned int	 used;	    /**< value of logWriterClock at last use */
+} logWriterFiles[LS_LAST_SYSTEM + 1];
+/** Counter used to find the least recently used file. */
+static unsigned int logWriterClock;
+
+/** Close the files opened by log_writer_output(). */
+static void
+log_writer_close_files(void)
+{
+  int i;
+
+  for (i = 0; i <= LS_LAST_SYSTEM && logWriterFiles[i].path; i++) {
+    if (logWriterFiles[i].fd >= 0)
+      close(logWriterFiles[i].fd);
+    MyFree(logWriterFiles[i].path);
+    logWriterFiles[i].path = 0;
+    logWriterFiles[i].fd = -1;
+  }
+}
+
+/** Find the descriptor for a log file, opening it if needed.
+ * @param[in] path File name (not NUL-terminated).
+ * @param[in] len Length of \a path.
+ * @return File descriptor, or -1 if the file cannot be opened.
+ */
+static int
+log_writer_file(const char *path, size_t len)
+{
+  int i, lru = 0;
+
+  for (i = 0; i <= LS_LAST_SYSTEM && logWriterFiles[i].path; i++) {
+    if (!strncmp(logWriterFiles[i].path, path, len)
+        && !logWriterFiles[i].path[len]) {
+      logWriterFiles[i].used = ++logWriterClock;
+      return logWriterFiles[i].fd;
+    }
+    if (logWriterFiles[i].used < logWriterFiles[lru].used)
+      lru = i;
+  }
+
+  if (i > LS_LAST_SYSTEM) { /* table is full; close the least used file */
+    i = lru;
+    if (logWriterFiles[i].fd >= 0)
+      close(logWriterFiles[i].fd);
+    MyFree(logWriterFiles[i].path);
+  }
+
+  logWriterFiles[i].used = ++logWriterClock;
+  logWriterFiles[i].path = (char*) MyMalloc(len + 1);
+  memcpy(logWriterFiles[i].path, path, len);
+  logWriterFiles[i].path[len] = '\0';
+  logWriterFiles[i].fd = open(logWriterFiles[i].path,
+                              O_WRONLY | O_CREAT | O_APPEND,
+                              S_IRUSR | S_IWUSR);
+  return logWriterFiles[i].fd;
+}
+
+/** Write out complete records from a buffer.
+ * Consecutive records for the same file are written with one writev().
+ * @param[in] buf Buffer holding records.
+ * @param[in] len Number of bytes in \a buf.
+ * @return Number of bytes of complete records that were written.
+ */
+static size_t
+log_writer_output(const char *buf, size_t len)
+{
+  struct LogRecord lr;
+  struct iovec vector[LOG_WRITER_IOV];
+  const char *path = 0;
+  size_t used = 0, pathlen = 0;
+  int count = 0;
+
+  while (len - used >= sizeof(lr)) {
+    memcpy(&lr, buf + used, sizeof(lr));
+    if (len - used < sizeof(lr) + lr.lr_path + lr.lr_text)
+      break; /* incomplete record */
+
+    /* write out the batch if this record doesn't belong in it */
+    if (count && (count == LOG_WRITER_IOV || lr.lr_syslog >= 0
+                  || lr.lr_path != pathlen
+                  || memcmp(path, buf + used + sizeof(lr), pathlen))) {
+      int fd = log_writer_file(path, pathlen);
+      if (fd >= 0)
+        writev(fd, vector, count);
+      count = 0;
+    }
+
+    if (lr.lr_syslog >= 0)
+      syslog(lr.lr_syslog, "%.*s", lr.lr_text,
+             buf + used + sizeof(lr) + lr.lr_path);
+    else if (lr.lr_path) {
+      path = buf + used + sizeof(lr);
+      pathlen = lr.lr_path;
+      vector[count].iov_base = (void*) (path + pathlen);
+      vector[count].iov_len = lr.lr_text;
+      count++;
+    } else /* reopen request */
+      log_writer_close_files();
+
+    used += sizeof(lr) + lr.lr_path + lr.lr_text;
+  }
+
+  if (count) {
+    int fd = log_writer_file(path, pathlen);
+    if (fd >= 0)
+      writev(fd, vector, count);
+  }
+
+  return used;
+}
+
+/** Main loop of the log writer process.
+ * Reads records from the server until it closes the pipe.
+ * @param[in] fd Read end of the pipe from the server.
+ * @param[in] ppid Process ID of the server, for syslog.
+ */
+static void
+log_writer_run(int fd, pid_t ppid)
+{
+  char ident[64];
+  char *buf;
+  size_t len = 0, used;
+  ssize_t res;
+
+  signal(SIGHUP, SIG_IGN); /* the server tells us when to stop */
+  signal(SIGINT, SIG_IGN);
+  signal(SIGTERM, SIG_IGN);
+  signal(SIGCHLD, SIG_DFL);
+
+  closelog();
+  ircd_snprintf(0, ident, sizeof(ident), "%s[%u]", logInfo.procname,
+                (unsigned int) ppid);
+  openlog(ident, LOG_NDELAY, logInfo.facility);
+
+  buf = (char*) MyMalloc(LOG_WRITER_BUFSIZE);
+  while ((res = read(fd, buf + len, LOG_WRITER_BUFSIZE - len)) != 0) {
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    len += res;
+    used = log_writer_output(buf, len);
+    memmove(buf, buf + used, len - used);
+    len -= used;
+  }
+  _exit(0);
+}
+
+/** Send queued records to the log writer.
+ * A blocking flush waits at most #LOG_WRITER_WAIT milliseconds for a
+ * writer that is not keeping up; once one has timed out, later ones do
+ * not wait again until the writer makes progress.  Records that were
+ * not sent stay queued.
+ * @param[in] block If non-zero, wait for everything to be sent.
+ */
+static void
+log_writer_flush(int block)
+{
+  struct LogRecord lr;
+  struct timeval start, now;
+  struct pollfd pfd;
+  long waited;
+  ssize_t res;
+
+  if (logWriter.fd < 0)
+    return;
+
+  if (block)
+    gettimeofday(&start, NULL);
+  while (logWriter.head < logWriter.tail) {
+    res = write(logWriter.fd, logWriter.buf + logWriter.head,
+                logWriter.tail - logWriter.head);
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN || !block || logWriter.stalled)
+        break; /* the writer died and will be noticed, or we can't wait */
+      gettimeofday(&now, NULL);
+      waited = (now.tv_sec - start.tv_sec) * 1000
+        + (now.tv_usec - start.tv_usec) / 1000;
+      if (waited >= LOG_WRITER_WAIT) {
+        logWriter.stalled = 1;
+        logWriter.stalls++;
+        break;
+      }
+      pfd.fd = logWriter.fd;
+      pfd.events = POLLOUT;
+      poll(&pfd, 1, LOG_WRITER_WAIT - waited);
+      continue;
+    }
+    logWriter.head += res;
+    logWriter.stalled = 0;
+  }
+
+  /* skip the records the writer now has in full */
+  while (logWriter.rec < logWriter.head) {
+    memcpy(&lr, logWriter.buf + logWriter.rec, sizeof(lr));
+    if (logWriter.rec + sizeof(lr) + lr.lr_path + lr.lr_text
+        > logWriter.head)
+      break;
+    logWriter.rec += sizeof(lr) + lr.lr_path + lr.lr_text;
+  }
+
+  if (logWriter.head == logWriter.tail)
+    logWriter.rec = logWriter.head = logWriter.tail = 0;
+}
+
+/** Timer callback to send queued records to the log writer.
+ * @param[in] ev Timer event (ignored).
+ */
+static void
+log_writer_timer(struct Event *ev)
+{
+  if (ev_type(ev) == ET_EXPIRE)
+    log_writer_flush(0);
+}
+
+/** Stop passing records to the log writer.
+ * Anything not yet sent is written directly.  The writer exits once it
+ * has written what it already received.
+ */
+static void
+log_writer_stop(void)
+{
+  if (logWriter.fd < 0)
+    return;
+
+  close(logWriter.fd);
+  logWriter.fd = -1;
+  if (t_active(&logWriter.timer))
+    timer_del(&logWriter.timer);
+
+  /* the writer drops a record it only got part of */
+  log_writer_output(logWriter.buf + logWriter.rec,
+                    logWriter.tail - logWriter.rec);
+  log_writer_close_files();
+  logWriter.rec = logWriter.head = logWriter.tail = 0;
+  logWriter.stalled = 0;
+}
+
+/** Handle the exit of the log writer process.
+ * @param[in] cpid Process ID of the writer.
+ * @param[in] datum Unused.
+ * @param[in] status Exit status of the writer.
+ */
+static void
+log_writer_exited(pid_t cpid, void *datum, int status)
+{
+  if (cpid != logWriter.pid)
+    return;
+  logWriter.pid = -1;
+  if (logWriter.fd >= 0) {
+    log_writer_stop();
+    log_write(LS_SYSTEM, L_WARNING, 0, "Log writer exited with status %d; "
+              "writing logs directly until the next rehash", status);
+  }
+}
+
+/** Start the log writer process, if LOG_BUFFER is set.
+ * Log files and syslog are then written by a child process, so that
+ * slow disks do not block the server.
+ */
+void
+log_writer_start(void)
+{
+  size_t size = feature_int(FEAT_LOG_BUFFER);
+  int fds[2];
+  pid_t cpid;
+
+  if (logWriter.fd >= 0 || size == 0)
+    return;
+
+  if (size != logWriter.size) { /* size the buffer */
+    logWriter.buf = (char*) MyRealloc(logWriter.buf, size);
+    logWriter.size = size;
+  }
+
+  if (pipe(fds) < 0)
+    return;
+
+  if ((cpid = fork()) < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return;
+  } else if (cpid == 0) { /* we are the writer */
+    int fd;
+
+    log_writer_close_files();
+    for (fd = getdtablesize() - 1; fd >= 0; fd--)
+      if (fd != fds[0])
+        close(fd);
+    log_writer_run(fds[0], getppid());
+  }
+
+  close(fds[0]);
+  fcntl(fds[1], F_SETFL, O_NONBLOCK);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  logWriter.fd = fds[1];
+  logWriter.pid = cpid;
+  register_child(cpid, log_writer_exited, 0);
+  if (!t_active(&logWriter.timer))
+    timer_add(timer_init(&logWriter.timer), log_writer_timer, 0,
+              TT_PERIODIC, 1);
+}
+
+/** Handle a change to LOG_BUFFER.
+ * The buffer only exists on our side of the pipe, so a running writer
+ * is kept and the buffer resized; forking a new one from a large
+ * server is not cheap.
+ */
+void
+log_feature_buffer(void)
+{
+  size_t size = feature_int(FEAT_LOG_BUFFER);
+
+  if (logWriter.fd < 0) {
+    log_writer_start();
+    return;
+  }
+  if (size == logWriter.size)
+    return;
+
+  log_writer_flush(1);
+  if (size == 0) {
+    log_writer_stop();
+    return;
+  }
+
+  /* keep whatever the writer has not had yet */
+  memmove(logWriter.buf, logWriter.buf + logWriter.rec,
+          logWriter.tail - logWriter.rec);
+  logWriter.tail -= logWriter.rec;
+  logWriter.head -= logWriter.rec;
+  logWriter.rec = 0;
+  if (size < logWriter.tail)
+    size = logWriter.tail;
+  logWriter.buf = (char*) MyRealloc(logWriter.buf, size);
+  logWriter.size = size;
+}
+
+/** Queue a record for the log writer.
+ * @param[in] syslog_pri Priority for syslog(), or -1 to write a file.
+ * @param[in] path File name, or NULL.
+ * @param[in] vector Pieces of text to write.
+ * @param[in] count Number of elements in \a vector.
+ * @return Non-zero if the record was queued or dropped; zero if it
+ * must be written directly.
+ */
+static int
+log_writer_queue(int syslog_pri, const char *path, struct iovec *vector,
+                 int count)
+{
+  struct LogRecord lr;
+  size_t len;
+  int i;
+
+  if (logWriter.fd < 0)
+    return 0;
+
+  lr.lr_syslog = syslog_pri;
+  lr.lr_path = path ? strlen(path) : 0;
+  for (len = 0, i = 0; i < count; i++)
+    len += vector[i].iov_len;
+  lr.lr_text = len;
+  len += sizeof(lr) + lr.lr_path;
+
+  if (logWriter.size - logWriter.tail < len) {
+    /* out of room at the end; try to send some and move the rest down */
+    log_writer_flush(0);
+    memmove(logWriter.buf, logWriter.buf + logWriter.rec,
+            logWriter.tail - logWriter.rec);
+    logWriter.tail -= logWriter.rec;
+    logWriter.head -= logWriter.rec;
+    logWriter.rec = 0;
+    if (logWriter.size - logWriter.tail < len) {
+      logWriter.dropped++;
+      return 1;
+    }
+  }
+
+  memcpy(logWriter.buf + logWriter.tail, &lr, sizeof(lr));
+  logWriter.tail += sizeof(lr);
+  memcpy(logWriter.buf + logWriter.tail, path, lr.lr_path);
+  logWriter.tail += lr.lr_path;
+  for (i = 0; i < count; i++) {
+    memcpy(logWriter.buf + logWriter.tail, vector[i].iov_base,
+           vector[i].iov_len);
+    logWriter.tail += vector[i].iov_len;
+  }
+  logWriter.queued++;
+  if (logWriter.tail - logWriter.head > logWriter.peak)
+    logWriter.peak = logWriter.tail - logWriter.head;
+
+  /* send it along once there's enough for a decent write */
+  if (logWriter.tail - logWriter.head >= LOG_BUFSIZE)
+    log_writer_flush(0);
+  return 1;
+}
+
+/** State of the binary connection event log. */
+static struct {
+  int fd;                     /**< Event log file, or -1. */
+  int failed;                 /**< Set when the file could not be opened. */
+  struct EventLogHeader *map; /**< Mapped event log file, or NULL. */
+  size_t size;                /**< Length of the mapping. */
+  unsigned int capacity;      /**< Number of records the mapping holds. */
+  unsigned int written;       /**< Records written since startup. */
+  unsigned int rotated;       /**< Files rotated since startup. */
+} eventLog = { -1, 0, 0, 0, 0, 0, 0 };
+
+/** Smallest event log file we are willing to create. */
+#define EVENTLOG_MIN_SIZE 65536
+
+/** Unmap and close the event log.
+ * The file is cut back to the records actually written.
+ */
+static void
+eventlog_close(void)
+{
+  size_t used;
+
+  if (!eventLog.map)
+    return;
+
+  used = sizeof(struct EventLogHeader)
+    + (size_t)eventLog.map->eh_count * sizeof(struct EventLogRecord);
+  munmap(eventLog.map, eventLog.size);
+  if (ftruncate(eventLog.fd, used))
+    log_write(LS_SYSTEM, L_WARNING, 0, "Unable to truncate event log: %s",
+              strerror(errno));
+  close(eventLog.fd);
+
+  eventLog.map = 0;
+  eventLog.fd = -1;
+}
+
+/** Open and map the event log named by FEAT_EVENTLOG.
+ * An existing event log is appended to; the file is grown to
+ * FEAT_EVENTLOG_SIZE so that records can be stored straight into the
+ * mapping.  The blocks are allocated up front: a store into a hole
+ * that the disk cannot fill would raise SIGBUS.
+ * @return Non-zero if the event log is ready for records.
+ */
+static int
+eventlog_open(void)
+{
+  const char *file = feature_str(FEAT_EVENTLOG);
+  struct EventLogHeader hdr;
+  struct stat sb;
+  size_t size;
+  void *map;
+  int fd, err, resume = 0;
+
+  if (eventLog.map)
+    return 1;
+  if (!file || eventLog.failed)
+    return 0;
+
+  size = feature_int(FEAT_EVENTLOG_SIZE);
+  if (size < EVENTLOG_MIN_SIZE)
+    size = EVENTLOG_MIN_SIZE;
+
+  if ((fd = open(file, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR)) < 0)
+    goto error;
+  if (fstat(fd, &sb))
+    goto error;
+
+  if (sb.st_size > 0) {
+    /* only ever append to a file we wrote ourselves */
+    if (sb.st_size < (off_t)sizeof(hdr)
+        || read(fd, &hdr, sizeof(hdr)) != sizeof(hdr)
+        || memcmp(hdr.eh_magic, EVENTLOG_MAGIC, sizeof(hdr.eh_magic))
+        || hdr.eh_byteorder != EVENTLOG_BYTEORDER
+        || hdr.eh_recsize != sizeof(struct EventLogRecord)
+        || sizeof(hdr) + (size_t)hdr.eh_count * hdr.eh_recsize
+           > (size_t)sb.st_size) {
+      log_write(LS_SYSTEM, L_ERROR, 0, "Event log %s is not an event log",
+                file);
+      close(fd);
+      eventLog.failed = 1;
+      return 0;
+    }
+    resume = 1;
+    if ((size_t)sb.st_size > size)
+      size = sb.st_size;
+  }
+
+  if ((err = posix_fallocate(fd, 0, size))) {
+    errno = err;
+    goto error;
+  }
+  map = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED)
+    goto error;
+
+  eventLog.fd = fd;
+  eventLog.map = map;
+  eventLog.size = size;
+  eventLog.capacity = (size - sizeof(hdr)) / sizeof(struct EventLogRecord);
+
+  if (!resume) {
+    memset(eventLog.map, 0, sizeof(hdr));
+    memcpy(eventLog.map->eh_magic, EVENTLOG_MAGIC,
+           sizeof(eventLog.map->eh_magic));
+    eventLog.map->eh_byteorder = EVENTLOG_BYTEORDER;
+    eventLog.map->eh_recsize = sizeof(struct EventLogRecord);
+    eventLog.map->eh_created = CurrentTime;
+    ircd_strncpy(eventLog.map->eh_server, cli_name(&me),
+                 sizeof(eventLog.map->eh_server) - 1);
+  }
+  return 1;
+
+ error:
+  log_write(LS_SYSTEM, L_ERROR, 0, "Unable to open event log %s: %s", file,
+            strerror(errno));
+  if (fd >= 0)
+    close(fd);
+  eventLog.failed = 1; /* don't try again until it's reconfigured */
+  return 0;
+}
+
+/** Move a full event log aside and start a new one.
+ * The old file gets the current time appended to its name, plus a
+ * sequence number if a file by that name already exists.
+ * @return Non-zero if the new event log is ready for records.
+ */
+static int
+eventlog_rotate(void)
+{
+  const char *file = feature_str(FEAT_EVENTLOG);
+  char name[BUFSIZE];
+  unsigned int seq = 0;
+  int res;
+
+  eventlog_close();
+  /* link() will not replace an existing file, unlike rename() */
+  ircd_snprintf(0, name, sizeof(name), "%s.%Tu", file, CurrentTime);
+  while ((res = link(file, name)) && errno == EEXIST && ++seq < 1000)
+    ircd_snprintf(0, name, sizeof(name), "%s.%Tu.%u", file, CurrentTime,
+                  seq);
+  if (res || unlink(file)) {
+    log_write(LS_SYSTEM, L_ERROR, 0, "Unable to rotate event log %s: %s",
+              file, strerror(errno));
+    eventLog.failed = 1;
+    return 0;
+  }
+  eventLog.rotated++;
+  return eventlog_open();
+}
+
+/** Record a connection event in the binary event log.
+ * This stores one fixed-size record straight into the mapped file;
+ * the kernel writes it out in its own time.
+ * @param[in] type Kind of event.
+ * @param[in] cptr Local connection the event happened to.
+ */
+void
+log_event(enum EventLogType type, struct Client *cptr)
+{
+  struct EventLogRecord *er;
+
+  if (!eventlog_open())
+    return;
+  if (eventLog.map->eh_count >= eventLog.capacity && !eventlog_rotate())
+    return;
+
+  er = (struct EventLogRecord *)(eventLog.map + 1) + eventLog.map->eh_count;
+  memset(er, 0, sizeof(*er));
+  er->er_time = CurrentTime;
+  er->er_sendB = cli_sendB(cptr);
+  er->er_receiveB = cli_receiveB(cptr);
+  memcpy(er->er_ip, &cli_ip(cptr), sizeof(er->er_ip));
+  if (type == EVENTLOG_EXIT)
+    er->er_duration = CurrentTime - cli_firsttime(cptr);
+  if (cli_listener(cptr))
+    er->er_port = cli_listener(cptr)->addr.port;
+  er->er_type = type;
+  if (IsUser(cptr)) {
+    er->er_flags |= EVENTLOG_F_USER;
+    ircd_snprintf(0, er->er_numeric, sizeof(er->er_numeric), "%s%s",
+                  NumNick(cptr));
+  } else if (IsServer(cptr)) {
+    er->er_flags |= EVENTLOG_F_SERVER;
+    ircd_strncpy(er->er_numeric, NumServ(cptr), sizeof(er->er_numeric) - 1);
+  }
+  if (type != EVENTLOG_CONNECT)
+    ircd_strncpy(er->er_class, get_client_class(cptr),
+                 sizeof(er->er_class) - 1);
+
+  eventLog.map->eh_count++;
+  eventLog.written++;
+}
+
+/** Handle a change to EVENTLOG or EVENTLOG_SIZE.
+ * The current file is closed; the next event opens the new one.
+ */
+void
+log_feature_eventlog(void)
+{
+  eventlog_close();
+  eventLog.failed = 0;
+}
+
+/** Report log writer and event log statistics and memory use.
+ * @param[in] cptr Client requesting information.
+ */
+void
+log_count_memory(struct Client *cptr)
+{
+  send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
+             ":Log buffer %zu(%zu) peak %zu queued %u dropped %u direct %u "
+             "stalls %u writer %s", logWriter.tail - logWriter.head,
+             logWriter.size, logWriter.peak, logWriter.queued,
+             logWriter.dropped, logWriter.sync, logWriter.stalls,
+             logWriter.fd >= 0 ? "running" : "stopped");
+  if (feature_str(FEAT_EVENTLOG))
+    send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
+               ":Event log %s %u(%u) written %u rotated %u",
+               eventLog.map ? "open" : "closed",
+               eventLog.map ? eventLog.map->eh_count : 0, eventLog.capacity,
+               eventLog.written, eventLog.rotated);
+}
+
 /** Helper routine to open a log file if needed.
  * If the log file is already open, do nothing.
  * @param[in,out] lf Log file to open.
@@ -299,23 +972,9 @@ log_init(const char *process_name)
   openlog(logInfo.procname, LOG_PID | LOG_NDELAY, logInfo.facility);
 }
 
-/** Reopen log files (so admins can do things like rotate log files). */
-void
-log_reopen(void)
-{
-  log_close(); /* close everything...we reopen on demand */
-
-#ifdef DEBUGMODE
-  log_debug_reopen(); /* reopen debugging log if necessary */
-#endif /* DEBUGMODE */
-
-  /* reopen syslog, if needed; default facility: LOG_USER */
-  openlog(logInfo.procname, LOG_PID | LOG_NDELAY, logInfo.facility);
-}
-
-/** Close all log files. */
-void
-log_close(void)
+/** Close log files and syslog, leaving the log writer running. */
+static void
+log_close_files(void)
 {
   struct LogFile *ptr;
 
@@ -336,6 +995,38 @@ log_close(void)
   }
 }
 
+/** Reopen log files (so admins can do things like rotate log files). */
+void
+log_reopen(void)
+{
+  log_close_files(); /* close everything...we reopen on demand */
+  log_feature_eventlog();
+
+  if (logWriter.fd >= 0) /* ask the writer to do the same */
+    log_writer_queue(-1, 0, 0, 0);
+  else /* or try to restart it */
+    log_writer_start();
+
+#ifdef DEBUGMODE
+  log_debug_reopen(); /* reopen debugging log if necessary */
+#endif /* DEBUGMODE */
+
+  /* reopen syslog, if needed; default facility: LOG_USER */
+  openlog(logInfo.procname, LOG_PID | LOG_NDELAY, logInfo.facility);
+}
+
+/** Close all log files.
+ * This also hands everything queued to the log writer and stops it.
+ */
+void
+log_close(void)
+{
+  log_writer_flush(1);
+  log_writer_stop();
+  log_close_files();
+  eventlog_close();
+}
+
 /** Write a logging entry.
  * @param[in] subsys Target subsystem.
  * @param[in] severity Severity of message.
@@ -440,13 +1131,26 @@ log_vwrite(enum LogSys subsys, enum LogLevel severity, unsigned int flags,
     vector[2].iov_base = (void*) "\n"; /* terminate lines with a \n */
     vector[2].iov_len = 1;
 
-    /* write it out to the log file */
-    writev(desc->file->fd, vector, 3);
+    /* write it out to the log file, or have the log writer do it;
+     * critical messages are written directly, after whatever the
+     * writer accepts within LOG_WRITER_WAIT */
+    if (severity == L_CRIT)
+      log_writer_flush(1);
+    if (severity == L_CRIT || desc->file == logInfo.dbfile
+        || !log_writer_queue(-1, desc->file->file, vector, 3)) {
+      logWriter.sync++;
+      writev(desc->file->fd, vector, 3);
+    }
   }
 
   /* oh yeah, syslog it too... */
-  if (flags & LOG_DOSYSLOG)
-    syslog(ldata->syslog | desc->facility, "%s", buf);
+  if (flags & LOG_DOSYSLOG) {
+    vector[1].iov_base = buf;
+    if (severity == L_CRIT
+        || !log_writer_queue(ldata->syslog | desc->facility, 0,
+                             &vector[1], 1))
+      syslog(ldata->syslog | desc->facility, "%s", buf);
+  }
 
   /* can't forget server notices... */
   if (flags & LOG_DOSNOTICE)
@@ -32,6 +32,7 @@
 #include "ircd.h"
 #include "ircd_alloc.h"
 #include "ircd_chattr.h"
+#include "ircd_intern.h"
 #include "ircd_log.h"
 #include "ircd_reply.h"
 #include "ircd_snprintf.h"
@@ -74,6 +75,7 @@
 
   /* Now all the globals we need :/... */
   static int tping, tconn, maxlinks, sendq, port, invert, stringno, flags;
+  static int workers;
   static char *name, *pass, *host, *ip, *username, *origin, *hub_limit;
   struct SLink *hosts;
   static char *stringlist[MAX_STRINGS];
@@ -220,6 +222,7 @@ static void free_slist(struct SLink **link) {
 %token FAST
 %token AUTOCONNECT
 %token PROGRAM
+%token WORKERS
 %token TOK_IPV4 TOK_IPV6
 %token DNS
 %token INCLUDE
@@ -345,7 +348,7 @@ jupenick: NICK '=' QSTRING ';'
 {
   if (permitted(BLOCK_JUPE, 0))
   {
-    addNickJupes($3);
+    conf_defer_jupe($3);
     MyFree($3);
   }
 };
@@ -402,7 +405,6 @@ generaldesc: DESCRIPTION '=' QSTRING ';'
   {
     MyFree(localConf.description);
     localConf.description = $3;
-    ircd_strncpy(cli_info(&me), $3, REALLEN);
   }
 };
 
@@ -451,7 +453,7 @@ generaldnsserver: DNS SERVER '=' QSTRING ';'
 {
   char *server = $4;
 
-  add_nameserver(server);
+  conf_defer_nameserver(server);
   MyFree(server);
 };
 
@@ -837,7 +839,7 @@ portblock: PORT '{' portitems '}' ';'
     }
     if (link->flags & 65535)
       port = link->flags & 65535;
-    add_listener(port, link->value.cp, pass, &flags_here);
+    conf_defer_port(port, link->value.cp, pass, &flags_here);
   }
   free_slist(&hosts);
   MyFree(pass);
@@ -1136,7 +1138,7 @@ motdblock: MOTD '{' motditems '}' ';'
 
   if (permitted(BLOCK_MOTD, 1) && pass != NULL) {
     for (link = hosts; link != NULL; link = link->next)
-      motd_add(link->value.cp, pass);
+      conf_defer_motd(link->value.cp, pass);
   }
 
   free_slist(&hosts);
@@ -1173,7 +1175,7 @@ featureitem: QSTRING
 } '=' stringlist ';' {
   int ii;
   if (permitted(BLOCK_FEATURES, 0))
-    feature_set(NULL, (const char * const *)stringlist, stringno);
+    conf_defer_feature(stringno, (const char * const *)stringlist);
   for (ii = 0; ii < stringno; ++ii)
     MyFree(stringlist[ii]);
 };
@@ -1227,7 +1229,8 @@ pseudoitems '}' ';'
     parse_error("Pseudo command %s invalid: must all be letters", smap->command);
   else
     valid = 1;
-  if (valid && register_mapping(smap))
+  /* The mapping is registered when the configuration is installed. */
+  if (valid)
   {
     smap->next = GlobalServiceMapList;
     GlobalServiceMapList = smap;
@@ -1273,16 +1276,17 @@ pseudoflags: FAST ';'
 iauthblock: IAUTH '{' iauthitems '}' ';'
 {
   if (permitted(BLOCK_IAUTH, 1))
-    auth_spawn(stringno, stringlist);
+    conf_defer_iauth(stringno, (const char * const *)stringlist, workers);
   while (stringno > 0)
   {
     --stringno;
     MyFree(stringlist[stringno]);
   }
+  workers = 0;
 };
 
 iauthitems: iauthitem iauthitems | iauthitem;
-iauthitem: iauthprogram;
+iauthitem: iauthprogram | iauthworkers;
 iauthprogram: PROGRAM '='
 {
   while (stringno > 0)
@@ -1291,6 +1295,10 @@ iauthprogram: PROGRAM '='
     MyFree(stringlist[stringno]);
   }
 } stringlist ';';
+iauthworkers: WORKERS '=' expr ';'
+{
+  workers = $3;
+};
 
 includeblock: INCLUDE blocklimit QSTRING ';' {
   struct ConfigBlocks *child;
@@ -106,10 +106,12 @@ struct dlink
 struct reslist
 {
   struct dlink node;       /**< Doubly linked list node. */
+  struct reslist *id_next; /**< Next request in the same ID bucket. */
   int id;                  /**< Request ID (from request header). */
   int sent;                /**< Number of requests sent. */
   request_state state;     /**< State the resolver machine is in. */
   char type;               /**< Current request type. */
+  char qtype;              /**< Type of the original forward query. */
   char retries;            /**< Retry counter. */
   char sends;              /**< Number of sends (>1 means resent). */
   char resend;             /**< Send flag; 0 == don't resend. */
@@ -117,12 +119,58 @@ struct reslist
   time_t timeout;          /**< When this request times out. */
   struct irc_in_addr addr; /**< Address for this request. */
   char *name;              /**< Hostname for this request. */
+  unsigned int ttl;        /**< Lowest TTL seen in the answer. */
   dns_callback_f callback; /**< Callback function on completion. */
   void *callback_ctx;      /**< Context pointer for callback. */
 };
 
-/** Base of request list. */
+/** A cached DNS answer.
+ * PTR entries are keyed by address and hold the hostname; forward
+ * entries are keyed by hostname and query type and hold the address.
+ */
+struct rescache
+{
+  struct dlink node;       /**< LRU list node (most recently used last). */
+  struct rescache *hnext;  /**< Next entry in the same hash bucket. */
+  unsigned int hashv;      /**< Hash bucket index. */
+  char type;               /**< Query type (T_PTR, T_A or T_AAAA). */
+  char negative;           /**< Non-zero if the lookup failed. */
+  time_t expires;          /**< When this entry becomes stale. */
+  struct irc_in_addr addr; /**< Address (key for T_PTR, else answer). */
+  char *name;              /**< Hostname (answer for T_PTR, else key). */
+};
+
+/** Number of buckets in the answer cache hash table. */
+#define RES_CACHE_HASHSIZE 4096
+
+/** Number of buckets in the request ID hash table. */
+#define RES_ID_HASHSIZE 1024
+
+/** Base of request list, ordered by timeout. */
 static struct dlink request_list;
+/** Outstanding requests, hashed by request ID. */
+static struct reslist *id_table[RES_ID_HASHSIZE];
+/** Requests answered from the cache, waiting for their callbacks. */
+static struct dlink answer_list;
+/** Timer used to run callbacks for #answer_list. */
+static struct Timer res_answer;
+/** Cached answers, least recently used first. */
+static struct dlink cache_lru;
+/** Hash table of cached answers. */
+static struct rescache *cache_table[RES_CACHE_HASHSIZE];
+/** Number of entries in the answer cache. */
+static int cache_count;
+/** Memory used by the answer cache. */
+static size_t cache_mem;
+
+/** Answer cache statistics. */
+static struct {
+  unsigned int hits;      /**< Lookups answered with an address or name. */
+  unsigned int neg_hits;  /**< Lookups answered with a cached failure. */
+  unsigned int misses;    /**< Lookups that had to query a nameserver. */
+  unsigned int expired;   /**< Entries dropped because their TTL ran out. */
+  unsigned int evicted;   /**< Entries dropped to stay under the size limit. */
+} cache_stats;
 
 static void rem_request(struct reslist *request);
 static struct reslist *make_request(dns_callback_f callback, void *ctx);
@@ -137,6 +185,8 @@ static int send_res_msg(const char *buf, int len, int count);
 static void resend_query(struct reslist *request);
 static int proc_answer(struct reslist *request, HEADER *header, char *, char *);
 static struct reslist *find_id(int id);
+static void del_id(struct reslist *request);
+static void schedule_request(struct reslist *request);
 static void res_readreply(struct Event *ev);
 static void timeout_resolver(struct Event *notused);
 
@@ -187,6 +237,13 @@ restart_resolver(void)
   if (!request_list.next)
     request_list.next = request_list.prev = &request_list;
 
+  if (!answer_list.next)
+  {
+    answer_list.next = answer_list.prev = &answer_list;
+    cache_lru.next = cache_lru.prev = &cache_lru;
+    timer_init(&res_answer);
+  }
+
   /* Check which address family (or families) our nameservers use. */
   for (need_v4 = need_v6 = ns = 0; ns < irc_nscount; ns++)
   {
@@ -264,6 +321,8 @@ add_dlink(struct dlink *node, struct dlink *next)
 static void
 rem_request(struct reslist *request)
 {
+  if (request->id >= 0)
+    del_id(request);
   /* remove from dlist */
   request->node.prev->next = request->node.next;
   request->node.next->prev = request->node.prev;
@@ -293,14 +352,269 @@ make_request(dns_callback_f callback, void *ctx)
   request->retries = feature_int(FEAT_IRCD_RES_RETRIES);
   request->resend  = 1;
   request->timeout = feature_int(FEAT_IRCD_RES_TIMEOUT);
+  request->ttl     = ~0u;
+  request->id      = -1;
   memset(&request->addr, 0, sizeof(request->addr));
   request->callback = callback;
   request->callback_ctx = ctx;
 
-  add_dlink(&request->node, &request_list);
+  schedule_request(request);
   return(request);
 }
 
+/** Remove a node from a doubly linked list.
+ * @param[in,out] node Node to unlink.
+ */
+static void
+rem_dlink(struct dlink *node)
+{
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+}
+
+/** Calculate the cache bucket for an address.
+ * IPv4 addresses hash the same whether or not they are v4-mapped.
+ * @param[in] addr Address to hash.
+ * @return Hash bucket index.
+ */
+static unsigned int
+rescache_hash_addr(const struct irc_in_addr *addr)
+{
+  unsigned int hashv = 0;
+  int ii;
+
+  if (irc_in_addr_is_ipv4(addr))
+    hashv = (addr->in6_16[6] << 16) ^ addr->in6_16[7];
+  else
+    for (ii = 0; ii < 8; ++ii)
+      hashv = (hashv << 5) + hashv + addr->in6_16[ii];
+  hashv ^= hashv >> 13;
+  return hashv % RES_CACHE_HASHSIZE;
+}
+
+/** Calculate the cache bucket for a hostname and query type.
+ * @param[in] name Hostname to hash (case insensitively).
+ * @param[in] type Query type.
+ * @return Hash bucket index.
+ */
+static unsigned int
+rescache_hash_name(const char *name, int type)
+{
+  unsigned int hashv = type;
+
+  while (*name)
+    hashv = (hashv << 5) + hashv + ToLower(*name++);
+  return hashv % RES_CACHE_HASHSIZE;
+}
+
+/** Drop an entry from the answer cache and free it.
+ * @param[in] entry Cache entry to remove.
+ */
+static void
+rescache_remove(struct rescache *entry)
+{
+  struct rescache **pp;
+
+  for (pp = &cache_table[entry->hashv]; *pp != entry; pp = &(*pp)->hnext)
+    assert(*pp != NULL);
+  *pp = entry->hnext;
+  rem_dlink(&entry->node);
+
+  --cache_count;
+  cache_mem -= sizeof(*entry);
+  if (entry->name)
+    cache_mem -= strlen(entry->name) + 1;
+  MyFree(entry->name);
+  MyFree(entry);
+}
+
+/** Evict least recently used cache entries until at most \a max remain.
+ * @param[in] max Number of entries to keep.
+ */
+static void
+rescache_trim(int max)
+{
+  while (cache_count > max && cache_count > 0)
+  {
+    rescache_remove((struct rescache *)cache_lru.next);
+    ++cache_stats.evicted;
+  }
+}
+
+/** Apply a new value of FEAT_IRCD_RES_CACHE_SIZE to the answer cache. */
+void
+resolver_cache_resize(void)
+{
+  if (cache_lru.next)
+    rescache_trim(IRCD_MAX(feature_int(FEAT_IRCD_RES_CACHE_SIZE), 0));
+}
+
+/** Find a cache entry by key.
+ * @param[in] hashv Hash bucket for the key.
+ * @param[in] type Query type.
+ * @param[in] addr Address key (for T_PTR).
+ * @param[in] name Hostname key (for T_A and T_AAAA).
+ * @return Matching cache entry, or NULL if there is none.
+ */
+static struct rescache *
+rescache_lookup(unsigned int hashv, int type, const struct irc_in_addr *addr,
+                const char *name)
+{
+  struct rescache *entry;
+
+  for (entry = cache_table[hashv]; entry; entry = entry->hnext)
+    if (entry->type == type
+        && !(type == T_PTR ? irc_in_addr_cmp(&entry->addr, addr)
+             : ircd_strcmp(entry->name, name)))
+      break;
+  return entry;
+}
+
+/** Look up a cached answer.
+ * For T_PTR entries, \a addr is the key; otherwise \a name is.
+ * Stale entries are dropped, and a hit becomes most recently used.
+ * @param[in] type Query type.
+ * @param[in] addr Address to look up (for T_PTR).
+ * @param[in] name Hostname to look up (for T_A and T_AAAA).
+ * @return Matching cache entry, or NULL if there is none.
+ */
+static struct rescache *
+rescache_find(int type, const struct irc_in_addr *addr, const char *name)
+{
+  struct rescache *entry;
+
+  if (feature_int(FEAT_IRCD_RES_CACHE_SIZE) <= 0)
+    return NULL;
+  if (!resolver_started())
+    restart_resolver();
+
+  entry = rescache_lookup((type == T_PTR) ? rescache_hash_addr(addr)
+                          : rescache_hash_name(name, type),
+                          type, addr, name);
+  if (entry && entry->expires <= CurrentTime)
+  {
+    rescache_remove(entry);
+    ++cache_stats.expired;
+    entry = NULL;
+  }
+
+  if (!entry)
+  {
+    ++cache_stats.misses;
+    return NULL;
+  }
+
+  rem_dlink(&entry->node);
+  add_dlink(&entry->node, &cache_lru);
+  if (entry->negative)
+    ++cache_stats.neg_hits;
+  else
+    ++cache_stats.hits;
+  return entry;
+}
+
+/** Remember the result of a lookup.
+ * @param[in] type Query type.
+ * @param[in] addr Address (key for T_PTR, else answer; NULL if negative).
+ * @param[in] name Hostname (answer for T_PTR, else key; NULL if negative).
+ * @param[in] ttl Number of seconds the answer may be cached.
+ */
+static void
+rescache_add(int type, const struct irc_in_addr *addr, const char *name,
+             unsigned int ttl)
+{
+  struct rescache *entry;
+  unsigned int hashv;
+  int max = feature_int(FEAT_IRCD_RES_CACHE_SIZE);
+
+  if (max <= 0 || ttl == 0 || !cache_lru.next)
+    return;
+
+  /* A lookup that raced with another for the same key replaces it. */
+  hashv = (type == T_PTR) ? rescache_hash_addr(addr)
+    : rescache_hash_name(name, type);
+  if ((entry = rescache_lookup(hashv, type, addr, name)))
+    rescache_remove(entry);
+  rescache_trim(max - 1);
+
+  entry = (struct rescache *)MyCalloc(1, sizeof(*entry));
+  entry->hashv = hashv;
+  entry->type = type;
+  entry->negative = (type == T_PTR) ? (name == NULL) : (addr == NULL);
+  entry->expires = CurrentTime + ttl;
+  if (addr)
+    memcpy(&entry->addr, addr, sizeof(entry->addr));
+  if (name)
+  {
+    DupString(entry->name, name);
+    cache_mem += strlen(name) + 1;
+  }
+
+  entry->hnext = cache_table[hashv];
+  cache_table[hashv] = entry;
+  add_dlink(&entry->node, &cache_lru);
+  ++cache_count;
+  cache_mem += sizeof(*entry);
+}
+
+/** Deliver the answers queued on #answer_list.
+ * @param[in] ev Timer event data (ignored).
+ */
+static void
+answer_cached(struct Event *ev)
+{
+  struct reslist *request;
+
+  if (ev_type(ev) != ET_EXPIRE)
+    return;
+
+  /* Callbacks may delete other queued answers, so always restart at
+   * the head of the list.
+   */
+  while (answer_list.next != &answer_list)
+  {
+    request = (struct reslist *)answer_list.next;
+    rem_dlink(&request->node);
+    Debug((DEBUG_DNS, "Request %p answered from cache", request));
+    if (request->name)
+      (*request->callback)(request->callback_ctx, &request->addr, request->name);
+    else
+      (*request->callback)(request->callback_ctx, NULL, NULL);
+    MyFree(request->name);
+    MyFree(request);
+  }
+}
+
+/** Queue a cached answer for delivery to a callback.
+ * Callers expect their callbacks to run after gethost_byname() or
+ * gethost_byaddr() returns, so the answer is delivered from a timer.
+ * @param[in] callback Function to call with the answer.
+ * @param[in] ctx Context parameter for \a callback.
+ * @param[in] addr Resolved address (NULL for a negative answer).
+ * @param[in] name Resolved hostname (NULL for a negative answer).
+ */
+static void
+answer_from_cache(dns_callback_f callback, void *ctx,
+                  const struct irc_in_addr *addr, const char *name)
+{
+  struct reslist *request;
+
+  request = (struct reslist *)MyCalloc(1, sizeof(struct reslist));
+  request->state = REQ_IDLE;
+  request->id = -1;
+  request->callback = callback;
+  request->callback_ctx = ctx;
+  if (addr && name)
+  {
+    memcpy(&request->addr, addr, sizeof(request->addr));
+    DupString(request->name, name);
+  }
+  add_dlink(&request->node, &answer_list);
+
+  if (!t_onqueue(&res_answer))
+    timer_add(&res_answer, answer_cached, NULL, TT_RELATIVE, 0);
+}
+
 /** Make sure that a timeout event will happen by the given time.
  * @param[in] when Latest time for timeout to run.
  */
@@ -310,13 +624,37 @@ check_resolver_timeout(time_t when)
   if (when > CurrentTime + AR_TTL)
     when = CurrentTime + AR_TTL;
   /* TODO after 2.10.12: Rewrite the timer API because there should be
-   * no need for clients to know this kind of implementation detail. */
-  if (when > t_expire(&res_timeout))
-    /* do nothing */;
-  else if (t_onqueue(&res_timeout) && !(res_timeout.t_header.gh_flags & GEN_MARKED))
-    timer_chg(&res_timeout, TT_ABSOLUTE, when);
-  else
+   * no need for clients to know this kind of implementation detail.
+   * A timer that is not queued (or is running its callback right now)
+   * has a stale t_expire, so it must always be (re-)added.
+   */
+  if (!t_onqueue(&res_timeout) || (res_timeout.t_header.gh_flags & GEN_MARKED))
     timer_add(&res_timeout, timeout_resolver, NULL, TT_ABSOLUTE, when);
+  else if (when < t_expire(&res_timeout))
+    timer_chg(&res_timeout, TT_ABSOLUTE, when);
+}
+
+/** Put a request into #request_list according to its timeout.
+ * Timeouts are nearly always later than those of requests already in
+ * the list, so the search starts from the tail.
+ * @param[in] request Request to (re-)insert; may already be listed.
+ */
+static void
+schedule_request(struct reslist *request)
+{
+  struct dlink *ptr;
+  time_t timeout = request->sentat + request->timeout;
+
+  if (request->node.next)
+    rem_dlink(&request->node);
+
+  for (ptr = request_list.prev; ptr != &request_list; ptr = ptr->prev)
+  {
+    struct reslist *other = (struct reslist*)ptr;
+    if (other->sentat + other->timeout <= timeout)
+      break;
+  }
+  add_dlink(&request->node, ptr->next);
 }
 
 /** Drop pending DNS lookups which have timed out.
@@ -325,44 +663,42 @@ check_resolver_timeout(time_t when)
 static void
 timeout_resolver(struct Event *ev)
 {
-  struct dlink *ptr, *next_ptr;
   struct reslist *request;
-  time_t next_time = 0;
-  time_t timeout   = 0;
+  time_t next_time;
 
   if (ev_type(ev) != ET_EXPIRE)
     return;
 
-  for (ptr = request_list.next; ptr != &request_list; ptr = next_ptr)
+  /* Callbacks may remove other requests, so always restart at the
+   * head of the list.
+   */
+  while (request_list.next != &request_list)
   {
-    next_ptr = ptr->next;
-    request = (struct reslist*)ptr;
-    timeout = request->sentat + request->timeout;
+    request = (struct reslist*)request_list.next;
+    if (CurrentTime < request->sentat + request->timeout)
+      break;
 
-    if (CurrentTime >= timeout)
+    if (--request->retries <= 0)
     {
-      if (--request->retries <= 0)
-      {
-        Debug((DEBUG_DNS, "Request %p out of retries; destroying", request));
-        (*request->callback)(request->callback_ctx, NULL, NULL);
-        rem_request(request);
-        continue;
-      }
-      else
-      {
-        request->sentat = CurrentTime;
-        request->timeout += request->timeout;
-        resend_query(request);
-      }
+      Debug((DEBUG_DNS, "Request %p out of retries; destroying", request));
+      (*request->callback)(request->callback_ctx, NULL, NULL);
+      rem_request(request);
     }
-
-    if ((next_time == 0) || timeout < next_time)
+    else
     {
-      next_time = timeout;
+      request->sentat = CurrentTime;
+      request->timeout += request->timeout;
+      resend_query(request);
+      schedule_request(request);
     }
   }
 
-  if (next_time <= CurrentTime)
+  if (request_list.next != &request_list)
+  {
+    request = (struct reslist*)request_list.next;
+    next_time = request->sentat + request->timeout;
+  }
+  else
     next_time = CurrentTime + AR_TTL;
   check_resolver_timeout(next_time);
 }
@@ -389,6 +725,18 @@ delete_resolver_queries(const void *vptr)
       }
     }
   }
+
+  if (answer_list.next) {
+    for (ptr = answer_list.next; ptr != &answer_list; ptr = next_ptr)
+    {
+      next_ptr = ptr->next;
+      request = (struct reslist*)ptr;
+      if (vptr == request->callback_ctx) {
+        Debug((DEBUG_DNS, "Removing cached answer %p with vptr %p", request, vptr));
+        rem_request(request);
+      }
+    }
+  }
 }
 
 /** Send a message to all of our nameservers.
@@ -426,13 +774,10 @@ send_res_msg(const char *msg, int len, int rcount)
 static struct reslist *
 find_id(int id)
 {
-  struct dlink *ptr;
   struct reslist *request;
 
-  for (ptr = request_list.next; ptr != &request_list; ptr = ptr->next)
+  for (request = id_table[id % RES_ID_HASHSIZE]; request; request = request->id_next)
   {
-    request = (struct reslist*)ptr;
-
     if (request->id == id) {
       Debug((DEBUG_DNS, "find_id(%d) -> %p", id, request));
       return(request);
@@ -443,6 +788,37 @@ find_id(int id)
   return(NULL);
 }
 
+/** Index a request by its ID.
+ * @param[in] request Request whose ID has just been assigned.
+ */
+static void
+add_id(struct reslist *request)
+{
+  struct reslist **bucket = &id_table[request->id % RES_ID_HASHSIZE];
+
+  request->id_next = *bucket;
+  *bucket = request;
+}
+
+/** Remove a request from the ID index.
+ * @param[in] request Request to remove.
+ */
+static void
+del_id(struct reslist *request)
+{
+  struct reslist **pp;
+
+  for (pp = &id_table[request->id % RES_ID_HASHSIZE]; *pp; pp = &(*pp)->id_next)
+  {
+    if (*pp == request)
+    {
+      *pp = request->id_next;
+      break;
+    }
+  }
+  request->id = -1;
+}
+
 /** Try to look up address for a hostname, trying IPv6 (T_AAAA) first.
  * @param[in] name Hostname to look up.
  * @param[in] callback Function to call upon completion.
@@ -483,7 +859,17 @@ do_query_name(dns_callback_f callback, void *ctx, const char *name,
 
   if (request == NULL)
   {
+    struct rescache *cached;
+
+    if ((cached = rescache_find(type, NULL, host_name)))
+    {
+      answer_from_cache(callback, ctx, cached->negative ? NULL : &cached->addr,
+                        cached->name);
+      return;
+    }
+
     request       = make_request(callback, ctx);
+    request->qtype = type;
     DupString(request->name, host_name);
 #ifdef IPV6
     if (type != T_A)
@@ -510,6 +896,20 @@ do_query_number(dns_callback_f callback, void *ctx, const struct irc_in_addr *ad
 {
   char ipbuf[128];
   const unsigned char *cp;
+  struct rescache *cached;
+
+  if (request == NULL && (cached = rescache_find(T_PTR, addr, NULL)))
+  {
+    if (cached->negative)
+      answer_from_cache(callback, ctx, NULL, NULL);
+#ifdef IPV6
+    else if (!irc_in_addr_is_ipv4(addr))
+      do_query_name(callback, ctx, cached->name, NULL, T_AAAA);
+#endif
+    else
+      do_query_name(callback, ctx, cached->name, NULL, T_A);
+    return;
+  }
 
   if (irc_in_addr_is_ipv4(addr))
   {
@@ -555,6 +955,7 @@ do_query_number(dns_callback_f callback, void *ctx, const struct irc_in_addr *ad
     request->type = T_PTR;
     memcpy(&request->addr, addr, sizeof(request->addr));
     request->name = (char *)MyMalloc(HOSTLEN + 1);
+    request->name[0] = '\0';
   }
   Debug((DEBUG_DNS, "Requesting DNS PTR %s as %p", ipbuf, request));
   query_name(ipbuf, C_IN, T_PTR, request);
@@ -586,14 +987,18 @@ query_name(const char *name, int query_class, int type,
      * network byte order, the nameserver does not interpret this value
      * and returns it unchanged
      */
+    if (request->id >= 0)
+      del_id(request);
     do
     {
-      header->id = (header->id + ircrandom()) & 0xffff;
+      header->id = ircrandom() & 0xffff;
     } while (find_id(header->id));
     request->id = header->id;
+    add_id(request);
     ++request->sends;
 
     request->sent += send_res_msg(buf, request_len, request->sends);
+    schedule_request(request);
     check_resolver_timeout(request->sentat + request->timeout);
   }
 }
@@ -637,6 +1042,7 @@ proc_answer(struct reslist *request, HEADER* header, char* buf, char* eob)
   char hostbuf[HOSTLEN + 100]; /* working buffer */
   unsigned char *current;      /* current position in buf */
   int type;                    /* answer type */
+  unsigned int ttl;            /* answer TTL */
   int n;                       /* temp count */
   int rd_length;
 
@@ -689,9 +1095,12 @@ proc_answer(struct reslist *request, HEADER* header, char* buf, char* eob)
     type = irc_ns_get16(current);
     current += TYPE_SIZE;
 
-    /* We do not use the class or TTL values. */
+    /* We do not use the class value. */
     current += CLASS_SIZE;
-    current += TTL_SIZE;
+
+    IRC_NS_GET32(ttl, current);
+    if (ttl < request->ttl)
+      request->ttl = ttl;
 
     rd_length = irc_ns_get16(current);
     current += RDLENGTH_SIZE;
@@ -823,6 +1232,12 @@ res_readreply(struct Event *ev)
          * send any more (no retries granted).
          */
         Debug((DEBUG_DNS, "Request %p has bad response (state %d type %d rcode %d)", request, request->state, request->type, header->rcode));
+        if (request->type == T_PTR)
+          rescache_add(T_PTR, &request->addr, NULL,
+                       feature_int(FEAT_IRCD_RES_CACHE_NEGTTL));
+        else
+          rescache_add(request->qtype, NULL, request->name,
+                       feature_int(FEAT_IRCD_RES_CACHE_NEGTTL));
         (*request->callback)(request->callback_ctx, NULL, NULL);
 	rem_request(request);
     }
@@ -859,7 +1274,7 @@ res_readreply(struct Event *ev)
   {
     if (request->type == T_PTR)
     {
-      if (request->name == NULL)
+      if (request->name == NULL || request->name[0] == '\0')
       {
         /*
          * got a PTR response with no name, something bogus is happening
@@ -875,6 +1290,8 @@ res_readreply(struct Event *ev)
        * Lookup the 'authoritative' name that we were given for the
        * ip#.
        */
+      rescache_add(T_PTR, &request->addr, request->name,
+                   IRCD_MIN(request->ttl, (unsigned int)feature_int(FEAT_IRCD_RES_CACHE_TTL)));
 #ifdef IPV6
       if (!irc_in_addr_is_ipv4(&request->addr))
         do_query_name(request->callback, request->callback_ctx, request->name, NULL, T_AAAA);
@@ -889,6 +1306,8 @@ res_readreply(struct Event *ev)
       /*
        * got a name and address response, client resolved
        */
+      rescache_add(request->qtype, &request->addr, request->name,
+                   IRCD_MIN(request->ttl, (unsigned int)feature_int(FEAT_IRCD_RES_CACHE_TTL)));
       (*request->callback)(request->callback_ctx, &request->addr, request->name);
       Debug((DEBUG_DNS, "Request %p got forward resolution", request));
       rem_request(request);
@@ -947,7 +1366,22 @@ cres_mem(struct Client* sptr)
     }
   }
 
+  if (answer_list.next) {
+    for (dlink = answer_list.next; dlink != &answer_list; dlink = dlink->next) {
+      request = (struct reslist*)dlink;
+      request_mem += sizeof(*request);
+      if (request->name)
+        request_mem += strlen(request->name) + 1;
+      ++request_count;
+    }
+  }
+
+  send_reply(sptr, SND_EXPLICIT | RPL_STATSDEBUG,
+	     ":Resolver: requests %d(%zu) cache %d(%zu)", request_count,
+	     request_mem, cache_count, cache_mem);
   send_reply(sptr, SND_EXPLICIT | RPL_STATSDEBUG,
-	     ":Resolver: requests %d(%d)", request_count, request_mem);
-  return request_mem;
+	     ":Resolver cache: hits %u negative %u misses %u expired %u "
+	     "evicted %u", cache_stats.hits, cache_stats.neg_hits,
+	     cache_stats.misses, cache_stats.expired, cache_stats.evicted);
+  return request_mem + cache_mem + sizeof(cache_table);
 }
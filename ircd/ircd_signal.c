@@ -182,14 +182,15 @@ static void do_unregister_child(pid_t child, int do_call, int status)
   {
     if (crec->cpid == child)
     {
-      if (do_call)
-        crec->call(child, crec->datum, status);
-
+      /* Unlink first, in case the callback registers another child. */
       if (prev)
         prev->next = crec->next;
       else
         children = crec->next;
 
+      if (do_call)
+        crec->call(child, crec->datum, status);
+
       release_crec(crec);
     }
     else
@@ -27,12 +27,14 @@
 #include "ircd.h"
 #include "ircd_alloc.h"
 #include "ircd_events.h"
+#include "ircd_intern.h"
 #include "ircd_log.h"
 #include "ircd_reply.h"
 #include "ircd_string.h"
 #include "listener.h"
 #include "match.h"
 #include "numeric.h"
+#include "numnicks.h"
 #include "res.h"
 #include "s_auth.h"
 #include "s_bsd.h"
@@ -56,11 +58,12 @@ static struct liststats {
   size_t mem;   /**< Memory used by in-use structures. */
 } clients, connections, servs, links;
 
-/** Linked list of currently unused Client structures. */
-static struct Client* clientFreeList;
+/** Slab cache for Client structures. */
+static struct SlabCache clientSlab = SLAB_CACHE_INIT("Client", struct Client);
 
-/** Linked list of currently unused Connection structures. */
-static struct Connection* connectionFreeList;
+/** Slab cache for Connection structures. */
+static struct SlabCache connectionSlab =
+  SLAB_CACHE_INIT("Connection", struct Connection);
 
 /** Linked list of currently unused SLink structures. */
 static struct SLink* slinkFreeList;
@@ -74,48 +77,29 @@ void send_liststats(struct Client *cptr, const struct liststats *lstats,
  */
 void init_list(int maxconn)
 {
-  struct Client* cptr;
-  struct Connection* con;
-  int i;
   /*
    * pre-allocate \a maxconn clients and connections
    */
-  for (i = 0; i < maxconn; ++i) {
-    cptr = (struct Client*) MyMalloc(sizeof(struct Client));
-    cli_next(cptr) = clientFreeList;
-    clientFreeList = cptr;
-    clients.alloc++;
-
-    con = (struct Connection*) MyMalloc(sizeof(struct Connection));
-    con_next(con) = connectionFreeList;
-    connectionFreeList = con;
-    connections.alloc++;
-  }
+  slab_reserve(&clientSlab, maxconn);
+  slab_reserve(&connectionSlab, maxconn);
 }
 
-/** Allocate a new Client structure.
- * If #clientFreeList != NULL, use the head of that list.
- * Otherwise, allocate a new structure.
+/** Allocate a new Client structure from #clientSlab.
  * @return Newly allocated Client.
  */
 static struct Client* alloc_client(void)
 {
-  struct Client* cptr = clientFreeList;
-
-  if (!cptr) {
-    cptr = (struct Client*) MyMalloc(sizeof(struct Client));
-    clients.alloc++;
-  } else
-    clientFreeList = cli_next(cptr);
+  struct Client* cptr = slab_alloc(&clientSlab);
 
   clients.inuse++;
 
   memset(cptr, 0, sizeof(struct Client));
+  cli_info(cptr) = intern_empty;
 
   return cptr;
 }
 
-/** Release a Client structure by prepending it to #clientFreeList.
+/** Release a Client structure back to #clientSlab.
  * @param[in] cptr Client that is no longer being used.
  */
 static void dealloc_client(struct Client* cptr)
@@ -125,26 +109,18 @@ static void dealloc_client(struct Client* cptr)
 
   --clients.inuse;
 
-  cli_next(cptr) = clientFreeList;
-  clientFreeList = cptr;
-
+  intern_release(cli_info(cptr));
   cli_magic(cptr) = 0;
+
+  slab_free(&clientSlab, cptr);
 }
 
-/** Allocate a new Connection structure.
- * If #connectionFreeList != NULL, use the head of that list.
- * Otherwise, allocate a new structure.
+/** Allocate a new Connection structure from #connectionSlab.
  * @return Newly allocated Connection.
  */
 static struct Connection* alloc_connection(void)
 {
-  struct Connection* con = connectionFreeList;
-
-  if (!con) {
-    con = (struct Connection*) MyMalloc(sizeof(struct Connection));
-    connections.alloc++;
-  } else
-    connectionFreeList = con_next(con);
+  struct Connection* con = slab_alloc(&connectionSlab);
 
   connections.inuse++;
 
@@ -157,7 +133,7 @@ static struct Connection* alloc_connection(void)
 /** Release a Connection and all memory associated with it.
  * The connection's DNS reply field is freed, its file descriptor is
  * closed, its msgq and sendq are cleared, and its associated Listener
- * is dereferenced.  Then it is prepended to #connectionFreeList.
+ * is dereferenced.  Then it is returned to #connectionSlab.
  * @param[in] con Connection to free.
  */
 static void dealloc_connection(struct Connection* con)
@@ -178,10 +154,9 @@ static void dealloc_connection(struct Connection* con)
 
   --connections.inuse;
 
-  con_next(con) = connectionFreeList;
-  connectionFreeList = con;
-
   con_magic(con) = 0;
+
+  slab_free(&connectionSlab, con);
 }
 
 /** Allocate a new client and initialize it.
@@ -367,8 +342,7 @@ void remove_client_from_list(struct Client *cptr)
       free_user(cli_serv(cptr)->user);
       cli_serv(cptr)->user = 0;
     }
-    if (cli_serv(cptr)->client_list)
-      MyFree(cli_serv(cptr)->client_list);
+    FreeServerYXX(cptr);
     MyFree(cli_serv(cptr)->last_error_msg);
     MyFree(cli_serv(cptr));
     --servs.inuse;
@@ -416,7 +390,7 @@ void verify_client_list(void)
     assert(cli_prev(client) == prev);
     /* Verify that the list hasn't become circular */
     assert(cli_next(client) != GlobalClientList);
-    assert(visited <= clients.alloc);
+    assert(visited <= clients.inuse);
     /* Remember what should precede us */
     prev = client;
   }
@@ -525,9 +499,11 @@ void send_listinfo(struct Client *cptr, char *name)
 
   memset(&total, 0, sizeof(total));
 
+  clients.alloc = clientSlab.sc_slabs * clientSlab.sc_per_slab;
   clients.mem = clients.inuse * sizeof(struct Client);
   send_liststats(cptr, &clients, "Clients", &total);
 
+  connections.alloc = connectionSlab.sc_slabs * connectionSlab.sc_per_slab;
   connections.mem = connections.inuse * sizeof(struct Connection);
   send_liststats(cptr, &connections, "Connections", &total);
 
@@ -24,6 +24,7 @@
 
 #include "client.h"
 #include "ircd.h"
+#include "ircd_intern.h"
 #include "ircd_log.h"
 #include "ircd_reply.h"
 #include "ircd_string.h"
@@ -84,7 +85,7 @@ int ms_account(struct Client* cptr, struct Client* sptr, int parc,
            "timestamp %Tu", parv[2], cli_user(acptr)->acc_create));
   }
 
-  ircd_strncpy(cli_user(acptr)->account, parv[2], ACCOUNTLEN);
+  intern_set(&cli_user(acptr)->account, parv[2], ACCOUNTLEN);
   hide_hostmask(acptr, FLAG_ACCOUNT);
 
   sendcmdto_serv(sptr, CMD_ACCOUNT, cptr,
@@ -39,6 +39,7 @@
 #include "numnicks.h"
 #include "s_conf.h"
 #include "s_misc.h"
+#include "s_serv.h"
 #include "send.h"
 #include "struct.h"
 #include "ircd_snprintf.h"
@@ -48,6 +49,41 @@
 #include <string.h>
 #include <ctype.h>
 
+/** Hash table of the bans on a channel, used by ms_burst() to spot
+ * bans it already has without comparing against every one. */
+struct BanTable {
+  struct Ban** slots;  /**< Open-addressed slots, NULL when empty. */
+  unsigned int mask;   /**< Number of slots minus one. */
+};
+
+/** Hash a ban mask, ignoring case as ircd_strcmp() does.
+ * @param[in] mask Ban mask to hash.
+ * @return Hash value for \a mask.
+ */
+static unsigned int ban_hash(const char *mask)
+{
+  unsigned int hash = 0;
+
+  while (*mask)
+    hash = hash * 33 + ToLower(*mask++);
+  return hash;
+}
+
+/** Find a slot for \a mask in a ban table.
+ * @param[in] table Table to search.
+ * @param[in] mask Ban mask to look for.
+ * @return Slot holding a ban equal to \a mask, or the empty slot where
+ * it would go.
+ */
+static struct Ban** ban_table_find(struct BanTable *table, const char *mask)
+{
+  unsigned int ii = ban_hash(mask) & table->mask;
+
+  while (table->slots[ii] && ircd_strcmp(table->slots[ii]->banstr, mask))
+    ii = (ii + 1) & table->mask;
+  return &table->slots[ii];
+}
+
 /** Find modes in \a parv that may require net.riders to be kicked.
  * \a parv[0] must be a mode string starting with '+', and \a parv
  * must contain enough parameters to satisfy any argument-bearing
@@ -167,10 +203,10 @@ int ms_burst(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
   struct ModeBuf modebuf, *mbuf = 0;
   struct Channel *chptr;
   time_t timestamp;
-  struct Membership *member, *nmember;
+  struct Membership *member;
   struct Ban *lp, **lp_p;
-  unsigned int parse_flags = (MODE_PARSE_FORCE | MODE_PARSE_BURST);
-  int param, nickpos = 0, banpos = 0;
+  unsigned int parse_flags = (MODE_PARSE_FORCE | MODE_PARSE_BURST), ii;
+  int param, nickpos = 0, banpos = 0, was_empty;
   char modestr[BUFSIZE], nickstr[BUFSIZE], banstr[BUFSIZE];
 
   if (parc < 3)
@@ -182,6 +218,8 @@ int ms_burst(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
   if (!(chptr = get_channel(sptr, parv[1], CGT_CREATE)))
     return 0; /* can't create the channel? */
 
+  burst_channel(chptr);
+
   timestamp = atoi(parv[2]);
 
   if (chptr->creationtime)	/* 0 for new (empty) channels,
@@ -257,9 +295,11 @@ int ms_burst(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
       {
         /* Clear any outstanding rogue invites */
         mode_invite_clear(chptr);
-        for (member = chptr->members; member; member = nmember)
+        /* Walk backwards: kicking a local user removes it from the
+         * array, and the channel goes away with its last member. */
+        for (ii = chptr->nlocals; ii-- > 0; )
         {
-          nmember = member->next_member;
+          member = chptr->locals[ii];
           if (!MyUser(member->user) || IsZombie(member))
             continue;
           /* Kick as netrider if key mismatch *or* remote channel is
@@ -284,8 +324,9 @@ int ms_burst(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
   }
 
   /* turn off burst joined flag */
-  for (member = chptr->members; member; member = member->next_member)
-    member->status &= ~(CHFL_BURST_JOINED|CHFL_BURST_ALREADY_OPPED|CHFL_BURST_ALREADY_VOICED);
+  for (ii = 0; ii < chptr->nmembers; ++ii)
+    chptr->members[ii]->status &= ~(CHFL_BURST_JOINED|CHFL_BURST_ALREADY_OPPED|CHFL_BURST_ALREADY_VOICED);
+  was_empty = !chptr->nmembers;
 
   if (!chptr->creationtime) /* mark channel as created during BURST */
     chptr->mode.mode |= MODE_BURSTADDED;
@@ -332,34 +373,43 @@ int ms_burst(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
     case '%': /* parameter contains bans */
       if (parse_flags & MODE_PARSE_SET) {
 	char *banlist = parv[param] + 1, *p = 0, *ban, *ptr;
-	struct Ban *newban;
+	struct Ban *newban, *firstnew = 0, **slot, **tail;
+	struct BanTable table;
+	unsigned int count;
+
+	/*
+	 * Bans we already have are found through a hash table; only
+	 * the bans that were here before this message are checked
+	 * for overlaps with mmatch().  The sender's own list never
+	 * holds overlapping bans, so new bans are not compared
+	 * against each other.
+	 */
+	for (count = 1, ptr = banlist; *ptr; ptr++)
+	  if (*ptr == ' ')
+	    count++;
+	for (tail = &chptr->banlist; *tail; tail = &(*tail)->next)
+	  count++;
+	for (table.mask = 15; table.mask < 2 * count; table.mask = table.mask * 2 + 1)
+	  ;
+	table.slots = MyCalloc(table.mask + 1, sizeof(struct Ban*));
+	for (lp = chptr->banlist; lp; lp = lp->next)
+	  *ban_table_find(&table, lp->banstr) = lp;
 
 	for (ban = ircd_strtok(&p, banlist, " "); ban;
 	     ban = ircd_strtok(&p, 0, " ")) {
 	  ban = collapse(pretty_mask(ban));
 
-	    /*
-	     * Yeah, we should probably do this elsewhere, and make it better
-	     * and more general; this will hold until we get there, though.
-	     * I dislike the current add_banid API... -Kev
-	     *
-	     * I wish there were a better algo. for this than the n^2 one
-	     * shown below *sigh*
-	     */
-	  for (lp = chptr->banlist; lp; lp = lp->next) {
-	    if (!ircd_strcmp(lp->banstr, ban)) {
-	      ban = 0; /* don't add ban */
-	      lp->flags &= ~BAN_BURST_WIPEOUT; /* not wiping out */
-	      break; /* new ban already existed; don't even repropagate */
-	    } else if (!(lp->flags & BAN_BURST_WIPEOUT) &&
-		       !mmatch(lp->banstr, ban)) {
+	  if (*(slot = ban_table_find(&table, ban))) {
+	    (*slot)->flags &= ~BAN_BURST_WIPEOUT; /* not wiping out */
+	    continue; /* new ban already existed; don't even repropagate */
+	  }
+
+	  for (lp = chptr->banlist; lp != firstnew; lp = lp->next) {
+	    if (!(lp->flags & BAN_BURST_WIPEOUT) && !mmatch(lp->banstr, ban)) {
 	      ban = 0; /* don't add ban unless wiping out bans */
 	      break; /* new ban is encompassed by an existing one; drop */
 	    } else if (!mmatch(ban, lp->banstr))
 	      lp->flags |= BAN_OVERLAPPED; /* remove overlapping ban */
-
-	    if (!lp->next)
-	      break;
 	  }
 
 	  if (ban) { /* add the new ban to the end of the list */
@@ -378,12 +428,14 @@ int ms_burst(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
 	    newban->when = TStime();
 	    newban->flags |= BAN_BURSTED;
 	    newban->next = 0;
-	    if (lp)
-	      lp->next = newban; /* link it in */
-	    else
-	      chptr->banlist = newban;
+	    *tail = newban; /* link it in */
+	    tail = &newban->next;
+	    *slot = newban;
+	    if (!firstnew)
+	      firstnew = newban;
 	  }
 	}
+	MyFree(table.slots);
       } 
       param++; /* look at next param */
       break;
@@ -491,7 +543,17 @@ int ms_burst(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
             last_oplevel = oplevel;
 	  }
 
-	  if (!(member = find_member_link(chptr, acptr)))
+	  /* If the channel was empty, anyone already on it was added by
+	   * this message, and add_user_to_channel() puts the newest
+	   * membership first; otherwise search the user's channels. */
+	  if (was_empty)
+	    member = (cli_user(acptr)->channel
+	              && cli_user(acptr)->channel->channel == chptr)
+	      ? cli_user(acptr)->channel : 0;
+	  else
+	    member = find_member_link(chptr, acptr);
+
+	  if (!member)
 	  {
 	    add_user_to_channel(chptr, acptr, current_mode, oplevel);
             if (!(current_mode & CHFL_DELAYED))
@@ -518,6 +580,7 @@ int ms_burst(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
 
   nickstr[nickpos] = '\0';
   banstr[banpos] = '\0';
+  names_cache_invalidate(chptr);
 
   if (parse_flags & MODE_PARSE_SET) {
     modebuf_extract(mbuf, modestr + 1); /* for sending BURST onward */
@@ -533,7 +596,8 @@ int ms_burst(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
 
   if (parse_flags & MODE_PARSE_SET) { /* any modes changed? */
     /* first deal with channel members */
-    for (member = chptr->members; member; member = member->next_member) {
+    for (ii = 0; ii < chptr->nmembers; ++ii) {
+      member = chptr->members[ii];
       if (member->status & CHFL_BURST_JOINED) { /* joined during burst */
 	if ((member->status & CHFL_CHANOP) && !(member->status & CHFL_BURST_ALREADY_OPPED))
 	  modebuf_mode_client(mbuf, MODE_ADD | CHFL_CHANOP, member->user, OpLevel(member));
@@ -547,6 +611,7 @@ int ms_burst(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
 	member->status &= ~(CHFL_CHANNEL_MANAGER | CHFL_CHANOP | CHFL_VOICE);
       }
     }
+    names_cache_invalidate(chptr);
 
     /* Now deal with channel bans */
     lp_p = &chptr->banlist;
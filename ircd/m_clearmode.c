@@ -78,6 +78,7 @@ do_clearmode(struct Client *cptr, struct Client *sptr, struct Channel *chptr,
   struct ModeBuf mbuf;
   struct Ban *link, *next;
   struct Membership *member;
+  unsigned int ii;
 
   /* Ok, so what are we supposed to get rid of? */
   for (; *control; control++) {
@@ -136,7 +137,8 @@ do_clearmode(struct Client *cptr, struct Client *sptr, struct Channel *chptr,
 
   /* Deal with users on the channel */
   if (del_mode & (MODE_BAN | MODE_CHANOP | MODE_VOICE))
-    for (member = chptr->members; member; member = member->next_member) {
+    for (ii = 0; ii < chptr->nmembers; ++ii) {
+      member = chptr->members[ii];
       if (IsZombie(member)) /* we ignore zombies */
 	continue;
 
@@ -155,6 +157,8 @@ do_clearmode(struct Client *cptr, struct Client *sptr, struct Channel *chptr,
 	member->status &= ~CHFL_VOICE;
       }
     }
+  if (del_mode & (MODE_CHANOP | MODE_VOICE))
+    names_cache_invalidate(chptr);
 
   /* And flush the modes to the channel */
   modebuf_flush(&mbuf);
@@ -31,6 +31,7 @@
 #include "msg.h"
 #include "numeric.h"
 #include "numnicks.h"
+#include "s_serv.h"
 #include "send.h"
 #include "channel.h"
 #include "destruct_event.h"
@@ -147,24 +148,28 @@ int ms_destruct(struct Client* cptr, struct Client* sptr, int parc, char* parv[]
      result in that user being on the channel twice). */
 
     struct Membership *member;
+    unsigned int ii;
     struct ModeBuf mbuf;
     struct Ban *link;
 
+    burst_channel(chptr);
+
     /* Next, send all PARTs upstream. */
-    for (member = chptr->members; member; member = member->next_member)
-      sendcmdto_one(member->user, CMD_PART, cptr, "%H", chptr);
+    for (ii = 0; ii < chptr->nmembers; ++ii)
+      sendcmdto_one(chptr->members[ii]->user, CMD_PART, cptr, "%H", chptr);
 
     /* Next, send JOINs for all members. */
-    for (member = chptr->members; member; member = member->next_member)
-      sendcmdto_one(member->user, CMD_JOIN, cptr, "%H", chptr);
+    for (ii = 0; ii < chptr->nmembers; ++ii)
+      sendcmdto_one(chptr->members[ii]->user, CMD_JOIN, cptr, "%H", chptr);
 
     /* Build MODE strings. We use MODEBUF_DEST_BOUNCE with MODE_DEL to assure
        that the resulting MODEs are only sent upstream. */
     modebuf_init(&mbuf, sptr, cptr, chptr, MODEBUF_DEST_SERVER | MODEBUF_DEST_BOUNCE);
 
     /* Op/voice the users as appropriate. We use MODE_DEL because we fake a bounce. */
-    for (member = chptr->members; member; member = member->next_member)
+    for (ii = 0; ii < chptr->nmembers; ++ii)
     {
+      member = chptr->members[ii];
       if (IsChanOp(member))
         modebuf_mode_client(&mbuf, MODE_DEL | MODE_CHANOP, member->user, OpLevel(member));
       if (HasVoice(member))
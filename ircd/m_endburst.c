@@ -73,7 +73,7 @@ int ms_end_of_burst(struct Client* cptr, struct Client* sptr, int parc, char* pa
   /* Count through channels... */
   for (chan = GlobalChannelList; chan; chan = next_chan) {
     next_chan = chan->next;
-    if (!chan->members && (chan->mode.mode & MODE_BURSTADDED)) {
+    if (!chan->nmembers && (chan->mode.mode & MODE_BURSTADDED)) {
       /* Newly empty channel, schedule it for removal. */
       chan->mode.mode &= ~MODE_BURSTADDED;
       sub1_from_channel(chan);
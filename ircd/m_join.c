@@ -165,7 +165,6 @@ int m_join(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
 
       /* Try to add the new channel as a recent target for the user. */
       if (check_target_limit(sptr, chptr, chptr->chname, 0)) {
-        chptr->members = 0;
         destruct_channel(chptr);
         continue;
       }
@@ -386,6 +385,7 @@ int ms_join(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
       if (creation && (creation < chptr->creationtime ||
 		       (!chptr->mode.apass[0] && chptr->users == 0))) {
         struct Membership *member;
+        unsigned int ii;
         struct ModeBuf mbuf;
 
 	chptr->creationtime = creation;
@@ -415,8 +415,9 @@ int ms_join(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
           chptr->mode.apass[0] = '\0';
         }
 
-        for (member = chptr->members; member; member = member->next_member)
+        for (ii = 0; ii < chptr->nmembers; ++ii)
         {
+          member = chptr->members[ii];
           if (IsChanOp(member)) {
             modebuf_mode_client(&mbuf, MODE_DEL | MODE_CHANOP, member->user, OpLevel(member));
 	    member->status &= ~CHFL_CHANOP;
@@ -426,6 +427,7 @@ int ms_join(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
 	    member->status &= ~CHFL_VOICE;
           }
         }
+        names_cache_invalidate(chptr);
         modebuf_flush(&mbuf);
       }
     }
@@ -33,6 +33,7 @@
 #include "msg.h"
 #include "numeric.h"
 #include "numnicks.h"
+#include "s_serv.h"
 #include "send.h"
 #include "ircd_features.h"
 
@@ -100,8 +101,10 @@ int m_kick(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
   /* We rely on ircd_snprintf to truncate the comment */
   comment = EmptyString(parv[parc - 1]) ? parv[0] : parv[parc - 1];
 
-  if (!IsLocalChannel(name))
+  if (!IsLocalChannel(name)) {
+    burst_channel(chptr);
     sendcmdto_serv(sptr, CMD_KICK, cptr, "%H %C :%s", chptr, who, comment);
+  }
 
   if (IsDelayedJoin(member)) {
     /* If it's a delayed join, only send the KICK to the person doing
@@ -151,6 +154,8 @@ int ms_kick(struct Client *cptr, struct Client *sptr, int parc, char *parv[])
       !(who = findNUser(parv[2])))
     return 0;
 
+  burst_channel(chptr);
+
   /* We go ahead and pass on the KICK for users not on the channel */
   member = find_member_link(chptr, who);
   if (member && IsZombie(member))
@@ -53,7 +53,7 @@
  * @return Has a tail call to exit_client_msg().
  */
 static int do_kill(struct Client* cptr, struct Client* sptr,
-		   struct Client* victim, char* inpath, char* path, char* msg)
+		   struct Client* victim, const char* inpath, char* path, char* msg)
 {
   assert(0 != cptr);
   assert(0 != sptr);
@@ -27,8 +27,11 @@
 #include "client.h"
 #include "hash.h"
 #include "ircd.h"
+#include "ircd_alloc.h"
+#include "ircd_features.h"
 #include "ircd_log.h"
 #include "ircd_reply.h"
+#include "ircd_snprintf.h"
 #include "ircd_string.h"
 #include "msg.h"
 #include "numeric.h"
@@ -39,6 +42,101 @@
 /* #include <assert.h> -- Now using assert in ircd_log.h */
 #include <string.h>
 
+/** Growable buffer of NUL-separated RPL_NAMREPLY fragments. */
+struct NamesText {
+  char *text;		/**< Fragment text */
+  size_t len;		/**< Bytes of \a text in use */
+  size_t alloc;		/**< Bytes allocated for \a text */
+  unsigned int count;	/**< Number of complete fragments */
+};
+
+/** Make sure \a nt has room for \a len more bytes.
+ * @param[in,out] nt Buffer to grow.
+ * @param[in] len Number of bytes needed.
+ */
+static void names_reserve(struct NamesText *nt, size_t len)
+{
+  if (nt->len + len <= nt->alloc)
+    return;
+  nt->alloc = nt->alloc ? nt->alloc * 2 : BUFSIZE;
+  if (nt->alloc < nt->len + len)
+    nt->alloc = nt->len + len;
+  nt->text = (char*) MyRealloc(nt->text, nt->alloc);
+}
+
+/** Format the member list of a channel into reply fragments.
+ *
+ * Fragments are sized so that a reply to any client with a nick of up
+ * to NICKLEN characters fits in BUFSIZE.
+ *
+ * @param[out] nt Buffer to fill; must be zeroed by the caller.
+ * @param[in] chptr Channel to list.
+ * @param[in] sptr Client whose own zombie or join-delayed membership
+ *   should be listed, or NULL to list only what everyone would see.
+ * @param[in] filter Selector for list contents, as for do_names().
+ * @param[in] variant Combination of NAMES_VARIANT_* flags.
+ */
+static void names_format(struct NamesText *nt, struct Channel *chptr,
+                         struct Client *sptr, int filter, int variant)
+{
+  struct Membership *member;
+  unsigned int ii;
+  struct Client *c2ptr;
+  size_t start;
+  size_t maxent;
+  int limit;
+
+  maxent = 1 + NICKLEN;
+  /* ":me 353 nick = #channel :" ... " " entry "\r\n\0" */
+  limit = BUFSIZE - (strlen(cli_name(&me)) + 10 + NICKLEN)
+    - (strlen(chptr->chname) + 4) - maxent - 4;
+
+  start = nt->len;
+  for (ii = 0; ii < chptr->nmembers; ++ii)
+  {
+    member = chptr->members[ii];
+    c2ptr = member->user;
+
+    if ((variant & NAMES_VARIANT_VIS) && IsInvisible(c2ptr))
+      continue;
+
+    if (IsZombie(member) && member->user != sptr)
+      continue;
+
+    if (IsDelayedJoin(member) && (member->user != sptr) && !(filter & NAMES_DEL))
+        continue;
+
+    if ((!IsDelayedJoin(member) || (member->user == sptr)) && (filter & NAMES_DEL))
+        continue;
+
+    names_reserve(nt, maxent + 2);
+    if (nt->len > start)
+      nt->text[nt->len++] = ' ';
+    if (IsZombie(member))
+      nt->text[nt->len++] = '!';
+    else if (IsChanOp(member))
+      nt->text[nt->len++] = '@';
+    else if (HasVoice(member))
+      nt->text[nt->len++] = '+';
+    strcpy(nt->text + nt->len, cli_name(c2ptr));
+    nt->len += strlen(cli_name(c2ptr));
+
+    if ((int)(nt->len - start) > limit)
+    {
+      nt->text[nt->len++] = '\0';
+      nt->count++;
+      start = nt->len;
+    }
+  }
+  /* Always send at least one reply, even if it lists nobody. */
+  if (nt->len > start || !nt->count)
+  {
+    names_reserve(nt, 1);
+    nt->text[nt->len++] = '\0';
+    nt->count++;
+  }
+}
+
 /** List some or all of of the users in a channel.
  *
  * The list contents depend on \a filter:
@@ -48,87 +146,81 @@
  *  NAMES_EON - When OR'd with the other two, adds an 'End of Names' numeric
  *              used by m_join
  *
+ * Unless the list depends on the requester (delayed-join listings, or a
+ * requester who is a zombie or join-delayed member), the formatted
+ * member list is kept in the channel's NamesCache and shared by every
+ * later request for the same variant.
+ *
  * @param[in] sptr Client to whom to send the list.
  * @param[in] chptr Channel to send list from.
  * @param[in] filter Selector for list contents, as above.
  */
 void do_names(struct Client* sptr, struct Channel* chptr, int filter)
 { 
-  int mlen;
-  int idx;
-  int flag;
-  int needs_space; 
-  int len; 
-  char buf[BUFSIZE];
-  struct Client *c2ptr;
+  struct NamesCache *cache = NULL;
+  struct NamesText nt;
   struct Membership* member;
+  const char *text;
+  unsigned int count;
+  unsigned int ii;
+  int variant;
+  char type;
   
   assert(chptr);
   assert(sptr);
   assert((filter&NAMES_ALL) != (filter&NAMES_VIS));
 
+  if (!ShowChannel(sptr, chptr)) /* Don't list private channels unless we are on them. */
+    return;
+
   /* Tag Pub/Secret channels accordingly. */
 
-  strcpy(buf, "* ");
   if (PubChannel(chptr))
-    *buf = '=';
+    type = '=';
   else if (SecretChannel(chptr))
-    *buf = '@';
- 
-  len = strlen(chptr->chname);
-  strcpy(buf + 2, chptr->chname);
-  strcpy(buf + 2 + len, " :");
-
-  idx = len + 4;
-  flag = 1;
-  needs_space = 0;
-
-  if (!ShowChannel(sptr, chptr)) /* Don't list private channels unless we are on them. */
-    return;
+    type = '@';
+  else
+    type = '*';
 
-  /* Iterate over all channel members, and build up the list. */
+  variant = (filter & NAMES_VIS) ? NAMES_VARIANT_VIS : 0;
+  member = find_member_link(chptr, sptr);
+  memset(&nt, 0, sizeof(nt));
 
-  mlen = strlen(cli_name(&me)) + 10 + strlen(cli_name(sptr));
-  
-  for (member = chptr->members; member; member = member->next_member)
+  if (!(filter & NAMES_DEL)
+      && !(member && (IsZombie(member) || IsDelayedJoin(member)))
+      && chptr->users >= (unsigned int)feature_int(FEAT_NAMES_CACHE_MIN))
   {
-    c2ptr = member->user;
-
-    if (((filter&NAMES_VIS)!=0) && IsInvisible(c2ptr))
-      continue;
-
-    if (IsZombie(member) && member->user != sptr)
-      continue;
-
-    if (IsDelayedJoin(member) && (member->user != sptr) && !(filter & NAMES_DEL))
-        continue;
-
-    if ((!IsDelayedJoin(member) || (member->user == sptr)) && (filter & NAMES_DEL))
-        continue;
-
-    if (needs_space)
-      buf[idx++] = ' ';
-    needs_space=1;
-    if (IsZombie(member))
-      buf[idx++] = '!';
-    else if (IsChanOp(member))
-      buf[idx++] = '@';
-    else if (HasVoice(member))
-      buf[idx++] = '+';
-    strcpy(buf + idx, cli_name(c2ptr));
-    idx += strlen(cli_name(c2ptr));
-    flag = 1;
-    if (mlen + idx + NICKLEN + 5 > BUFSIZE)
-      /* space, modifier, nick, \r \n \0 */
+    cache = names_cache_get(chptr);
+    if (!cache->text[variant])
     {
-      send_reply(sptr, (filter & NAMES_DEL) ? RPL_DELNAMREPLY : RPL_NAMREPLY, buf);
-      idx = len + 4;
-      flag = 0;
-      needs_space=0;
+      names_format(&nt, chptr, NULL, filter, variant);
+      cache->text[variant] = nt.text;
+      cache->count[variant] = nt.count;
+      cache->size[variant] = nt.alloc;
     }
+    cache->ref++;
+    text = cache->text[variant];
+    count = cache->count[variant];
   }
-  if (flag)
-    send_reply(sptr, (filter & NAMES_DEL) ? RPL_DELNAMREPLY : RPL_NAMREPLY, buf); 
+  else
+  {
+    names_format(&nt, chptr, sptr, filter, variant);
+    text = nt.text;
+    count = nt.count;
+  }
+
+  for (ii = 0; ii < count; ii++)
+  {
+    send_reply(sptr, SND_EXPLICIT | ((filter & NAMES_DEL) ? RPL_DELNAMREPLY : RPL_NAMREPLY),
+               "%c %s :%s", type, chptr->chname, text);
+    text += strlen(text) + 1;
+  }
+
+  if (cache)
+    names_cache_release(cache);
+  else
+    MyFree(nt.text);
+
   if (filter&NAMES_EON)
     send_reply(sptr, RPL_ENDOFNAMES, chptr->chname);
 }
@@ -31,6 +31,7 @@
 #include "ircd.h"
 #include "ircd_log.h"
 #include "ircd_features.h"
+#include "ircd_intern.h"
 #include "ircd_reply.h"
 #include "ircd_string.h"
 #include "jupe.h"
@@ -579,7 +580,7 @@ int mr_server(struct Client* cptr, struct Client* sptr, int parc, char* parv[])
       0 != ircd_strcmp(cli_name(cptr), host))
     hChangeClient(cptr, host);
   ircd_strncpy(cli_name(cptr), host, HOSTLEN);
-  ircd_strncpy(cli_info(cptr), parv[parc-1][0] ? parv[parc-1] : cli_name(&me), REALLEN);
+  intern_set(&cli_info(cptr), parv[parc-1][0] ? parv[parc-1] : cli_name(&me), REALLEN);
   cli_hopcount(cptr) = hop;
 
   if (conf_check_server(cptr)) {
@@ -731,7 +732,7 @@ int ms_server(struct Client* cptr, struct Client* sptr, int parc, char* parv[])
   cli_serv(acptr)->timestamp = timestamp;
   cli_hopcount(acptr) = hop;
   ircd_strncpy(cli_name(acptr), host, HOSTLEN);
-  ircd_strncpy(cli_info(acptr), parv[parc-1], REALLEN);
+  intern_set(&cli_info(acptr), parv[parc-1], REALLEN);
   cli_serv(acptr)->up = sptr;
   cli_serv(acptr)->updown = add_dlink(&(cli_serv(sptr))->down, acptr);
   /* Use cptr, because we do protocol 9 -> 10 translation
@@ -262,6 +262,7 @@ forward_silences(struct Client *sptr, char *silences, struct Client *dest)
       free_ban(accepted[ii]);
     }
   }
+  silence_changed(cli_user(sptr));
 }
 
 /** Handle a SILENCE command from a local user.
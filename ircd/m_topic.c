@@ -34,6 +34,7 @@
 #include "msg.h"
 #include "numeric.h"
 #include "numnicks.h"
+#include "s_serv.h"
 #include "send.h"
 
 /* #include <assert.h> -- Now using assert in ircd_log.h */
@@ -71,9 +72,11 @@ static void do_settopic(struct Client *sptr, struct Client *cptr,
    }
    chptr->topic_time = ts;
    /* Fixed in 2.10.11: Don't propagate local topics */
-   if (!IsLocalChannel(chptr->chname))
+   if (!IsLocalChannel(chptr->chname)) {
+     burst_channel(chptr);
      sendcmdto_serv(sptr, CMD_TOPIC, cptr, "%H %Tu %Tu :%s", chptr,
                     chptr->creationtime, chptr->topic_time, chptr->topic);
+   }
    if (newtopic)
    {
      struct Membership *member;
@@ -180,7 +180,7 @@ static void do_who(struct Client* sptr, struct Client* acptr,
 
   if (!fields || (fields & WHO_FIELD_UID))
   {
-    char *p2 = cli_user(acptr)->username;
+    const char *p2 = cli_user(acptr)->username;
     *(p1++) = ' ';
     while ((*p2) && (*(p1++) = *(p2++)));
   }
@@ -196,7 +196,7 @@ static void do_who(struct Client* sptr, struct Client* acptr,
 
   if (!fields || (fields & WHO_FIELD_HOS))
   {
-    char *p2 = cli_user(acptr)->host;
+    const char *p2 = cli_user(acptr)->host;
     *(p1++) = ' ';
     while ((*p2) && (*(p1++) = *(p2++)));
   }
@@ -294,7 +294,7 @@ static void do_who(struct Client* sptr, struct Client* acptr,
 
   if (fields & WHO_FIELD_ACC)
   {
-    char *p2 = cli_user(acptr)->account;
+    const char *p2 = cli_user(acptr)->account;
     *(p1++) = ' ';
     if (*p2)
       while ((*p2) && (*(p1++) = *(p2++)));
@@ -321,7 +321,7 @@ static void do_who(struct Client* sptr, struct Client* acptr,
 
   if (!fields || (fields & WHO_FIELD_REN))
   {
-    char *p2 = cli_info(acptr);
+    const char *p2 = cli_info(acptr);
     *p1++ = ' ';
     if (fields)
       *p1++ = ':';              /* Place colon here for special reply */
@@ -545,8 +545,10 @@ int m_who(struct Client* cptr, struct Client* sptr, int parc, char* parv[])
         if (isthere || SEE_CHANNEL(sptr, chptr, bitsel))
         {
           struct Membership* member;
-          for (member = chptr->members; member; member = member->next_member)
+          unsigned int ii;
+          for (ii = 0; ii < chptr->nmembers; ++ii)
           {
+            member = chptr->members[ii];
             acptr = member->user;
             if ((bitsel & WHOSELECT_OPER) && !SeeOper(sptr,acptr))
               continue;
@@ -608,10 +610,12 @@ int m_who(struct Client* cptr, struct Client* sptr, int parc, char* parv[])
     if ((!(counter < 1)) && matchsel) {
       struct Membership* member;
       struct Membership* chan;
+      unsigned int ii;
       for (chan = cli_user(sptr)->channel; chan; chan = chan->next_channel) {
         chptr = chan->channel;
-        for (member = chptr->members; member; member = member->next_member)
+        for (ii = 0; ii < chptr->nmembers; ++ii)
         {
+          member = chptr->members[ii];
           acptr = member->user;
           if (!(IsUser(acptr) && Process(acptr)))
             continue;           /* Now Process() is at the beginning, if we fail
@@ -22,10 +22,14 @@
 #include "config.h"
 
 #include "match.h"
+#include "ircd_alloc.h"
 #include "ircd_chattr.h"
 #include "ircd_string.h"
 #include "ircd_snprintf.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 /*
  * mmatch()
  *
@@ -867,3 +871,361 @@ int ipmask_check(const struct irc_in_addr *addr, const struct irc_in_addr *mask,
   }
   return -1;
 }
+
+/*
+ ***************** Mask sets **************
+ */
+
+/** @page masksets Mask Sets
+ * A mask set holds any number of masks that are all checked against
+ * the same strings, such as a list of bans or a silence list.
+ * Masks are numbered from zero in the order they are added with
+ * maskset_add(); a lower number means a higher priority.
+ * maskset_first() returns the number of the first mask that matches
+ * a string, and maskset_all() returns the numbers of every mask that
+ * matches, in priority order.  Both give exactly the same answers as
+ * calling match() on each mask in turn.
+ *
+ * Internally, the longest run of literal characters in each mask is
+ * entered into an Aho-Corasick automaton.  A mask cannot match a
+ * string unless its run appears somewhere in that string (ignoring
+ * case), so one pass of the automaton over the string finds the few
+ * masks worth checking; only those, and masks with no literal
+ * characters at all (such as "*!*@*"), are passed to match().  The
+ * automaton is rebuilt on the first lookup after a mask is added.
+ */
+
+/** Node in a mask set's automaton.
+ * Node 0 is the root; since the root is never anyone's child, an
+ * index of zero also means "none".
+ */
+struct MaskSetNode {
+  unsigned int child;           /**< First child node. */
+  unsigned int sibling;         /**< Next child of the same parent. */
+  unsigned int fail;            /**< Longest proper suffix in the trie. */
+  unsigned int output;          /**< Nearest node on the fail chain
+                                 * (maybe this one) that ends a run. */
+  unsigned int masks;           /**< First mask ending here, plus one. */
+  unsigned int seen;            /**< Scan in which output was visited. */
+  unsigned char ch;             /**< Character leading to this node. */
+};
+
+/** A set of masks compiled for matching together. */
+struct MaskSet {
+  char **masks;                 /**< Text of each mask. */
+  unsigned int *link;           /**< Next mask with the same run, plus one. */
+  unsigned int *stamp;          /**< Scan in which each mask was found. */
+  unsigned int *cand;           /**< Candidate masks for current scan. */
+  unsigned int *always;         /**< Masks without literal characters. */
+  unsigned int count;           /**< Number of masks. */
+  unsigned int size;            /**< Number of masks allocated. */
+  unsigned int n_always;        /**< Number of entries in always. */
+  unsigned int scan;            /**< Current scan number. */
+  int compiled;                 /**< Non-zero if nodes are up to date. */
+  struct MaskSetNode *nodes;    /**< Automaton nodes. */
+  unsigned int n_nodes;         /**< Number of nodes used. */
+  unsigned int n_size;          /**< Number of nodes allocated. */
+  unsigned int root[256];       /**< Children of the root by character. */
+};
+
+/** Create an empty mask set.
+ * @return Newly allocated mask set.
+ */
+struct MaskSet *maskset_create(void)
+{
+  return (struct MaskSet *) MyCalloc(1, sizeof(struct MaskSet));
+}
+
+/** Free a mask set and all its masks.
+ * @param[in] set Mask set to free.
+ */
+void maskset_free(struct MaskSet *set)
+{
+  unsigned int ii;
+
+  if (!set)
+    return;
+  for (ii = 0; ii < set->count; ++ii)
+    MyFree(set->masks[ii]);
+  MyFree(set->masks);
+  MyFree(set->link);
+  MyFree(set->stamp);
+  MyFree(set->cand);
+  MyFree(set->always);
+  MyFree(set->nodes);
+  MyFree(set);
+}
+
+/** Add a mask to a mask set.
+ * The mask is copied, so the caller may reuse \a mask afterwards.
+ * @param[in] set Mask set to add to.
+ * @param[in] mask Wildcard mask to add.
+ * @return Number of the new mask; masks are numbered from zero.
+ */
+unsigned int maskset_add(struct MaskSet *set, const char *mask)
+{
+  if (set->count == set->size) {
+    set->size = set->size ? set->size * 2 : 16;
+    set->masks = (char **) MyRealloc(set->masks, set->size * sizeof(char *));
+    set->link = (unsigned int *) MyRealloc(set->link, set->size * sizeof(unsigned int));
+    set->stamp = (unsigned int *) MyRealloc(set->stamp, set->size * sizeof(unsigned int));
+    set->cand = (unsigned int *) MyRealloc(set->cand, set->size * sizeof(unsigned int));
+    set->always = (unsigned int *) MyRealloc(set->always, set->size * sizeof(unsigned int));
+  }
+  DupString(set->masks[set->count], mask);
+  set->compiled = 0;
+  return set->count++;
+}
+
+/** Return the number of masks in a mask set.
+ * @param[in] set Mask set to examine.
+ * @return Number of masks in \a set.
+ */
+unsigned int maskset_count(const struct MaskSet *set)
+{
+  return set->count;
+}
+
+/** Find the longest run of literal characters in a mask.
+ * Escaped characters are literal; the run is written in lower case.
+ * @param[in] mask Mask to examine.
+ * @param[out] buf Output buffer, at least as long as \a mask.
+ * @return Length of the run written to \a buf.
+ */
+static unsigned int maskset_literal(const char *mask, char *buf)
+{
+  unsigned int best = 0, len = 0;
+  char *run = buf + strlen(mask) + 1;
+  const char *m;
+
+  /* Build each run at the end of buf and copy the longest to the start. */
+  for (m = mask; ; m++) {
+    if (*m == '\\' && m[1])
+      run[len++] = ToLower(*++m);
+    else if (*m && *m != '*' && *m != '?' && *m != '\\')
+      run[len++] = ToLower(*m);
+    else {
+      if (len > best)
+        memcpy(buf, run, best = len);
+      len = 0;
+      if (!*m)
+        break;
+    }
+  }
+  return best;
+}
+
+/** Find the child of an automaton node for a character.
+ * @param[in] set Mask set containing the node.
+ * @param[in] node Index of parent node.
+ * @param[in] ch Character (already in lower case).
+ * @return Index of child node, or 0 if there is none.
+ */
+static unsigned int maskset_child(const struct MaskSet *set, unsigned int node,
+                                  unsigned char ch)
+{
+  unsigned int child;
+
+  if (!node)
+    return set->root[ch];
+  for (child = set->nodes[node].child; child; child = set->nodes[child].sibling)
+    if (set->nodes[child].ch == ch)
+      return child;
+  return 0;
+}
+
+/** Build the automaton for a mask set.
+ * @param[in] set Mask set to compile.
+ */
+static void maskset_compile(struct MaskSet *set)
+{
+  struct MaskSetNode *node;
+  unsigned int ii, jj, len, cur, next, head, tail;
+  size_t buflen = 0;
+  char *buf = 0;
+
+  memset(set->root, 0, sizeof(set->root));
+  set->n_nodes = 1;
+  set->n_always = 0;
+  if (!set->n_size) {
+    set->n_size = 64;
+    set->nodes = (struct MaskSetNode *) MyMalloc(set->n_size * sizeof(*set->nodes));
+  }
+  memset(set->nodes, 0, sizeof(*set->nodes));
+
+  /* Enter each mask's literal run into the trie. */
+  for (ii = 0; ii < set->count; ++ii) {
+    len = strlen(set->masks[ii]) + 1;
+    if (2 * len > buflen) {
+      MyFree(buf);
+      buflen = 2 * len;
+      buf = (char *) MyMalloc(buflen);
+    }
+    len = maskset_literal(set->masks[ii], buf);
+    if (!len) {
+      set->always[set->n_always++] = ii;
+      continue;
+    }
+    for (cur = jj = 0; jj < len; ++jj, cur = next) {
+      if ((next = maskset_child(set, cur, buf[jj])))
+        continue;
+      if (set->n_nodes == set->n_size) {
+        set->n_size *= 2;
+        set->nodes = (struct MaskSetNode *) MyRealloc(set->nodes, set->n_size * sizeof(*set->nodes));
+      }
+      next = set->n_nodes++;
+      node = &set->nodes[next];
+      memset(node, 0, sizeof(*node));
+      node->ch = buf[jj];
+      if (cur) {
+        node->sibling = set->nodes[cur].child;
+        set->nodes[cur].child = next;
+      } else
+        set->root[node->ch] = next;
+    }
+    set->link[ii] = set->nodes[cur].masks;
+    set->nodes[cur].masks = ii + 1;
+  }
+  MyFree(buf);
+
+  /* Fill in fail and output links breadth first, so a node's fail
+   * target (which is shallower) is always finished before it is
+   * needed.  The candidate array is not big enough for a queue, so
+   * thread the queue through the seen fields instead.
+   */
+  head = tail = 0;
+  for (ii = 0; ii < 256; ++ii) {
+    if (!(next = set->root[ii]))
+      continue;
+    node = &set->nodes[next];
+    node->output = node->masks ? next : 0;
+    if (tail)
+      set->nodes[tail].seen = next;
+    else
+      head = next;
+    tail = next;
+  }
+  for (; head; head = set->nodes[head].seen) {
+    for (next = set->nodes[head].child; next; next = set->nodes[next].sibling) {
+      node = &set->nodes[next];
+      for (cur = set->nodes[head].fail; ; cur = set->nodes[cur].fail) {
+        if ((node->fail = maskset_child(set, cur, node->ch)) || !cur)
+          break;
+      }
+      node->output = node->masks ? next : set->nodes[node->fail].output;
+      set->nodes[tail].seen = next;
+      tail = next;
+    }
+  }
+  for (ii = 0; ii < set->n_nodes; ++ii)
+    set->nodes[ii].seen = 0;
+  memset(set->stamp, 0, set->count * sizeof(*set->stamp));
+  set->scan = 0;
+  set->compiled = 1;
+}
+
+/** Compare two mask numbers for qsort().
+ * @param[in] a_ Pointer to one mask number.
+ * @param[in] b_ Pointer to another mask number.
+ * @return Less than, equal to or greater than zero as \a a_ is less
+ * than, equal to or greater than \a b_.
+ */
+static int maskset_cmp(const void *a_, const void *b_)
+{
+  unsigned int a = *(const unsigned int *)a_, b = *(const unsigned int *)b_;
+  return (a > b) - (a < b);
+}
+
+/** Find the masks whose literal runs appear in a string.
+ * @param[in] set Mask set to search.
+ * @param[in] string String to scan.
+ * @return Number of candidates, stored in ascending order in set->cand.
+ */
+static unsigned int maskset_scan(struct MaskSet *set, const char *string)
+{
+  const unsigned char *s;
+  unsigned int state, next, out, mask, n_cand = 0;
+
+  if (!set->compiled)
+    maskset_compile(set);
+  if (!++set->scan) {
+    /* Scan number wrapped, so old stamps might look current. */
+    for (state = 0; state < set->n_nodes; ++state)
+      set->nodes[state].seen = 0;
+    memset(set->stamp, 0, set->count * sizeof(*set->stamp));
+    set->scan = 1;
+  }
+
+  for (s = (const unsigned char *)string, state = 0; *s; ++s) {
+    while (!(next = maskset_child(set, state, ToLower(*s))) && state)
+      state = set->nodes[state].fail;
+    state = next;
+    /* Once a node's outputs have been collected in this scan, so have
+     * those of everything further along its output chain.
+     */
+    for (out = set->nodes[state].output;
+         out && set->nodes[out].seen != set->scan;
+         out = set->nodes[set->nodes[out].fail].output) {
+      set->nodes[out].seen = set->scan;
+      for (mask = set->nodes[out].masks; mask; mask = set->link[mask - 1])
+        if (set->stamp[mask - 1] != set->scan) {
+          set->stamp[mask - 1] = set->scan;
+          set->cand[n_cand++] = mask - 1;
+        }
+    }
+  }
+
+  if (n_cand > 1)
+    qsort(set->cand, n_cand, sizeof(set->cand[0]), maskset_cmp);
+  return n_cand;
+}
+
+/** Find the first mask in a set that matches a string.
+ * @param[in] set Mask set to search.
+ * @param[in] string String to check against the masks.
+ * @return Number of the first matching mask, or -1 if none match.
+ */
+int maskset_first(struct MaskSet *set, const char *string)
+{
+  unsigned int n_cand, ic, ia, mask;
+
+  n_cand = maskset_scan(set, string);
+  for (ic = ia = 0; ic < n_cand || ia < set->n_always; ) {
+    if (ia >= set->n_always
+        || (ic < n_cand && set->cand[ic] < set->always[ia]))
+      mask = set->cand[ic++];
+    else
+      mask = set->always[ia++];
+    if (!match(set->masks[mask], string))
+      return mask;
+  }
+  return -1;
+}
+
+/** Find every mask in a set that matches a string.
+ * @param[in] set Mask set to search.
+ * @param[in] string String to check against the masks.
+ * @param[out] found Receives matching mask numbers in ascending order.
+ * @param[in] max Maximum number of entries to store in \a found.
+ * @return Number of matching masks, which may be more than \a max.
+ */
+unsigned int maskset_all(struct MaskSet *set, const char *string,
+                         unsigned int *found, unsigned int max)
+{
+  unsigned int n_cand, ic, ia, mask, count = 0;
+
+  n_cand = maskset_scan(set, string);
+  for (ic = ia = 0; ic < n_cand || ia < set->n_always; ) {
+    if (ia >= set->n_always
+        || (ic < n_cand && set->cand[ic] < set->always[ia]))
+      mask = set->cand[ic++];
+    else
+      mask = set->always[ia++];
+    if (!match(set->masks[mask], string)) {
+      if (count < max)
+        found[count] = mask;
+      count++;
+    }
+  }
+  return count;
+}
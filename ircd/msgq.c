@@ -41,7 +41,12 @@
 #include <sys/uio.h>	/* struct iovec */
 
 #define MB_BASE_SHIFT	5 /**< Log2 of smallest message body to allocate. */
-#define MB_MAX_SHIFT	9 /**< Log2 of largest message body to allocate. */
+#define MB_MSG_SHIFT	9 /**< Log2 of largest single message body. */
+#define MB_COMPACT_SHIFT 12 /**< Log2 of largest buffer made by compaction. */
+#define MB_COALESCE_SHIFT 14 /**< Log2 of smallest coalescing buffer. */
+#define MB_MAX_SHIFT	16 /**< Log2 of largest buffer to allocate. */
+/** Number of MsgBuf size classes. */
+#define MB_CLASSES	(MB_MAX_SHIFT - MB_BASE_SHIFT + 1)
 
 /** Buffer for a single message. */
 struct MsgBuf {
@@ -82,8 +87,21 @@ static struct MQData_s {
   struct {
     unsigned int alloc;		/**< total MsgBuf's of this size */
     unsigned int used;		/**< number of MsgBuf's of this size in use */
+    unsigned int nfree;		/**< number of MsgBuf's on free list */
     struct MsgBuf *free;	/**< list of free MsgBuf's */
-  } msgBufs[MB_MAX_SHIFT - MB_BASE_SHIFT + 1];
+  } msgBufs[MB_CLASSES];
+  /** Counters for what was done when the buffer pool ran low. */
+  struct {
+    unsigned int events;	/**< times the pool was found full */
+    size_t reclaimed;		/**< bytes of free buffers released */
+    unsigned int compacted;	/**< sendQs that were compacted */
+    unsigned int merged;	/**< messages merged by compaction */
+    size_t saved;		/**< bytes released by compaction */
+    unsigned int shared;	/**< messages left in a shared buffer */
+    unsigned int kills;		/**< connections dropped for lack of buffers */
+    time_t last;		/**< when the pool was last relieved */
+  } pressure;
+  unsigned int coalesced;	/**< messages copied into coalescing buffers */
   struct MsgSizes sizes;	/**< histogram of message sizes */
 } MQData;
 
@@ -245,76 +263,214 @@ msgq_mapiov(const struct MsgQ *mq, struct iovec *iov, int count,
   return i;
 }
 
-/** Allocate a message buffer large enough to hold \a length bytes.
- * TODO: \a in_mb needs better documentation.
- * @param[in] in_mb Some other message buffer(?).
- * @param[in] length Number of bytes of space to reserve in output.
- * @return Pointer to some usable message buffer.
+/** Find the smallest size class that holds \a length bytes.
+ * @param[in] length Number of bytes needed.
+ * @return Log2 of the buffer size.
  */
-static struct MsgBuf *
-msgq_alloc(struct MsgBuf *in_mb, int length)
+static unsigned int
+msgq_power(unsigned int length)
 {
-  struct MsgBuf *mb;
   unsigned int power;
 
-  /* Find the power of two size that will accommodate the message */
-  for (power = MB_BASE_SHIFT; power < MB_MAX_SHIFT + 1; power++)
+  for (power = MB_BASE_SHIFT; power < MB_MAX_SHIFT; power++)
     if ((length - 1) >> power == 0)
       break;
-  assert((1 << power) >= length);
-  assert((1 << power) <= 512);
-  length = 1 << power; /* reset the length */
+  assert((1u << power) >= length);
+  return power;
+}
 
-  /* If the message needs a buffer of exactly the existing size, just use it */
-  if (in_mb && in_mb->power == power) {
-    in_mb->real = in_mb; /* real buffer is this buffer */
-    return in_mb;
+/** Watermarks derived from the BUFFERPOOL features.
+ * These are recomputed only when a feature has changed.
+ */
+static struct {
+  unsigned int generation;        /**< feature_generation when computed. */
+  size_t high;                    /**< Pool size to start making room at. */
+  size_t low;                     /**< Pool size to stop making room at. */
+  unsigned int high_free[MB_CLASSES]; /**< Free buffers to trim above. */
+  unsigned int low_free[MB_CLASSES];  /**< Free buffers to trim down to. */
+} MQLimits;
+
+/** Return a fraction of the buffer pool.
+ * @param[in] percent Percentage of BUFFERPOOL to use.
+ * @return Number of bytes.
+ */
+static size_t
+msgq_watermark(int percent)
+{
+  return (size_t)feature_uint(FEAT_BUFFERPOOL) / 100 * percent;
+}
+
+/** Bring the cached watermarks up to date with the features.
+ * Each size class may hold an equal share of a watermark on its free
+ * list.
+ */
+static void
+msgq_update_limits(void)
+{
+  unsigned int i;
+
+  if (MQLimits.generation == feature_generation)
+    return;
+
+  MQLimits.high = msgq_watermark(feature_int(FEAT_BUFFERPOOL_HIGH_WATER));
+  MQLimits.low = msgq_watermark(feature_int(FEAT_BUFFERPOOL_LOW_WATER));
+  for (i = 0; i < MB_CLASSES; i++) {
+    MQLimits.high_free[i] = (MQLimits.high / MB_CLASSES) >> (i + MB_BASE_SHIFT);
+    MQLimits.low_free[i] = (MQLimits.low / MB_CLASSES) >> (i + MB_BASE_SHIFT);
   }
+  MQLimits.generation = feature_generation;
+}
+
+/** Pool size at which to start making room. */
+#define HIGH_WATER (msgq_update_limits(), MQLimits.high)
+/** Pool size at which to stop making room. */
+#define LOW_WATER (msgq_update_limits(), MQLimits.low)
+/** Number of free buffers of size 2^\a power to trim above. */
+#define CLASS_HIGH_WATER(power) \
+  (msgq_update_limits(), MQLimits.high_free[(power) - MB_BASE_SHIFT])
+/** Number of free buffers of size 2^\a power to trim down to. */
+#define CLASS_LOW_WATER(power) \
+  (msgq_update_limits(), MQLimits.low_free[(power) - MB_BASE_SHIFT])
+
+/** Release free buffers of one size class.
+ * @param[in] power Log2 of the class's buffer size.
+ * @param[in] keep Number of free buffers to keep.
+ * @return Number of bytes released.
+ */
+static size_t
+msgq_trim_class(unsigned int power, unsigned int keep)
+{
+  struct MsgBuf *mb;
+  size_t released = 0;
+
+  while (MQData.msgBufs[power - MB_BASE_SHIFT].nfree > keep
+         && (mb = MQData.msgBufs[power - MB_BASE_SHIFT].free)) {
+    MQData.msgBufs[power - MB_BASE_SHIFT].free = mb->next; /* shift free list */
+    MQData.msgBufs[power - MB_BASE_SHIFT].nfree--;
+    MQData.msgBufs[power - MB_BASE_SHIFT].alloc--; /* reduce allocation count */
+    MQData.tot_bufsize -= 1 << power; /* reduce total buffer allocation count */
+    released += 1 << power;
+    MyFree(mb); /* and free the buffer */
+  }
+  return released;
+}
+
+/** Allocate a new buffer, or take one off the free list.
+ * @param[in] power Log2 of buffer size.
+ * @param[in] force If non-zero, ignore the BUFFERPOOL limit.
+ * @return New buffer, or NULL if the pool is exhausted.
+ */
+static struct MsgBuf *
+msgq_getbuf(unsigned int power, int force)
+{
+  struct MsgBuf *mb;
 
   /* Try popping one off the freelist first */
   if ((mb = MQData.msgBufs[power - MB_BASE_SHIFT].free)) {
     MQData.msgBufs[power - MB_BASE_SHIFT].free = mb->next;
-  } else if (MQData.tot_bufsize < feature_uint(FEAT_BUFFERPOOL)) {
+    MQData.msgBufs[power - MB_BASE_SHIFT].nfree--;
+  } else if (force || MQData.tot_bufsize < feature_uint(FEAT_BUFFERPOOL)) {
     /* Allocate another if we won't bust the BUFFERPOOL */
     Debug((DEBUG_MALLOC, "Allocating MsgBuf of length %d (total size %zu)",
-	   length, sizeof(struct MsgBuf) + length));
-    mb = (struct MsgBuf *)MyMalloc(sizeof(struct MsgBuf) + length);
+	   1 << power, sizeof(struct MsgBuf) + (1 << power)));
+    mb = (struct MsgBuf *)MyMalloc(sizeof(struct MsgBuf) + (1 << power));
     MQData.msgBufs[power - MB_BASE_SHIFT].alloc++;
     mb->power = power; /* remember size */
-    MQData.tot_bufsize += length;
-  }
+    MQData.tot_bufsize += 1 << power;
+  } else
+    return 0;
 
-  if (mb) {
-    MQData.msgBufs[power - MB_BASE_SHIFT].used++; /* how many are we using? */
+  MQData.msgBufs[power - MB_BASE_SHIFT].used++; /* how many are we using? */
 
-    mb->real = 0; /* essential initializations */
-    mb->ref = 1;
+  mb->real = 0; /* essential initializations */
+  mb->ref = 1;
 
-    if (in_mb) /* remember who's the *real* buffer */
-      in_mb->real = mb;
-  } else if (in_mb) /* just use the input buffer */
-    mb = in_mb->real = in_mb;
+  return mb;
+}
 
-  return mb; /* return the buffer */
+/** Release free buffers until the pool is at or below \a target bytes.
+ * Larger size classes are released first.
+ * @param[in] target Number of bytes to reduce the pool to.
+ */
+static void
+msgq_reclaim(size_t target)
+{
+  int i;
+
+  for (i = MB_MAX_SHIFT; i >= MB_BASE_SHIFT && MQData.tot_bufsize > target;
+       i--) {
+    unsigned int excess = (MQData.tot_bufsize - target + (1 << i) - 1) >> i;
+    unsigned int nfree = MQData.msgBufs[i - MB_BASE_SHIFT].nfree;
+
+    MQData.pressure.reclaimed +=
+      msgq_trim_class(i, nfree > excess ? nfree - excess : 0);
+  }
 }
 
-/** Deallocate unused message buffers.
+/** Try to bring the buffer pool back under its low watermark.
+ * Free buffers are released first; if that is not enough, the
+ * sendQs of local connections are compacted.
  */
 static void
-msgq_clear_freembs(void)
+msgq_relieve(void)
+{
+  size_t target = LOW_WATER;
+
+  MQData.pressure.events++;
+  MQData.pressure.last = CurrentTime;
+  msgq_reclaim(target);
+  if (MQData.tot_bufsize > target)
+    compact_sendqs();
+}
+
+/** Report whether the buffer pool is above its low watermark.
+ * @return Non-zero if sendQ compaction should continue.
+ */
+int
+msgq_pressure(void)
+{
+  return MQData.tot_bufsize > LOW_WATER;
+}
+
+/** Allocate a message buffer large enough to hold \a length bytes.
+ * When the pool is past its high watermark, free buffers are released
+ * and sendQs compacted first.  If no buffer can be had and \a in_mb
+ * is given, \a in_mb itself is used.
+ * @param[in] in_mb Buffer being copied into a close-fitting one, or NULL.
+ * @param[in] length Number of bytes of space to reserve in output.
+ * @return Pointer to some usable message buffer.
+ */
+static struct MsgBuf *
+msgq_alloc(struct MsgBuf *in_mb, int length)
 {
   struct MsgBuf *mb;
-  int i;
+  unsigned int power;
 
-  /* Walk through the various size classes */
-  for (i = MB_BASE_SHIFT; i < MB_MAX_SHIFT + 1; i++)
-    /* walk down the free list */
-    while ((mb = MQData.msgBufs[i - MB_BASE_SHIFT].free)) {
-      MQData.msgBufs[i - MB_BASE_SHIFT].free = mb->next; /* shift free list */
-      MQData.msgBufs[i - MB_BASE_SHIFT].alloc--; /* reduce allocation count */
-      MQData.tot_bufsize -= 1 << i; /* reduce total buffer allocation count */
-      MyFree(mb); /* and free the buffer */
-    }
+  /* Find the power of two size that will accommodate the message */
+  power = msgq_power(length);
+  assert(power <= MB_MSG_SHIFT);
+
+  /* If the message needs a buffer of exactly the existing size, just use it */
+  if (in_mb && in_mb->power == power) {
+    in_mb->real = in_mb; /* real buffer is this buffer */
+    return in_mb;
+  }
+
+  /* Past the high watermark, make room before the pool runs out */
+  if (!MQData.msgBufs[power - MB_BASE_SHIFT].free
+      && MQData.pressure.last != CurrentTime
+      && MQData.tot_bufsize >= HIGH_WATER)
+    msgq_relieve();
+
+  if ((mb = msgq_getbuf(power, 0))) {
+    if (in_mb) /* remember who's the *real* buffer */
+      in_mb->real = mb;
+  } else if (in_mb) { /* just use the input buffer */
+    MQData.pressure.shared++;
+    mb = in_mb->real = in_mb;
+  }
+
+  return mb; /* return the buffer */
 }
 
 /** Format a message buffer for a client from a format string.
@@ -352,18 +508,20 @@ msgq_vmake(struct Client *dest, const char *format, va_list vl)
       flush_connections(0);
       mb = msgq_alloc(0, BUFSIZE);
     }
-    if (!mb) { /* OK, try clearing the buffer free list */
-      msgq_clear_freembs();
+    if (!mb) { /* OK, try releasing free buffers and compacting sendQs */
+      msgq_relieve();
       mb = msgq_alloc(0, BUFSIZE);
     }
     if (!mb) { /* OK, try killing a client */
+      MQData.pressure.kills++;
       kill_highest_sendq(0); /* Don't kill any server connections */
-      msgq_clear_freembs();  /* Release whatever was just freelisted */
+      msgq_reclaim(0);       /* Release whatever was just freelisted */
       mb = msgq_alloc(0, BUFSIZE);
     }
     if (!mb) { /* hmmm... */
+      MQData.pressure.kills++;
       kill_highest_sendq(1); /* Try killing a server connection now */
-      msgq_clear_freembs();  /* Clear freelist again */
+      msgq_reclaim(0);       /* Clear freelist again */
       mb = msgq_alloc(0, BUFSIZE);
     }
     if (!mb) /* AIEEEE! */
@@ -468,6 +626,11 @@ msgq_clean(struct MsgBuf *mb)
     MQData.msgBufs[mb->power - MB_BASE_SHIFT].used--;
 
     mb->prev_p = 0;
+
+    /* Don't let one size class hoard the pool */
+    if (++MQData.msgBufs[mb->power - MB_BASE_SHIFT].nfree >
+        CLASS_HIGH_WATER(mb->power))
+      msgq_trim_class(mb->power, CLASS_LOW_WATER(mb->power));
   }
 }
 
@@ -547,6 +710,169 @@ msgq_add(struct MsgQ *mq, struct MsgBuf *mb, int prio)
   mq->count++; /* and the queue count */
 }
 
+/** Merge runs of small messages in one list of a message queue.
+ * Only messages whose buffers are not shared with another queue are
+ * merged, and only when the merged buffer is smaller than the buffers
+ * it replaces.
+ * @param[in,out] mq Message queue containing \a qlist.
+ * @param[in,out] qlist List within \a mq to compact.
+ */
+static void
+msgq_compact_list(struct MsgQ *mq, struct MsgQList *qlist)
+{
+  struct Msg *first, *m, *next;
+  struct MsgBuf *mb;
+  unsigned int length, count, power;
+  size_t size;
+
+  /* Leave a partly sent message alone */
+  first = qlist->sent ? qlist->head->next : qlist->head;
+
+  while (first) {
+    /* Find the longest run of private messages that fits in one buffer */
+    length = 0;
+    count = 0;
+    size = 0;
+    for (m = first; m && m->msg->ref == 1
+           && length + m->msg->length <= (1u << MB_COMPACT_SHIFT);
+         m = m->next) {
+      length += m->msg->length;
+      size += bufsize(m->msg);
+      count++;
+    }
+
+    power = msgq_power(length);
+    if (count < 2 || size <= (1u << power)) {
+      first = first->next; /* not worth merging; move on */
+      continue;
+    }
+
+    /* Copy the run into a new buffer hung off the first Msg */
+    mb = msgq_getbuf(power, 1);
+    mb->real = mb;
+    mb->next = 0;
+    mb->prev_p = 0;
+    mb->length = 0;
+    for (m = first; count--; m = next) {
+      next = m->next;
+      memcpy(mb->msg + mb->length, m->msg->msg, m->msg->length);
+      mb->length += m->msg->length;
+      msgq_clean(m->msg);
+      if (m != first) {
+        MQData.msgs.used--; /* give the Msg back */
+        m->next = MQData.msgs.free;
+        MQData.msgs.free = m;
+        mq->count--;
+        MQData.pressure.merged++;
+      }
+    }
+    mb->msg[mb->length] = '\0';
+    first->msg = mb;
+    first->next = m;
+    if (!m)
+      qlist->tail = first;
+    MQData.pressure.saved += size - bufsize(mb);
+
+    first = m;
+  }
+}
+
+/** Append a message to a peer's message queue, coalescing it with
+ * the messages before it.
+ * Small messages are copied into a large buffer at the tail of the
+ * queue, so that a long queue needs few Msg structures and few
+ * iovecs to send.  The buffer grows from 16 KB to 64 KB as the queue
+ * gets longer.  If no large buffer can be had, this falls back to
+ * msgq_add().
+ * @param[in] mq Message queue to append to.
+ * @param[in] mb Message to append.
+ * @param[in] prio If non-zero, use the high-priority (lag-busting) message list; else use the normal list.
+ */
+void
+msgq_add_coalesced(struct MsgQ *mq, struct MsgBuf *mb, int prio)
+{
+  struct MsgQList *qlist;
+  struct MsgBuf *tail;
+  struct Msg *msg;
+  unsigned int power;
+
+  assert(0 != mq);
+  assert(0 != mb);
+  assert(0 < mb->ref);
+  assert(0 < mb->length);
+
+  qlist = prio ? &mq->prio : &mq->queue;
+
+  /* Append to the coalescing buffer at the tail, if there is room and
+   * it is not already being sent */
+  if (qlist->tail && (tail = qlist->tail->msg)->power >= MB_COALESCE_SHIFT
+      && tail->length + mb->length <= bufsize(tail)
+      && !(qlist->sent && qlist->tail == qlist->head)) {
+    memcpy(tail->msg + tail->length, mb->msg, mb->length);
+    tail->length += mb->length;
+    tail->msg[tail->length] = '\0';
+    mq->length += mb->length;
+    MQData.coalesced++;
+    return;
+  }
+
+  /* Start a new coalescing buffer sized for the queue's backlog */
+  for (power = MB_COALESCE_SHIFT; power < MB_MAX_SHIFT; power++)
+    if (mq->length >> (power + 1) == 0)
+      break;
+  if (!(tail = msgq_getbuf(power, 0))) {
+    msgq_add(mq, mb, prio);
+    return;
+  }
+
+  if (!(msg = MQData.msgs.free)) { /* do I need to allocate one? */
+    msg = (struct Msg *)MyMalloc(sizeof(struct Msg));
+    MQData.msgs.alloc++; /* we allocated another */
+  } else /* shift the free list */
+    MQData.msgs.free = MQData.msgs.free->next;
+
+  MQData.msgs.used++; /* we're using another */
+
+  tail->real = tail; /* private buffer, not in the active list */
+  tail->next = 0;
+  tail->prev_p = 0;
+  memcpy(tail->msg, mb->msg, mb->length);
+  tail->length = mb->length;
+  tail->msg[tail->length] = '\0';
+
+  msg->next = 0;
+  msg->msg = tail;
+
+  if (!qlist->head) /* queue list was empty; head and tail point to msg */
+    qlist->head = qlist->tail = msg;
+  else {
+    qlist->tail->next = msg; /* queue had something in it; add to end */
+    qlist->tail = msg;
+  }
+
+  mq->length += tail->length; /* update the queue length */
+  mq->count++; /* and the queue count */
+  MQData.coalesced++;
+}
+
+/** Merge small messages in a message queue into larger buffers.
+ * This frees memory when the buffer pool is running low, at the cost
+ * of copying the messages.
+ * @param[in,out] mq Message queue to compact.
+ */
+void
+msgq_compact(struct MsgQ *mq)
+{
+  assert(0 != mq);
+
+  if (mq->count < 2)
+    return;
+
+  MQData.pressure.compacted++;
+  msgq_compact_list(mq, &mq->prio);
+  msgq_compact_list(mq, &mq->queue);
+}
+
 /** Report memory statistics for message buffers.
  * @param[in] cptr Client requesting information.
  * @param[out] msg_alloc Receives number of bytes allocated in Msg structs.
@@ -577,16 +903,30 @@ msgq_count_memory(struct Client *cptr, size_t *msg_alloc, size_t *msgbuf_alloc)
 
     /* Send information for this buffer size class */
     send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
-	       ":MsgBufs of size %zu allocated %d(%zu) used %d(%zu)", 1 << i,
+	       ":MsgBufs of size %zu allocated %d(%zu) used %d(%zu) free %u "
+               "watermarks %u/%u", 1 << i,
 	       MQData.msgBufs[i - MB_BASE_SHIFT].alloc,
 	       MQData.msgBufs[i - MB_BASE_SHIFT].alloc * size,
 	       MQData.msgBufs[i - MB_BASE_SHIFT].used,
-	       MQData.msgBufs[i - MB_BASE_SHIFT].used * size);
+	       MQData.msgBufs[i - MB_BASE_SHIFT].used * size,
+	       MQData.msgBufs[i - MB_BASE_SHIFT].nfree,
+	       CLASS_LOW_WATER(i), CLASS_HIGH_WATER(i));
 
     /* count_memory() wants to know the total */
     total += MQData.msgBufs[i - MB_BASE_SHIFT].alloc * size;
   }
   *msgbuf_alloc = total;
+
+  send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
+	     ":MsgBuf pool %zu low %zu high %zu limit %u coalesced %u",
+	     MQData.tot_bufsize, LOW_WATER, HIGH_WATER,
+	     feature_uint(FEAT_BUFFERPOOL), MQData.coalesced);
+  send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
+	     ":MsgBuf pressure %u reclaimed %zu compacted %u merged %u "
+	     "saved %zu shared %u kills %u", MQData.pressure.events,
+	     MQData.pressure.reclaimed, MQData.pressure.compacted,
+	     MQData.pressure.merged, MQData.pressure.saved,
+	     MQData.pressure.shared, MQData.pressure.kills);
 }
 
 /** Report remaining space in a MsgBuf.
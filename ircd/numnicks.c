@@ -78,6 +78,9 @@
 static unsigned int lastNNServer = 0;
 /** Array of servers indexed by numnick. */
 static struct Client* server_list[NN_MAX_SERVER];
+/** Slab cache for the pages of servers' client tables. */
+static struct SlabCache numnickPageSlab =
+  SLAB_CACHE_INIT("NumNickPage", struct NumNickPage);
 
 /* *INDENT-OFF* */
 
@@ -158,6 +161,69 @@ const char* inttobase64(char* buf, unsigned int v, unsigned int count)
   return buf;
 }
 
+/** Allocate the page table for a server's clients.
+ * @param[in] mask Server's numnick mask (capacity minus one).
+ * @return Zeroed array with one page pointer per #NN_PAGE_SIZE clients.
+ */
+static struct NumNickPage** nn_alloc_pages(unsigned int mask)
+{
+  return (struct NumNickPage**) MyCalloc((mask >> NN_PAGE_BITS) + 1,
+                                         sizeof(struct NumNickPage*));
+}
+
+/** Find the client stored under a numnick.
+ * @param[in] serv %Server whose clients to look in.
+ * @param[in] index Client numnick, already masked with Server::nn_mask.
+ * @return %Client with that numnick (or NULL).
+ */
+static struct Client* nn_get(const struct Server* serv, unsigned int index)
+{
+  struct NumNickPage* page = serv->nn_pages[index >> NN_PAGE_BITS];
+
+  return page ? page->slots[index & (NN_PAGE_SIZE - 1)] : NULL;
+}
+
+/** Store or clear the client under a numnick.
+ * Allocates the page on first use and frees it again when its last
+ * client is removed.
+ * @param[in] serv %Server whose clients to change.
+ * @param[in] index Client numnick, already masked with Server::nn_mask.
+ * @param[in] cptr %Client to store, or NULL to clear the slot.
+ */
+static void nn_set(struct Server* serv, unsigned int index,
+                   struct Client* cptr)
+{
+  struct NumNickPage** pagep = &serv->nn_pages[index >> NN_PAGE_BITS];
+  struct NumNickPage* page = *pagep;
+  struct Client** slot;
+
+  if (!page) {
+    if (!cptr)
+      return;
+    page = slab_alloc(&numnickPageSlab);
+    memset(page, 0, sizeof(*page));
+    if ((page->next = serv->nn_live))
+      page->next->prev_p = &page->next;
+    page->prev_p = &serv->nn_live;
+    serv->nn_live = page;
+    *pagep = page;
+  }
+
+  slot = &page->slots[index & (NN_PAGE_SIZE - 1)];
+  if (!*slot && cptr)
+    page->count++;
+  else if (*slot && !cptr)
+    page->count--;
+  *slot = cptr;
+
+  if (!page->count) {
+    if ((*page->prev_p = page->next))
+      page->next->prev_p = page->prev_p;
+    *pagep = 0;
+    slab_free(&numnickPageSlab, page);
+  }
+}
+
 /** Look up an IRC "client" by numnick string.
  * See @ref numnicks for more details.
  * @param[in] numnick %Numeric nickname of server or user.
@@ -188,7 +254,7 @@ struct Client *FindNClient(const char* numnick)
   }
 
   if (srv)
-    return cli_serv(srv)->client_list[nn & cli_serv(srv)->nn_mask];
+    return nn_get(cli_serv(srv), nn & cli_serv(srv)->nn_mask);
 
   return NULL;
 }
@@ -226,7 +292,7 @@ void RemoveYXXClient(struct Client* server, const char* yxx)
   if (*yxx) {
     Debug((DEBUG_DEBUG, "RemoveYXXClient: %s(%d)", yxx,
            base64toint(yxx) & cli_serv(server)->nn_mask));
-    cli_serv(server)->client_list[base64toint(yxx) & cli_serv(server)->nn_mask] = 0;
+    nn_set(cli_serv(server), base64toint(yxx) & cli_serv(server)->nn_mask, 0);
   }
 }
 
@@ -254,11 +320,10 @@ void SetServerYXX(struct Client* cptr, struct Client* server, const char* yxx)
     lastNNServer = index + 1;
   server_list[index] = server;
 
-  /* Note, exit_one_client uses the fact that `client_list' != NULL to
+  /* Note, exit_one_client uses the fact that `nn_pages' != NULL to
    * determine that SetServerYXX has been called - and then calls
    * ClearServerYXX. However, freeing the allocation happens in free_client() */
-  cli_serv(server)->client_list =
-      (struct Client**) MyCalloc(cli_serv(server)->nn_mask + 1, sizeof(struct Client*));
+  cli_serv(server)->nn_pages = nn_alloc_pages(cli_serv(server)->nn_mask);
 }
 
 /** Set a server's capacity.
@@ -285,8 +350,7 @@ void SetYXXCapacity(struct Client* c, unsigned int capacity)
   --max_clients;
   inttobase64(cli_serv(c)->nn_capacity, max_clients, 3);
   cli_serv(c)->nn_mask = max_clients;       /* Our Numeric Nick mask */
-  cli_serv(c)->client_list = (struct Client**) MyCalloc(max_clients + 1,
-                                                     sizeof(struct Client*));
+  cli_serv(c)->nn_pages = nn_alloc_pages(max_clients);
   server_list[base64toint(cli_yxx(c))] = c;
 }
 
@@ -316,16 +380,36 @@ void ClearServerYXX(const struct Client *server)
     server_list[index] = 0;
 }
 
+/** Free a server's client table.
+ * Any clients still in it are forgotten, not exited.
+ * @param[in] server %Server whose table should be freed.
+ */
+void FreeServerYXX(struct Client* server)
+{
+  struct Server* serv = cli_serv(server);
+  struct NumNickPage* page;
+
+  if (!serv->nn_pages)
+    return;
+  while ((page = serv->nn_live)) {
+    serv->nn_live = page->next;
+    slab_free(&numnickPageSlab, page);
+  }
+  MyFree(serv->nn_pages);
+  serv->nn_pages = 0;
+}
+
 /** Register numeric of new (remote) client.
  * See @ref numnicks for more details.
- * Add it to the appropriate client_list.
+ * Add it to the appropriate server's client table.
  * @param[in] acptr %User being registered.
  * @param[in] yxx User's numnick.
  */
 void SetRemoteNumNick(struct Client* acptr, const char *yxx)
 {
-  struct Client** acptrp;
   struct Client*  server = cli_user(acptr)->server;
+  struct Client*  old;
+  unsigned int    index;
 
   if (5 == strlen(yxx)) {
     strcpy(cli_yxx(acptr), yxx + 2);
@@ -338,33 +422,33 @@ void SetRemoteNumNick(struct Client* acptr, const char *yxx)
   Debug((DEBUG_DEBUG, "SetRemoteNumNick: %s(%d)", cli_yxx(acptr),
          base64toint(cli_yxx(acptr)) & cli_serv(server)->nn_mask));
 
-  acptrp = &(cli_serv(server))->client_list[base64toint(cli_yxx(acptr)) & cli_serv(server)->nn_mask];
-  if (*acptrp) {
+  index = base64toint(cli_yxx(acptr)) & cli_serv(server)->nn_mask;
+  if ((old = nn_get(cli_serv(server), index))) {
     /*
      * this exits the old client in the array, not the client
      * that is being set
      */
-    exit_client(cli_from(acptr), *acptrp, server, "Numeric nick collision (Ghost)");
+    exit_client(cli_from(acptr), old, server, "Numeric nick collision (Ghost)");
   }
-  *acptrp = acptr;
+  nn_set(cli_serv(server), index, acptr);
 }
 
 
 /** Register numeric of new (local) client.
  * See @ref numnicks for more details.
- * Assign a numnick and add it to our client_list.
+ * Assign a numnick and add it to our client table.
  * @param[in] cptr %User being registered.
  */
 int SetLocalNumNick(struct Client *cptr)
 {
   static unsigned int last_nn     = 0;
-  struct Client**     client_list = cli_serv(&me)->client_list;
-  unsigned int        mask        = cli_serv(&me)->nn_mask;
+  struct Server*      serv        = cli_serv(&me);
+  unsigned int        mask        = serv->nn_mask;
   unsigned int        count       = 0;
 
   assert(cli_user(cptr)->server == &me);
 
-  while (client_list[last_nn & mask]) {
+  while (nn_get(serv, last_nn & mask)) {
     if (++count == NN_MAX_CLIENT) {
       assert(count < NN_MAX_CLIENT);
       return 0;
@@ -372,7 +456,7 @@ int SetLocalNumNick(struct Client *cptr)
     if (++last_nn == NN_MAX_CLIENT)
       last_nn = 0;
   }
-  client_list[last_nn & mask] = cptr;  /* Reserve the numeric ! */
+  nn_set(serv, last_nn & mask, cptr);  /* Reserve the numeric ! */
 
   inttobase64(cli_yxx(cptr), last_nn, 3);
   if (++last_nn == NN_MAX_CLIENT)
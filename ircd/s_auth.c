@@ -43,6 +43,7 @@
 #include "ircd_chattr.h"
 #include "ircd_events.h"
 #include "ircd_features.h"
+#include "ircd_intern.h"
 #include "ircd_log.h"
 #include "ircd_osdep.h"
 #include "ircd_reply.h"
@@ -87,6 +88,8 @@ enum AuthRequestFlag {
     AR_IAUTH_SOFT_DONE, /**< iauth has no objection to client */
     AR_PASSWORD_CHECKED, /**< client password already checked */
     AR_GLINE_CHECKED,   /**< checked for a G-line banning the client */
+    AR_IDENT_QUEUED,    /**< ident lookup waiting for a free slot */
+    AR_IAUTH_ORPHAN,    /**< iauth worker died before answering */
     AR_NUM_FLAGS
 };
 
@@ -96,6 +99,8 @@ DECLARE_FLAGSET(AuthRequestFlags, AR_NUM_FLAGS);
 struct AuthRequest {
   struct AuthRequest* next;       /**< linked list node ptr */
   struct AuthRequest* prev;       /**< linked list node ptr */
+  struct AuthRequest* ident_next; /**< next request waiting for ident_host */
+  struct IdentHost*   ident_host; /**< ident state for client's address */
   struct Client*      client;     /**< pointer to client struct for request */
   struct irc_sockaddr local;      /**< local endpoint address */
   struct irc_in_addr  original;   /**< original client IP address */
@@ -106,6 +111,25 @@ struct AuthRequest {
   unsigned short      port;       /**< client's remote port number */
 };
 
+/** Number of buckets in the ident host hash table. */
+#define IDENT_HOST_TABLE_SIZE 1024
+
+/** Ident lookup state for one client address.  Lookups beyond
+ * FEAT_IDENT_MAX_PER_HOST (or beyond FEAT_IDENT_MAX_PENDING in total)
+ * wait on the host's queue, and hosts without a working identd are
+ * remembered for FEAT_IDENT_FAIL_CACHE seconds.
+ */
+struct IdentHost {
+  struct IdentHost*   next;       /**< next host in hash bucket */
+  struct IdentHost*   run_next;   /**< next host with a runnable lookup */
+  struct AuthRequest* wait_head;  /**< first lookup waiting for this host */
+  struct AuthRequest* wait_tail;  /**< last lookup waiting for this host */
+  struct irc_in_addr  addr;       /**< client address */
+  time_t              noident;    /**< skip lookups until this time */
+  unsigned int        active;     /**< lookups in progress */
+  unsigned char       runnable;   /**< non-zero if on the run queue */
+};
+
 /** Array of message text (with length) pairs for AUTH status
  * messages.  Indexed using #ReportType.
  */
@@ -171,6 +195,7 @@ struct IAuth {
   uint64_t i_recvB;                     /**< bytes received */
   uint64_t i_sendB;                     /**< bytes sent */
   time_t started;                       /**< time that this instance was started */
+  time_t i_blocked;                     /**< time the socket buffer filled up */
   unsigned int i_recvM;                 /**< messages received */
   unsigned int i_sendM;                 /**< messages sent */
   unsigned int i_count;                 /**< characters used in i_buffer */
@@ -202,15 +227,48 @@ struct IAuth {
 /** Return debug level for \a iauth. */
 #define i_debug(iauth) ((iauth)->i_debug)
 
-/** Active instance of IAuth. */
-static struct IAuth *iauth;
+/** Maximum number of IAuth worker processes. */
+#define IAUTH_MAX_WORKERS 16
+/** Interval between IAuth worker health checks. */
+#define IAUTH_CHECK_INTERVAL 10
+
+/** Active IAuth worker processes. */
+static struct IAuth *iauth_pool[IAUTH_MAX_WORKERS];
+/** Number of entries in use in #iauth_pool. */
+static int iauth_count;
+/** One more than the index in #iauth_pool of the worker handling each
+ * client, by fd, or zero if the client has no worker.
+ */
+static unsigned char iauth_worker[MAXCONNECTIONS];
+/** Periodic timer that checks IAuth worker health. */
+static struct Timer iauth_check_timer;
+/** Timer that restarts workers and rehomes clients after a worker exits. */
+static struct Timer iauth_exit_timer;
 /** Freelist of AuthRequest structures. */
 static struct AuthRequest *auth_freelist;
+/** Hash table of ident host state. */
+static struct IdentHost *ident_table[IDENT_HOST_TABLE_SIZE];
+/** First host with a lookup that may be started. */
+static struct IdentHost *ident_run_head;
+/** Last host with a lookup that may be started. */
+static struct IdentHost *ident_run_tail;
+/** Number of ident lookups in progress. */
+static unsigned int ident_active;
+/** Timer that starts queued ident lookups. */
+static struct Timer ident_run_timer;
+/** Timer that expires unused ident host entries. */
+static struct Timer ident_expire_timer;
 
 static void iauth_sock_callback(struct Event *ev);
 static void iauth_stderr_callback(struct Event *ev);
 static int sendto_iauth(struct Client *cptr, const char *format, ...);
+static int iauth_send(struct IAuth *iauth, const char *format, ...);
+static struct IAuth *iauth_of(struct Client *cptr);
+static void iauth_disconnect(struct IAuth *iauth);
 static int preregister_user(struct Client *cptr);
+static int check_auth_finished(struct AuthRequest *auth, int bitclr);
+static int ident_connect(struct AuthRequest *auth);
+static void ident_schedule(struct IdentHost *host);
 typedef int (*iauth_cmd_handler)(struct IAuth *iauth, struct Client *cli,
 				 int parc, char **params);
 
@@ -247,8 +305,9 @@ static int auth_set_username(struct AuthRequest *auth)
 {
   struct Client *sptr = auth->client;
   struct User   *user = cli_user(sptr);
-  char *d;
-  char *s;
+  char username[USERLEN + 1];
+  const char *d;
+  const char *s;
   short upper = 0;
   short lower = 0;
   short leadcaps = 0;
@@ -260,11 +319,12 @@ static int auth_set_username(struct AuthRequest *auth)
 
   if (FlagHas(&auth->flags, AR_IAUTH_FUSERNAME))
   {
-    ircd_strncpy(user->username, cli_username(sptr), USERLEN);
+    intern_set(&user->username, cli_username(sptr), USERLEN);
   }
   else if (IsGotId(sptr))
   {
-    clean_username(user->username, cli_username(sptr));
+    clean_username(username, cli_username(sptr));
+    intern_set(&user->username, username, USERLEN);
   }
   /* else username was set by identd lookup (or failure thereof) */
 
@@ -364,7 +424,7 @@ static void iauth_notify(struct AuthRequest *auth, enum AuthRequestFlag flag)
   switch (flag)
   {
   case AR_AUTH_PENDING:
-    if (IAuthHas(iauth, IAUTH_UNDERNET))
+    if (IAuthHas(iauth_of(sptr), IAUTH_UNDERNET))
       sendto_iauth(sptr, "u %s", cli_username(sptr));
     break;
 
@@ -376,14 +436,14 @@ static void iauth_notify(struct AuthRequest *auth, enum AuthRequestFlag flag)
     break;
 
   case AR_NEEDS_USER:
-    if (IAuthHas(iauth, IAUTH_UNDERNET))
+    if (IAuthHas(iauth_of(sptr), IAUTH_UNDERNET))
       sendto_iauth(sptr, "U %s :%s", cli_user(sptr)->username, cli_info(sptr));
-    else if (IAuthHas(iauth, IAUTH_ADDLINFO))
+    else if (IAuthHas(iauth_of(sptr), IAUTH_ADDLINFO))
       sendto_iauth(sptr, "U %s", cli_user(sptr)->username);
     break;
 
   case AR_NEEDS_NICK:
-    if (IAuthHas(iauth, IAUTH_UNDERNET))
+    if (IAuthHas(iauth_of(sptr), IAUTH_UNDERNET))
       sendto_iauth(auth->client, "n %s", cli_name(sptr));
     break;
 
@@ -426,6 +486,7 @@ static int check_auth_finished(struct AuthRequest *auth, int bitclr)
   {
     struct User   *user;
     struct Client *sptr;
+    char username[USERLEN + 1];
     int killreason;
 
     /* Bail out until we have DNS and ident. */
@@ -443,18 +504,16 @@ static int check_auth_finished(struct AuthRequest *auth, int bitclr)
     user = cli_user(sptr);
     if (IsGotId(sptr))
     {
-      clean_username(user->username, cli_username(sptr));
+      clean_username(username, cli_username(sptr));
+      intern_set(&user->username, username, USERLEN);
     }
     else if (HasFlag(sptr, FLAG_DOID))
     {
       /* Prepend ~ to user->username. */
-      char *s = user->username;
-      int ii;
-      for (ii = USERLEN-1; ii > 0; ii--)
-        s[ii] = s[ii-1];
-      s[0] = (cli_wline(sptr) && !feature_bool(FEAT_HIS_WEBIRC))
+      username[0] = (cli_wline(sptr) && !feature_bool(FEAT_HIS_WEBIRC))
         ? '^' : '~';
-      s[USERLEN] = '\0';
+      ircd_strncpy(username + 1, user->username, USERLEN - 1);
+      intern_set(&user->username, username, USERLEN);
     } /* else cleaned version of client-provided name is in place */
 
     /* Check for K- or G-line. */
@@ -521,7 +580,7 @@ static int check_auth_finished(struct AuthRequest *auth, int bitclr)
       hurry_up = 1;
 
       /* If iauth wants it, give client more time. */
-      if (IAuthHas(iauth, IAUTH_EXTRAWAIT))
+      if (IAuthHas(iauth_of(auth->client), IAUTH_EXTRAWAIT))
         cli_firsttime(auth->client) = CurrentTime;
     }
 
@@ -546,7 +605,8 @@ static int check_auth_finished(struct AuthRequest *auth, int bitclr)
     if ((res == 0) && !from_iauth)
       iauth_notify(auth, (enum AuthRequestFlag)bitclr);
     /* Do we need to tell IAuth to hurry up? */
-    if ((res == 0) && hurry_up && IAuthHas(iauth, IAUTH_UNDERNET))
+    if ((res == 0) && hurry_up
+        && IAuthHas(iauth_of(auth->client), IAUTH_UNDERNET))
       sendto_iauth(auth->client, "H %s", get_client_class(auth->client));
   }
   if (res == 0)
@@ -603,8 +663,8 @@ static int preregister_user(struct Client *cptr)
   static time_t last_too_many1;
   static time_t last_too_many2;
 
-  ircd_strncpy(cli_user(cptr)->host, cli_sockhost(cptr), HOSTLEN);
-  ircd_strncpy(cli_user(cptr)->realhost, cli_sockhost(cptr), HOSTLEN);
+  intern_set(&cli_user(cptr)->host, cli_sockhost(cptr), HOSTLEN);
+  intern_set(&cli_user(cptr)->realhost, cli_sockhost(cptr), HOSTLEN);
 
   if (find_conf_client(cptr)) {
     return 0;
@@ -646,6 +706,208 @@ static int preregister_user(struct Client *cptr)
   return 0;
 }
 
+/** Calculate the ident host bucket for an address.
+ * @param[in] addr Client address.
+ * @return Hash bucket index.
+ */
+static unsigned int ident_hash(const struct irc_in_addr *addr)
+{
+  unsigned int hashv = 0;
+  int ii;
+
+  for (ii = 0; ii < 8; ++ii)
+    hashv = (hashv << 5) + hashv + addr->in6_16[ii];
+  hashv ^= hashv >> 13;
+  return hashv % IDENT_HOST_TABLE_SIZE;
+}
+
+/** Periodic timer callback to release idle ident host entries.
+ * @param[in] ev Timer event (ignored).
+ */
+static void ident_expire(struct Event *ev)
+{
+  struct IdentHost **pp;
+  struct IdentHost *host;
+  int ii;
+
+  if (ev_type(ev) != ET_EXPIRE)
+    return;
+
+  for (ii = 0; ii < IDENT_HOST_TABLE_SIZE; ++ii) {
+    for (pp = &ident_table[ii]; (host = *pp); ) {
+      if (host->active == 0 && !host->wait_head && !host->runnable
+          && host->noident <= CurrentTime) {
+        *pp = host->next;
+        MyFree(host);
+      } else
+        pp = &host->next;
+    }
+  }
+}
+
+/** Find (or create) the ident state for a client address.
+ * @param[in] addr Client address.
+ * @return Ident host entry for \a addr.
+ */
+static struct IdentHost *ident_host_get(const struct irc_in_addr *addr)
+{
+  struct IdentHost *host;
+  unsigned int hashv = ident_hash(addr);
+
+  for (host = ident_table[hashv]; host; host = host->next)
+    if (!memcmp(&host->addr, addr, sizeof(host->addr)))
+      return host;
+
+  host = (struct IdentHost *)MyCalloc(1, sizeof(*host));
+  memcpy(&host->addr, addr, sizeof(host->addr));
+  host->next = ident_table[hashv];
+  ident_table[hashv] = host;
+
+  if (!t_active(&ident_expire_timer))
+    timer_add(timer_init(&ident_expire_timer), ident_expire, 0,
+              TT_PERIODIC, 60);
+  return host;
+}
+
+/** Check whether the global ident lookup limit has room.
+ * @return Non-zero if fewer than FEAT_IDENT_MAX_PENDING lookups run.
+ */
+static int ident_slot_free(void)
+{
+  int max_pending = feature_int(FEAT_IDENT_MAX_PENDING);
+
+  return max_pending <= 0 || ident_active < (unsigned int)max_pending;
+}
+
+/** Check whether the per-host limit allows a lookup for \a host.
+ * @param[in] host Ident host entry.
+ * @return Non-zero if fewer than FEAT_IDENT_MAX_PER_HOST lookups run.
+ */
+static int ident_host_can_start(const struct IdentHost *host)
+{
+  int max_host = feature_int(FEAT_IDENT_MAX_PER_HOST);
+
+  return max_host <= 0 || host->active < (unsigned int)max_host;
+}
+
+/** Check whether another ident lookup may be started for \a host.
+ * @param[in] host Ident host entry.
+ * @return Non-zero if neither the global nor the per-host limit is hit.
+ */
+static int ident_can_start(const struct IdentHost *host)
+{
+  return ident_slot_free() && ident_host_can_start(host);
+}
+
+/** Start queued ident lookups, as limits allow.
+ * This runs from a timer so that starting (and possibly failing) a
+ * lookup never happens in the middle of another client's processing.
+ * @param[in] ev Timer event (ignored).
+ */
+static void ident_run_queue(struct Event *ev)
+{
+  struct IdentHost *host;
+  struct AuthRequest *auth;
+
+  if (ev_type(ev) != ET_EXPIRE)
+    return;
+
+  while ((host = ident_run_head) && ident_slot_free()) {
+    ident_run_head = host->run_next;
+    if (!ident_run_head)
+      ident_run_tail = NULL;
+    host->run_next = NULL;
+    host->runnable = 0;
+
+    if (!(auth = host->wait_head) || !ident_host_can_start(host))
+      continue;
+    host->wait_head = auth->ident_next;
+    if (!host->wait_head)
+      host->wait_tail = NULL;
+    auth->ident_next = NULL;
+    FlagClr(&auth->flags, AR_IDENT_QUEUED);
+
+    if (host->noident > CurrentTime) {
+      auth->ident_host = NULL;
+      ++ServerStats->is_askip;
+      if (IsUserPort(auth->client))
+        sendheader(auth->client, REPORT_FAIL_ID);
+      check_auth_finished(auth, AR_AUTH_PENDING);
+    } else if (!ident_connect(auth)) {
+      check_auth_finished(auth, AR_AUTH_PENDING);
+    }
+
+    ident_schedule(host);
+  }
+}
+
+/** Put \a host on the run queue if it has a lookup that may start.
+ * Only the per-host limit is checked here; hosts wait on the run queue
+ * until ident_run_queue() finds a free global slot for them.
+ * @param[in] host Ident host entry.
+ */
+static void ident_schedule(struct IdentHost *host)
+{
+  if (!host->wait_head || host->runnable || !ident_host_can_start(host))
+    return;
+
+  host->runnable = 1;
+  if (ident_run_tail)
+    ident_run_tail->run_next = host;
+  else
+    ident_run_head = host;
+  ident_run_tail = host;
+
+  if (ident_slot_free() && !t_onqueue(&ident_run_timer))
+    timer_add(&ident_run_timer, ident_run_queue, 0, TT_RELATIVE, 0);
+}
+
+/** Release the ident lookup slot (or queue position) held by \a auth.
+ * @param[in] auth Authorization request whose lookup is finished.
+ * @param[in] noident If non-zero, the client's host has no usable
+ *   identd and later lookups for it should be skipped for a while.
+ */
+static void ident_release(struct AuthRequest *auth, int noident)
+{
+  struct IdentHost *host = auth->ident_host;
+  struct AuthRequest **pp;
+
+  if (!host)
+    return;
+  auth->ident_host = NULL;
+
+  if (FlagHas(&auth->flags, AR_IDENT_QUEUED)) {
+    FlagClr(&auth->flags, AR_IDENT_QUEUED);
+    for (pp = &host->wait_head; *pp; pp = &(*pp)->ident_next) {
+      if (*pp == auth) {
+        *pp = auth->ident_next;
+        break;
+      }
+    }
+    if (host->wait_tail == auth) {
+      host->wait_tail = NULL;
+      for (auth = host->wait_head; auth; auth = auth->ident_next)
+        host->wait_tail = auth;
+    }
+    return;
+  }
+
+  if (-1 < s_fd(&auth->socket)) {
+    close(s_fd(&auth->socket));
+    socket_del(&auth->socket);
+    s_fd(&auth->socket) = -1;
+  }
+  assert(host->active > 0);
+  --host->active;
+  --ident_active;
+  if (noident && feature_int(FEAT_IDENT_FAIL_CACHE) > 0)
+    host->noident = CurrentTime + feature_int(FEAT_IDENT_FAIL_CACHE);
+
+  ident_schedule(host);
+  if (ident_run_head && !t_onqueue(&ident_run_timer))
+    timer_add(&ident_run_timer, ident_run_queue, 0, TT_RELATIVE, 0);
+}
+
 /** Send the ident server a query giving "theirport , ourport". The
  * write is only attempted *once* so it is deemed to be a fail if the
  * entire write doesn't write all the data given.  This shouldn't be a
@@ -664,9 +926,7 @@ static void send_auth_query(struct AuthRequest* auth)
                 auth->port, auth->local.port);
 
   if (IO_SUCCESS != os_send_nonb(s_fd(&auth->socket), authbuf, strlen(authbuf), &count)) {
-    close(s_fd(&auth->socket));
-    socket_del(&auth->socket);
-    s_fd(&auth->socket) = -1;
+    ident_release(auth, 0);
     ++ServerStats->is_abad;
     if (IsUserPort(auth->client))
       sendheader(auth->client, REPORT_FAIL_ID);
@@ -764,6 +1024,7 @@ static void read_auth_reply(struct AuthRequest* auth)
 {
   char*        username = 0;
   unsigned int len;
+  int          noident;
   /*
    * rfc1453 sez we MUST accept 512 bytes
    */
@@ -780,10 +1041,11 @@ static void read_auth_reply(struct AuthRequest* auth)
     Debug((DEBUG_INFO, "Username: %s", username));
   }
 
+  /* A connect that fails outright means there is no identd to ask. */
+  noident = (s_state(&auth->socket) == SS_CONNECTING);
+
   Debug((DEBUG_INFO, "Deleting auth [%d] socket %p", auth, cli_fd(auth->client)));
-  close(s_fd(&auth->socket));
-  socket_del(&auth->socket);
-  s_fd(&auth->socket) = -1;
+  ident_release(auth, noident);
 
   if (EmptyString(username)) {
     if (IsUserPort(auth->client))
@@ -850,6 +1112,7 @@ void destroy_auth_request(struct AuthRequest* auth)
     delete_resolver_queries(auth);
   }
 
+  ident_release(auth, 0);
   if (-1 < s_fd(&auth->socket)) {
     close(s_fd(&auth->socket));
     socket_del(&auth->socket);
@@ -899,7 +1162,7 @@ int auth_ping_timeout(struct Client *cptr)
 
   /* Check for iauth timeout. */
   if (FlagHas(&auth->flags, AR_IAUTH_PENDING)) {
-    if (IAuthHas(iauth, IAUTH_REQUIRED)
+    if (IAuthHas(iauth_of(cptr), IAUTH_REQUIRED)
         && !FlagHas(&auth->flags, AR_IAUTH_SOFT_DONE)) {
       sendheader(cptr, REPORT_FAIL_IAUTH);
       return exit_client_msg(cptr, cptr, &me, "Authorization Timeout");
@@ -934,6 +1197,7 @@ static void auth_timeout_callback(struct Event* ev)
     /* Notify client if ident lookup failed. */
     if (FlagHas(&auth->flags, AR_AUTH_PENDING)) {
       flag = AR_AUTH_PENDING;
+      ident_release(auth, !FlagHas(&auth->flags, AR_IDENT_QUEUED));
       if (IsUserPort(auth->client))
         sendheader(auth->client, REPORT_FAIL_ID);
     }
@@ -1004,21 +1268,20 @@ static void auth_dns_callback(void* vptr, const struct irc_in_addr *addr, const
   check_auth_finished(auth, AR_DNS_PENDING);
 }
 
-/** Flag the client to show an attempt to contact the ident server on
- * the client's host.  Should the connect or any later phase of the
- * identifying process fail, it is aborted and the user is given a
- * username of "unknown".
+/** Open the ident connection for \a auth and count it against the
+ * ident limits.  auth->ident_host must already be set.
  * @param[in] auth The request for which to start the ident lookup.
+ * @return Non-zero if the lookup is in progress, zero if it failed.
  */
-static void start_auth_query(struct AuthRequest* auth)
+static int ident_connect(struct AuthRequest* auth)
 {
   struct irc_sockaddr remote_addr;
   struct irc_sockaddr local_addr;
+  struct IdentHost*   host = auth->ident_host;
   int                 fd;
   IOResult            result;
 
-  assert(0 != auth);
-  assert(0 != auth->client);
+  assert(0 != host);
 
   /*
    * get the local address of the client and bind to that to
@@ -1033,28 +1296,77 @@ static void start_auth_query(struct AuthRequest* auth)
   remote_addr.port = 113;
   fd = os_socket(&local_addr, SOCK_STREAM, "auth query", 0);
   if (fd < 0) {
+    auth->ident_host = NULL;
     ++ServerStats->is_abad;
     if (IsUserPort(auth->client))
       sendheader(auth->client, REPORT_FAIL_ID);
-    return;
+    return 0;
   }
-  if (IsUserPort(auth->client))
+  /* Queued lookups already told the client. */
+  if (IsUserPort(auth->client) && !FlagHas(&auth->flags, AR_AUTH_PENDING))
     sendheader(auth->client, REPORT_DO_ID);
 
   if ((result = os_connect_nonb(fd, &remote_addr)) == IO_FAILURE ||
       !socket_add(&auth->socket, auth_sock_callback, (void*) auth,
                   result == IO_SUCCESS ? SS_CONNECTED : SS_CONNECTING,
                   SOCK_EVENT_READABLE, fd)) {
+    auth->ident_host = NULL;
+    if (result == IO_FAILURE && feature_int(FEAT_IDENT_FAIL_CACHE) > 0)
+      host->noident = CurrentTime + feature_int(FEAT_IDENT_FAIL_CACHE);
     ++ServerStats->is_abad;
     if (IsUserPort(auth->client))
       sendheader(auth->client, REPORT_FAIL_ID);
     close(fd);
-    return;
+    return 0;
   }
 
+  ++host->active;
+  ++ident_active;
   FlagSet(&auth->flags, AR_AUTH_PENDING);
   if (result == IO_SUCCESS)
     send_auth_query(auth);
+  return 1;
+}
+
+/** Flag the client to show an attempt to contact the ident server on
+ * the client's host.  Should the connect or any later phase of the
+ * identifying process fail, it is aborted and the user is given a
+ * username of "unknown".  Hosts recently found to have no identd are
+ * skipped, and lookups over the concurrency limits are queued.
+ * @param[in] auth The request for which to start the ident lookup.
+ */
+static void start_auth_query(struct AuthRequest* auth)
+{
+  struct IdentHost* host;
+
+  assert(0 != auth);
+  assert(0 != auth->client);
+
+  host = ident_host_get(&cli_ip(auth->client));
+  if (host->noident > CurrentTime) {
+    ++ServerStats->is_askip;
+    if (IsUserPort(auth->client))
+      sendheader(auth->client, REPORT_FAIL_ID);
+    return;
+  }
+
+  auth->ident_host = host;
+  if (ident_can_start(host)) {
+    ident_connect(auth);
+    return;
+  }
+
+  if (IsUserPort(auth->client))
+    sendheader(auth->client, REPORT_DO_ID);
+  ++ServerStats->is_aqueue;
+  FlagSet(&auth->flags, AR_AUTH_PENDING);
+  FlagSet(&auth->flags, AR_IDENT_QUEUED);
+  if (host->wait_tail)
+    host->wait_tail->ident_next = auth;
+  else
+    host->wait_head = auth;
+  host->wait_tail = auth;
+  ident_schedule(host);
 }
 
 /** Initiate DNS lookup for a client.
@@ -1080,18 +1392,113 @@ static void start_dns_query(struct AuthRequest *auth)
   gethost_byaddr(&cli_ip(auth->client), auth_dns_callback, auth);
 }
 
+/** Find the %IAuth worker responsible for a client.
+ * @param[in] cptr Local client.
+ * @return Worker that was given the client, or NULL if there is none.
+ */
+static struct IAuth *iauth_of(struct Client *cptr)
+{
+  int fd = cli_fd(cptr);
+
+  if (fd < 0 || !iauth_worker[fd] || iauth_worker[fd] > iauth_count)
+    return NULL;
+  return iauth_pool[iauth_worker[fd] - 1];
+}
+
+/** Choose the %IAuth worker for a client.
+ * Clients are spread across the workers by file descriptor.  If that
+ * worker is not running, or it already has IAUTH_BACKLOG bytes of
+ * requests it has not read, the first worker found with room is used
+ * instead, falling back to the running worker with the shortest queue.
+ * @param[in] cptr Client about to be sent to iauth.
+ * @return Selected worker, or NULL if no worker is running.
+ */
+static struct IAuth *iauth_select(struct Client *cptr)
+{
+  struct IAuth *ia;
+  unsigned int backlog, length, best_length = 0;
+  int fd, ii, idx, best = -1;
+
+  fd = cli_fd(cptr);
+  if (fd < 0 || iauth_count == 0)
+    return NULL;
+  backlog = feature_int(FEAT_IAUTH_BACKLOG);
+  for (ii = 0; ii < iauth_count; ++ii) {
+    idx = (fd + ii) % iauth_count;
+    ia = iauth_pool[idx];
+    if (!i_GetConnected(ia))
+      continue;
+    length = MsgQLength(i_sendQ(ia));
+    if (!IAuthHas(ia, IAUTH_BLOCKED) && (backlog == 0 || length < backlog)) {
+      best = idx;
+      break;
+    }
+    if (best < 0 || length < best_length) {
+      best = idx;
+      best_length = length;
+    }
+  }
+  if (best < 0)
+    return NULL;
+  iauth_worker[fd] = best + 1;
+  return iauth_pool[best];
+}
+
 /** Initiate IAuth check for a client.
  * @param[in] auth The auth request for which to star the IAuth check.
  */
 static void start_iauth_query(struct AuthRequest *auth)
 {
   FlagSet(&auth->flags, AR_IAUTH_PENDING);
-  if (!sendto_iauth(auth->client, "C %s %hu %s %hu",
-                    cli_sock_ip(auth->client), auth->port,
-                    ircd_ntoa(&auth->local.addr), auth->local.port))
+  if (!iauth_select(auth->client)
+      || !sendto_iauth(auth->client, "C %s %hu %s %hu",
+                       cli_sock_ip(auth->client), auth->port,
+                       ircd_ntoa(&auth->local.addr), auth->local.port))
     FlagClr(&auth->flags, AR_IAUTH_PENDING);
 }
 
+/** Hand clients whose %IAuth worker died to another worker.
+ * The new worker is sent the client's connection details followed by
+ * each registration step the client has already completed, in the
+ * order the first worker saw them: hostname, ident, password, user,
+ * nick and, for a client only waiting on iauth, hurry-up.  Clients
+ * stay orphaned while no worker is running, so the usual registration
+ * timeout and iauth policy still apply to them.
+ */
+static void iauth_adopt_orphans(void)
+{
+  struct AuthRequest *auth;
+  struct Client *cptr;
+  int fd;
+
+  for (fd = 0; fd <= HighestFd; ++fd) {
+    if (!(cptr = LocalClientArray[fd])
+        || !(auth = cli_auth(cptr))
+        || !FlagHas(&auth->flags, AR_IAUTH_ORPHAN))
+      continue;
+    if (!iauth_select(cptr))
+      break;
+    FlagClr(&auth->flags, AR_IAUTH_ORPHAN);
+    start_iauth_query(auth);
+    if (!FlagHas(&auth->flags, AR_IAUTH_PENDING))
+      continue;
+    if (!FlagHas(&auth->flags, AR_DNS_PENDING))
+      iauth_notify(auth, AR_DNS_PENDING);
+    if (!FlagHas(&auth->flags, AR_AUTH_PENDING))
+      iauth_notify(auth, AR_AUTH_PENDING);
+    if (cli_passwd(cptr)[0] != '\0'
+        && IAuthHas(iauth_of(cptr), IAUTH_ADDLINFO))
+      sendto_iauth(cptr, "P :%s", cli_passwd(cptr));
+    if (!FlagHas(&auth->flags, AR_NEEDS_USER))
+      iauth_notify(auth, AR_NEEDS_USER);
+    if (!FlagHas(&auth->flags, AR_NEEDS_NICK))
+      iauth_notify(auth, AR_NEEDS_NICK);
+    if (FlagHas(&auth->flags, AR_IAUTH_HURRY)
+        && IAuthHas(iauth_of(cptr), IAUTH_UNDERNET))
+      sendto_iauth(cptr, "H %s", get_client_class(cptr));
+  }
+}
+
 /** Starts auth (identd) and dns queries for a client.
  * @param[in] client The client for which to start queries.
  */
@@ -1109,6 +1516,7 @@ void start_auth(struct Client* client)
   if (cli_fd(client) > HighestFd)
     HighestFd = cli_fd(client);
   LocalClientArray[cli_fd(client)] = client;
+  iauth_worker[cli_fd(client)] = 0;
   socket_events(&(cli_socket(client)), SOCK_ACTION_SET | SOCK_EVENT_READABLE);
 
   /* Allocate the AuthRequest. */
@@ -1197,14 +1605,16 @@ int auth_set_pong(struct AuthRequest *auth, unsigned int cookie)
 int auth_set_user(struct AuthRequest *auth, const char *username, const char *hostname, const char *servername, const char *userinfo)
 {
   struct Client *cptr;
+  char cleaned[USERLEN + 1];
 
   assert(auth != NULL);
   if (FlagHas(&auth->flags, AR_IAUTH_HURRY))
     return 0;
   cptr = auth->client;
-  ircd_strncpy(cli_info(cptr), userinfo, REALLEN);
-  clean_username(cli_user(cptr)->username, username);
-  ircd_strncpy(cli_user(cptr)->host, cli_sockhost(cptr), HOSTLEN);
+  intern_set(&cli_info(cptr), userinfo, REALLEN);
+  clean_username(cleaned, username);
+  intern_set(&cli_user(cptr)->username, cleaned, USERLEN);
+  intern_set(&cli_user(cptr)->host, cli_sockhost(cptr), HOSTLEN);
   return check_auth_finished(auth, AR_NEEDS_USER);
 }
 
@@ -1239,7 +1649,7 @@ int auth_set_nick(struct AuthRequest *auth, const char *nickname)
 int auth_set_password(struct AuthRequest *auth, const char *password)
 {
   assert(auth != NULL);
-  if (IAuthHas(iauth, IAUTH_ADDLINFO))
+  if (IAuthHas(iauth_of(auth->client), IAUTH_ADDLINFO))
     sendto_iauth(auth->client, "P :%s", password);
   return 0;
 }
@@ -1250,17 +1660,27 @@ int auth_set_password(struct AuthRequest *auth, const char *password)
 void auth_send_exit(struct Client *cptr)
 {
   sendto_iauth(cptr, "D");
+  /* The descriptor may be reused; forget which worker it went to. */
+  if (cli_fd(cptr) >= 0)
+    iauth_worker[cli_fd(cptr)] = 0;
 }
 
 /** Forward an XREPLY on to iauth.
  * @param[in] sptr Source of the XREPLY.
- * @param[in] routing Routing information for the original XQUERY.
+ * @param[in] routing Routing information for the original XQUERY,
+ *   starting with the index of the worker that sent it.
  * @param[in] reply Contents of the reply.
  */
 void auth_send_xreply(struct Client *sptr, const char *routing,
 		      const char *reply)
 {
-  sendto_iauth(NULL, "X %#C %s :%s", sptr, routing, reply);
+  unsigned long idx;
+  char *end;
+
+  idx = strtoul(routing, &end, 10);
+  if (end == routing || *end != ':' || idx >= (unsigned long)iauth_count)
+    return;
+  iauth_send(iauth_pool[idx], "X %#C %s :%s", sptr, end + 1, reply);
 }
 
 /** Mark that a user has started capabilities negotiation.
@@ -1322,7 +1742,7 @@ int auth_spoof_user(struct AuthRequest *auth, const char *username, const char *
   }
 
   start_iauth_query(auth);
-  if (IAuthHas(iauth, IAUTH_UNDERNET))
+  if (IAuthHas(iauth_of(sptr), IAUTH_UNDERNET))
     sendto_iauth(sptr, "u %s", cli_username(sptr));
 
   return check_auth_finished(auth, 0);
@@ -1429,7 +1849,7 @@ int iauth_do_spawn(struct IAuth *iauth, int automatic)
      * Need to use conf_get_local() since &me may not be fully
      * initialized the first time we run.
      */
-    sendto_iauth(NULL, "M %s %d", conf_get_local()->name, MAXCONNECTIONS);
+    iauth_send(iauth, "M %s %d", conf_get_local()->name, MAXCONNECTIONS);
     /* Indicate success (until the child dies). */
     return 0;
   }
@@ -1449,65 +1869,169 @@ int iauth_do_spawn(struct IAuth *iauth, int automatic)
   exit(EXIT_FAILURE);
 }
 
-/** See if an %IAuth program must be spawned.
- * If a process is already running with the specified options, keep it.
- * Otherwise spawn a new child process to perform the %IAuth function.
+/** Free a list of strings received from iauth.
+ * @param[in] head First element of the list.
+ */
+static void iauth_free_strings(struct SLink *head)
+{
+  struct SLink *next;
+
+  for (; head; head = next) {
+    next = head->next;
+    MyFree(head->value.cp);
+    free_link(head);
+  }
+}
+
+/** Restart %IAuth workers that are not running, then hand any
+ * clients left behind by dead workers to the surviving ones.
+ */
+static void iauth_revive(void)
+{
+  struct IAuth *ia;
+  int ii;
+
+  for (ii = 0; ii < iauth_count; ++ii) {
+    ia = iauth_pool[ii];
+    if (!IAuthHas(ia, IAUTH_CLOSING) && !i_GetConnected(ia))
+      iauth_do_spawn(ia, 1);
+  }
+  iauth_adopt_orphans();
+}
+
+/** Timer callback run after an %IAuth worker exits.
+ * @param[in] ev Timer event (ignored).
+ */
+static void iauth_exited(struct Event *ev)
+{
+  if (ev_type(ev) == ET_EXPIRE)
+    iauth_revive();
+}
+
+/** Check the health of the %IAuth workers.
+ * Workers that have not read their requests for IAUTH_STALL seconds
+ * are killed so that they restart, and workers that exited too
+ * quickly to be restarted at once are given another chance.
+ * @param[in] ev Timer event (ignored).
+ */
+static void iauth_check(struct Event *ev)
+{
+  struct IAuth *ia;
+  int ii, stall;
+
+  if (ev_type(ev) != ET_EXPIRE)
+    return;
+
+  stall = feature_int(FEAT_IAUTH_STALL);
+  for (ii = 0; ii < iauth_count; ++ii) {
+    ia = iauth_pool[ii];
+    if (stall > 0 && i_GetConnected(ia) && IAuthHas(ia, IAUTH_BLOCKED)
+        && CurrentTime - ia->i_blocked >= stall) {
+      log_write(LS_IAUTH, L_ERROR, 0, "IAuth worker %d stalled", ii);
+      sendto_opmask(NULL, SNO_AUTH, "IAuth worker %d stalled, restarting it.",
+                    ii);
+      iauth_disconnect(ia);
+    }
+  }
+  iauth_revive();
+}
+
+/** See if %IAuth programs must be spawned.
+ * If processes are already running with the specified options, keep
+ * them.  Otherwise spawn new child processes to perform the %IAuth
+ * function.
  * @param[in] argc Number of parameters to use when starting process.
  * @param[in] argv Array of parameters to start process.
+ * @param[in] workers Number of worker processes to run.
  * @return 0 on failure, 1 on new process, 2 on reuse of existing process.
  */
-int auth_spawn(int argc, char *argv[])
+int auth_spawn(int argc, char *argv[], int workers)
 {
-  int ii;
+  struct IAuth *ia;
+  int ii, res = 2;
 
-  if (iauth) {
+  if (workers < 1)
+    workers = 1;
+  else if (workers > IAUTH_MAX_WORKERS)
+    workers = IAUTH_MAX_WORKERS;
+
+  if (iauth_count > 0) {
     int same = 1;
 
     /* Check that incoming arguments all match pre-existing arguments. */
+    ia = iauth_pool[0];
     for (ii = 0; same && (ii < argc); ++ii) {
-      if (NULL == iauth->i_argv[ii]
-          || 0 != strcmp(iauth->i_argv[ii], argv[ii]))
+      if (NULL == ia->i_argv[ii]
+          || 0 != strcmp(ia->i_argv[ii], argv[ii]))
         same = 0;
     }
     /* Check that we have no more pre-existing arguments. */
-    if (same && iauth->i_argv[ii])
+    if (same && ia->i_argv[ii])
       same = 0;
-    /* If they are the same and still connected, clear the "closing" flag and exit. */
-    if (same && i_GetConnected(iauth)) {
-      Debug((DEBUG_INFO, "Reusing existing IAuth process"));
-      IAuthClr(iauth, IAUTH_CLOSING);
-      return 2;
-    }
-    auth_close_unused();
-  }
-
-  /* Need to initialize a new connection. */
-  iauth = MyCalloc(1, sizeof(*iauth));
-  msgq_init(i_sendQ(iauth));
-  /* Populate iauth's argv array. */
-  iauth->i_argv = MyCalloc(argc + 1, sizeof(iauth->i_argv[0]));
-  for (ii = 0; ii < argc; ++ii)
-    DupString(iauth->i_argv[ii], argv[ii]);
-  iauth->i_argv[ii] = NULL;
-  /* Try to spawn it, and handle the results. */
-  if (iauth_do_spawn(iauth, 0))
-    return 0;
-  IAuthClr(iauth, IAUTH_CLOSING);
-  return 1;
+    /* If they are the same, keep as many workers as we still need;
+     * any extra ones stay marked as closing.
+     */
+    if (same) {
+      for (ii = 0; ii < iauth_count && ii < workers; ++ii) {
+        ia = iauth_pool[ii];
+        IAuthClr(ia, IAUTH_CLOSING);
+        if (i_GetConnected(ia))
+          Debug((DEBUG_INFO, "Reusing existing IAuth process"));
+        else if (iauth_do_spawn(ia, 0))
+          res = 0;
+        else if (res)
+          res = 1;
+      }
+    } else
+      auth_close_unused();
+  }
+
+  /* Initialize any new connections we need. */
+  while (iauth_count < workers) {
+    ia = MyCalloc(1, sizeof(*ia));
+    msgq_init(i_sendQ(ia));
+    s_fd(i_socket(ia)) = -1;
+    s_fd(i_stderr(ia)) = -1;
+    /* Populate the worker's argv array. */
+    ia->i_argv = MyCalloc(argc + 1, sizeof(ia->i_argv[0]));
+    for (ii = 0; ii < argc; ++ii)
+      DupString(ia->i_argv[ii], argv[ii]);
+    ia->i_argv[ii] = NULL;
+    iauth_pool[iauth_count++] = ia;
+    /* Try to spawn it, and handle the results. */
+    if (iauth_do_spawn(ia, 0))
+      res = 0;
+    else if (res)
+      res = 1;
+  }
+
+  /* Watch over the workers from now on. */
+  if (!t_active(&iauth_check_timer))
+    timer_add(timer_init(&iauth_check_timer), iauth_check, 0,
+              TT_PERIODIC, IAUTH_CHECK_INTERVAL);
+  return res;
 }
 
 /** Mark all %IAuth connections as closing. */
 void auth_mark_closing(void)
 {
-  if (iauth)
-    IAuthSet(iauth, IAUTH_CLOSING);
+  int ii;
+
+  for (ii = 0; ii < iauth_count; ++ii)
+    IAuthSet(iauth_pool[ii], IAUTH_CLOSING);
 }
 
 /** Complete disconnection of an %IAuth connection.
+ * Clients still waiting for an answer from it are marked as orphans,
+ * to be handed to another worker.
  * @param[in] iauth %Connection to fully close.
  */
 static void iauth_disconnect(struct IAuth *iauth)
 {
+  struct AuthRequest *auth;
+  struct Client *cptr;
+  int fd;
+
   if (iauth == NULL)
     return;
 
@@ -1524,21 +2048,65 @@ static void iauth_disconnect(struct IAuth *iauth)
     socket_del(i_socket(iauth));
     s_fd(i_socket(iauth)) = -1;
   }
+
+  /* Forget anything meant for the old process. */
+  MsgQClear(i_sendQ(iauth));
+  IAuthClr(iauth, IAUTH_BLOCKED);
+  iauth->i_count = 0;
+  iauth->i_errcount = 0;
+
+  /* Find the clients it was working on. */
+  for (fd = 0; fd <= HighestFd; ++fd)
+    if ((cptr = LocalClientArray[fd])
+        && (auth = cli_auth(cptr))
+        && FlagHas(&auth->flags, AR_IAUTH_PENDING)
+        && iauth_of(cptr) == iauth)
+      FlagSet(&auth->flags, AR_IAUTH_ORPHAN);
+
+  /* Restart it (unless it is going away) and rehome its clients once
+   * we are out of whatever callback noticed the failure.
+   */
+  if (!t_onqueue(&iauth_exit_timer))
+    timer_add(&iauth_exit_timer, iauth_exited, 0, TT_RELATIVE, 0);
 }
 
-/** Close all %IAuth connections marked as closing. */
+/** Close all %IAuth connections marked as closing.
+ * The remaining workers are moved down in #iauth_pool, so each
+ * client's entry in #iauth_worker is renumbered to match.  Clients of
+ * a closed worker are left without one; those still waiting were
+ * marked as orphans and will be given a new worker.
+ */
 void auth_close_unused(void)
 {
-  if (IAuthHas(iauth, IAUTH_CLOSING)) {
-    int ii;
-    iauth_disconnect(iauth);
-    if (iauth->i_argv) {
-      for (ii = 0; iauth->i_argv[ii]; ++ii)
-        MyFree(iauth->i_argv[ii]);
-      MyFree(iauth->i_argv);
+  unsigned char remap[IAUTH_MAX_WORKERS];
+  struct IAuth *ia;
+  int ii, jj;
+
+  for (ii = jj = 0; ii < iauth_count; ++ii) {
+    ia = iauth_pool[ii];
+    if (!IAuthHas(ia, IAUTH_CLOSING)) {
+      iauth_pool[jj++] = ia;
+      remap[ii] = jj;
+      continue;
+    }
+    remap[ii] = 0;
+    iauth_disconnect(ia);
+    if (ia->i_argv) {
+      int kk;
+      for (kk = 0; ia->i_argv[kk]; ++kk)
+        MyFree(ia->i_argv[kk]);
+      MyFree(ia->i_argv);
     }
-    MyFree(iauth);
+    iauth_free_strings(ia->i_config);
+    iauth_free_strings(ia->i_stats);
+    MyFree(ia->i_version);
+    MyFree(ia);
   }
+  if (jj < iauth_count)
+    for (ii = 0; ii < MAXCONNECTIONS; ++ii)
+      if (iauth_worker[ii] && iauth_worker[ii] <= iauth_count)
+        iauth_worker[ii] = remap[iauth_worker[ii] - 1];
+  iauth_count = jj;
 }
 
 /** Send queued output to \a iauth.
@@ -1562,6 +2130,7 @@ static void iauth_write(struct IAuth *iauth)
       /* If bytes_sent < bytes_tried, fall through to IO_BLOCKED. */
     case IO_BLOCKED:
       IAuthSet(iauth, IAUTH_BLOCKED);
+      iauth->i_blocked = CurrentTime;
       socket_events(i_socket(iauth), SOCK_ACTION_ADD | SOCK_EVENT_WRITABLE);
       return;
     case IO_FAILURE:
@@ -1573,36 +2142,65 @@ static void iauth_write(struct IAuth *iauth)
   socket_events(i_socket(iauth), SOCK_ACTION_DEL | SOCK_EVENT_WRITABLE);
 }
 
-/** Send a message to iauth.
- * @param[in] cptr Optional client context for message.
+/** Queue a message for \a iauth and try to send it.
+ * @param[in] iauth Connected worker to send to.
+ * @param[in] id Client identifier for the message, or -1.
+ * @param[in] vd Format string and arguments for the message.
+ */
+static void iauth_queue(struct IAuth *iauth, int id, struct VarData *vd)
+{
+  struct MsgBuf *mb;
+
+  mb = msgq_make(NULL, "%d %v", id, vd);
+  ++iauth->i_sendM;
+  msgq_add(i_sendQ(iauth), mb, 0);
+  msgq_clean(mb);
+  iauth_write(iauth);
+}
+
+/** Send a message about a client to its iauth worker.
+ * @param[in] cptr Client context for message.
  * @param[in] format Format string for message.
  * @return Non-zero on successful send or buffering, zero on failure.
  */
 static int sendto_iauth(struct Client *cptr, const char *format, ...)
 {
   struct VarData vd;
-  struct MsgBuf *mb;
+  struct IAuth *iauth;
 
-  /* Do not send requests when we have no iauth. */
-  if (!i_GetConnected(iauth))
-    return 0;
   /* Do not send for clients in the NORMAL state. */
-  if (cptr
-      && (format[0] != 'D')
+  if ((format[0] != 'D')
       && (!cli_auth(cptr) || !FlagHas(&cli_auth(cptr)->flags, AR_IAUTH_PENDING)))
     return 0;
+  /* Do not send requests when the client's worker is gone. */
+  iauth = iauth_of(cptr);
+  if (!i_GetConnected(iauth))
+    return 0;
 
-  /* Build the message buffer. */
+  /* Build the message and tack it onto the worker's sendq. */
   vd.vd_format = format;
   va_start(vd.vd_args, format);
-  mb = msgq_make(NULL, "%d %v", cptr ? cli_fd(cptr) : -1, &vd);
+  iauth_queue(iauth, cli_fd(cptr), &vd);
   va_end(vd.vd_args);
+  return 1;
+}
 
-  /* Tack it onto the iauth sendq and try to write it. */
-  ++iauth->i_sendM;
-  msgq_add(i_sendQ(iauth), mb, 0);
-  msgq_clean(mb);
-  iauth_write(iauth);
+/** Send a message that is not about a client to an iauth worker.
+ * @param[in] iauth Worker to send to.
+ * @param[in] format Format string for message.
+ * @return Non-zero on successful send or buffering, zero on failure.
+ */
+static int iauth_send(struct IAuth *iauth, const char *format, ...)
+{
+  struct VarData vd;
+
+  if (!i_GetConnected(iauth))
+    return 0;
+
+  vd.vd_format = format;
+  va_start(vd.vd_args, format);
+  iauth_queue(iauth, -1, &vd);
+  va_end(vd.vd_args);
   return 1;
 }
 
@@ -1747,15 +2345,10 @@ static int iauth_cmd_newconfig(struct IAuth *iauth, struct Client *cli,
 			       int parc, char **params)
 {
   struct SLink *head;
-  struct SLink *next;
 
   head = iauth->i_config;
   iauth->i_config = NULL;
-  for (; head; head = next) {
-    next = head->next;
-    MyFree(head->value.cp);
-    free_link(head);
-  }
+  iauth_free_strings(head);
   sendto_opmask(NULL, SNO_AUTH, "New iauth configuration.");
   return 0;
 }
@@ -1794,15 +2387,10 @@ static int iauth_cmd_newstats(struct IAuth *iauth, struct Client *cli,
 			      int parc, char **params)
 {
   struct SLink *head;
-  struct SLink *next;
 
   head = iauth->i_stats;
   iauth->i_stats = NULL;
-  for (; head; head = next) {
-    next = head->next;
-    MyFree(head->value.cp);
-    free_link(head);
-  }
+  iauth_free_strings(head);
   sendto_opmask(NULL, SNO_AUTH, "New iauth statistics.");
   return 0;
 }
@@ -1879,7 +2467,7 @@ static int iauth_cmd_username_bad(struct IAuth *iauth, struct Client *cli,
 				  int parc, char **params)
 {
   if (!EmptyString(params[0]))
-    ircd_strncpy(cli_user(cli)->username, params[0], USERLEN);
+    intern_set(&cli_user(cli)->username, params[0], USERLEN);
   return AR_AUTH_PENDING;
 }
 
@@ -1917,8 +2505,8 @@ static int iauth_cmd_hostname(struct IAuth *iauth, struct Client *cli,
    * needs to be overwritten now.
    */
   if (FlagHas(&auth->flags, AR_IAUTH_HURRY)) {
-    ircd_strncpy(cli_user(cli)->host, cli_sockhost(cli), HOSTLEN);
-    ircd_strncpy(cli_user(cli)->realhost, cli_sockhost(cli), HOSTLEN);
+    intern_set(&cli_user(cli)->host, cli_sockhost(cli), HOSTLEN);
+    intern_set(&cli_user(cli)->realhost, cli_sockhost(cli), HOSTLEN);
   }
   return AR_DNS_PENDING;
 }
@@ -2107,7 +2695,7 @@ static int iauth_cmd_done_account(struct IAuth *iauth, struct Client *cli,
   }
 
   /* Copy account name to User structure. */
-  ircd_strncpy(cli_user(cli)->account, params[0], ACCOUNTLEN);
+  intern_set(&cli_user(cli)->account, params[0], ACCOUNTLEN);
   SetAccount(cli);
 
   /* Fall through to the normal "done" handler. */
@@ -2180,6 +2768,7 @@ static int iauth_cmd_xquery(struct IAuth *iauth, struct Client *cli,
   const char *routing;
   const char *query;
   struct Client *acptr;
+  int idx;
 
   /* Process parameters */
   if (EmptyString(params[0])) {
@@ -2206,11 +2795,14 @@ static int iauth_cmd_xquery(struct IAuth *iauth, struct Client *cli,
     return 0;
   }
 
+  /* Find which worker the reply should go back to. */
+  for (idx = 0; idx < iauth_count && iauth_pool[idx] != iauth; ++idx) ;
+
   /* If it's to us, do nothing; otherwise, forward the query */
   if (!IsMe(acptr))
     /* The "iauth:" prefix helps ircu route the reply to iauth */
-    sendcmdto_one(&me, CMD_XQUERY, acptr, "%C iauth:%s :%s", acptr, routing,
-		  query);
+    sendcmdto_one(&me, CMD_XQUERY, acptr, "%C iauth:%d:%s :%s", acptr, idx,
+		  routing, query);
 
   return 0;
 }
@@ -2257,7 +2849,7 @@ static void iauth_parse(struct IAuth *iauth, char *message)
 	     */
   case 'K': handler = iauth_cmd_kill; has_cli = 2; break;
   case 'r': /* we handle termination directly */ return;
-  default:  sendto_iauth(NULL, "E Garbage :[%s]", message); return;
+  default:  iauth_send(iauth, "E Garbage :[%s]", message); return;
   }
 
   while (parc < MAXPARA) {
@@ -2290,11 +2882,13 @@ static void iauth_parse(struct IAuth *iauth, char *message)
     /* Try to find the client associated with the request. */
     id = strtol(params[0], NULL, 10);
     if (parc < 3)
-      sendto_iauth(NULL, "E Missing :Need <id> <ip> <port>");
-    else if (id < 0 || id > HighestFd || !(cli = LocalClientArray[id]))
-      /* Client no longer exists (or never existed). */
-      sendto_iauth(NULL, "E Gone :[%s %s %s]", params[0], params[1],
-		   params[2]);
+      iauth_send(iauth, "E Missing :Need <id> <ip> <port>");
+    else if (id < 0 || id > HighestFd || !(cli = LocalClientArray[id])
+             || iauth_of(cli) != iauth)
+      /* Client no longer exists (or never existed, or belongs to a
+       * different worker). */
+      iauth_send(iauth, "E Gone :[%s %s %s]", params[0], params[1],
+		 params[2]);
     else if ((!(auth = cli_auth(cli)) ||
 	      !FlagHas(&auth->flags, AR_IAUTH_PENDING)) &&
 	     has_cli == 1)
@@ -2346,6 +2940,7 @@ static void iauth_read(struct IAuth *iauth)
 				 &count))
     return;
   readbuf[length += count] = '\0';
+  iauth->i_recvB += count;
 
   /* Parse each complete line. */
   for (sol = readbuf; (eol = strchr(sol, '\n')) != NULL; sol = eol + 1) {
@@ -2358,6 +2953,7 @@ static void iauth_read(struct IAuth *iauth)
       sendto_opmask(NULL, SNO_AUTH, "Parsing: \"%s\"", sol);
 
     /* Parse the line... */
+    ++iauth->i_recvM;
     iauth_parse(iauth, sol);
   }
 
@@ -2482,11 +3078,13 @@ void report_iauth_conf(struct Client *cptr, const struct StatDesc *sd, char *par
 {
     struct SLink *link;
 
-    if (iauth) for (link = iauth->i_config; link; link = link->next)
-    {
+    /* All workers run the same program, so one configuration will do. */
+    if (iauth_count > 0)
+      for (link = iauth_pool[0]->i_config; link; link = link->next)
+      {
         send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG, ":%s",
                    link->value.cp);
-    }
+      }
 }
 
 /** Report active iauth's statistics to \a cptr.
@@ -2497,10 +3095,20 @@ void report_iauth_conf(struct Client *cptr, const struct StatDesc *sd, char *par
  void report_iauth_stats(struct Client *cptr, const struct StatDesc *sd, char *param)
 {
     struct SLink *link;
+    int ii;
 
-    if (iauth) for (link = iauth->i_stats; link; link = link->next)
+    for (ii = 0; ii < iauth_count; ++ii)
     {
+      if (iauth_count > 1)
+        send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
+                   ":Worker %d: %s, %u sent, %u received, %u queued", ii,
+                   i_GetConnected(iauth_pool[ii]) ? "running" : "down",
+                   iauth_pool[ii]->i_sendM, iauth_pool[ii]->i_recvM,
+                   MsgQLength(i_sendQ(iauth_pool[ii])));
+      for (link = iauth_pool[ii]->i_stats; link; link = link->next)
+      {
         send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG, ":%s",
                    link->value.cp);
+      }
     }
 }
@@ -50,6 +50,7 @@
 #include "s_conf.h"
 #include "s_debug.h"
 #include "s_misc.h"
+#include "s_serv.h"
 #include "s_user.h"
 #include "send.h"
 #include "struct.h"
@@ -574,6 +575,7 @@ void add_connection(struct Listener* listener, int fd) {
   ++listener->ref_count;
 
   Count_newunknown(UserStats);
+  log_event(EVENTLOG_CONNECT, new_client);
   /* if we've made it this far we can put the client on the auth query pile */
   start_auth(new_client);
 }
@@ -585,12 +587,13 @@ void add_connection(struct Listener* listener, int fd) {
 void update_write(struct Client* cptr)
 {
   /* If there are messages that need to be sent along, or if the client
-   * is in the middle of a /list, then we need to tell the engine that
-   * we're interested in writable events--otherwise, we need to drop
-   * that interest.
+   * is in the middle of a /list or of receiving our burst, then we need
+   * to tell the engine that we're interested in writable events--
+   * otherwise, we need to drop that interest.
    */
   socket_events(&(cli_socket(cptr)),
-		((MsgQLength(&cli_sendQ(cptr)) || cli_listing(cptr)) ?
+		((MsgQLength(&cli_sendQ(cptr)) || cli_listing(cptr)
+		  || cli_bursting(cptr)) ?
 		 SOCK_ACTION_ADD : SOCK_ACTION_DEL) | SOCK_EVENT_WRITABLE);
 }
 
@@ -867,7 +870,7 @@ static void client_sock_callback(struct Event* ev)
   struct Client* cptr;
   struct Connection* con;
   char *fmt = "%s";
-  char *fallback = 0;
+  const char *fallback = 0;
 
   assert(0 != ev_socket(ev));
   assert(0 != s_data(ev_socket(ev)));
@@ -929,6 +932,8 @@ static void client_sock_callback(struct Event* ev)
     ClrFlag(cptr, FLAG_BLOCKED);
     if (cli_listing(cptr) && MsgQLength(&(cli_sendQ(cptr))) < 2048)
       list_next_channels(cptr);
+    else if (cli_bursting(cptr) && MsgQLength(&(cli_sendQ(cptr))) < BURST_SENDQ)
+      burst_next_channels(cptr);
     Debug((DEBUG_SEND, "Sending queued data to %C", cptr));
     send_queued(cptr);
     break;
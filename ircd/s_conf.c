@@ -26,6 +26,7 @@
 #include "IPcheck.h"
 #include "class.h"
 #include "client.h"
+#include "conf_index.h"
 #include "crule.h"
 #include "ircd_features.h"
 #include "fileio.h"
@@ -34,6 +35,7 @@
 #include "ircd.h"
 #include "ircd_alloc.h"
 #include "ircd_chattr.h"
+#include "ircd_intern.h"
 #include "ircd_log.h"
 #include "ircd_reply.h"
 #include "ircd_snprintf.h"
@@ -62,6 +64,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 /** Global list of all ConfItem structures. */
@@ -121,6 +124,11 @@ static void killcomment(struct Client* sptr, const char* filename)
   fbclose(file);
 }
 
+/** Index of Client blocks in #GlobalConfList. */
+static struct ConfIndex ilineIndex = { 1 };
+/** Index of Kill blocks in #denyConfList. */
+static struct ConfIndex killIndex = { 1 };
+
 /** Allocate a new struct ConfItem and link it to #GlobalConfList.
  * @return Newly allocated structure.
  */
@@ -132,6 +140,7 @@ struct ConfItem* make_conf(int type)
   assert(0 != aconf);
   ++GlobalConfCount;
   memset(aconf, 0, sizeof(struct ConfItem));
+  ilineIndex.stale = 1;
   aconf->status  = type;
   aconf->next    = GlobalConfList;
   GlobalConfList = aconf;
@@ -144,6 +153,7 @@ struct ConfItem* make_conf(int type)
 static
 void free_conf(struct ConfItem *aconf)
 {
+  ilineIndex.stale = 1;
   Debug((DEBUG_DEBUG, "free_conf: %s %s %d",
          aconf->host ? aconf->host : "*",
          aconf->name ? aconf->name : "*",
@@ -347,31 +357,98 @@ void det_confs_butmask(struct Client* cptr, int mask)
   }
 }
 
+/** Rebuild the Client block index from #GlobalConfList. */
+static void iline_build_index(void)
+{
+  struct ConfItem *aconf;
+  unsigned int count, i;
+
+  for (count = 0, aconf = GlobalConfList; aconf; aconf = aconf->next)
+    if (aconf->status == CONF_CLIENT)
+      count++;
+
+  conf_index_init(&ilineIndex, count);
+  for (i = 0, aconf = GlobalConfList; aconf; aconf = aconf->next)
+    if (aconf->status == CONF_CLIENT)
+      ilineIndex.entries[i++].item = aconf;
+
+  while (i-- > 0) {
+    aconf = ilineIndex.entries[i].item;
+    conf_index_place(&ilineIndex, i, &aconf->address.addr, aconf->addrbits,
+                     aconf->host, 0);
+  }
+
+  ilineIndex.stale = 0;
+}
+
+/** Rebuild the Kill block index from #denyConfList. */
+static void kill_build_index(void)
+{
+  struct DenyConf *deny;
+  unsigned int count, i;
+
+  for (count = 0, deny = denyConfList; deny; deny = deny->next)
+    count++;
+
+  conf_index_init(&killIndex, count);
+  for (i = 0, deny = denyConfList; deny; deny = deny->next)
+    killIndex.entries[i++].item = deny;
+
+  while (i-- > 0) {
+    deny = killIndex.entries[i].item;
+    conf_index_place(&killIndex, i, &deny->address, deny->bits,
+                     deny->hostmask, deny->realmask);
+  }
+
+  killIndex.stale = 0;
+}
+
+/** Check whether a Client block applies to a client.
+ * @param[in] aconf Client block.
+ * @param[in] cptr Registering client.
+ * @return Non-zero if \a aconf matches \a cptr.
+ */
+static int iline_match(struct ConfItem *aconf, struct Client *cptr)
+{
+  /* If you change any of this logic, please make corresponding
+   * changes in conf_debug_iline() below.
+   */
+  if (aconf->address.port && aconf->address.port != cli_listener(cptr)->addr.port)
+    return 0;
+  if (aconf->username && match(aconf->username, cli_username(cptr)))
+    return 0;
+  if (aconf->host && match(aconf->host, cli_sockhost(cptr)))
+    return 0;
+  if ((aconf->addrbits >= 0)
+      && !ipmask_check(&cli_ip(cptr), &aconf->address.addr, aconf->addrbits))
+    return 0;
+  return 1;
+}
+
 /** Find the first (best) Client block to attach.
+ * Only blocks that the index says could apply are checked, in the
+ * same order as a scan of #GlobalConfList would check them.
  * @param cptr Client for whom to check rules.
  * @return Authorization check result.
  */
 static
 enum AuthorizationCheckResult attach_iline(struct Client* cptr)
 {
-  struct ConfItem* aconf;
+  struct ConfIndexEntry *cand[CONF_INDEX_CANDIDATES];
+  struct ConfIndexEntry *entry;
+  struct ConfItem *aconf;
+  int ncand;
 
   assert(0 != cptr);
 
-  for (aconf = GlobalConfList; aconf; aconf = aconf->next) {
-    if (aconf->status != CONF_CLIENT)
-      continue;
-    /* If you change any of this logic, please make corresponding
-     * changes in conf_debug_iline() below.
-     */
-    if (aconf->address.port && aconf->address.port != cli_listener(cptr)->addr.port)
-      continue;
-    if (aconf->username && match(aconf->username, cli_username(cptr)))
-      continue;
-    if (aconf->host && match(aconf->host, cli_sockhost(cptr)))
-      continue;
-    if ((aconf->addrbits >= 0)
-        && !ipmask_check(&cli_ip(cptr), &aconf->address.addr, aconf->addrbits))
+  if (ilineIndex.stale)
+    iline_build_index();
+
+  ncand = conf_index_lookup(&ilineIndex, &cli_ip(cptr), cli_sockhost(cptr),
+                            0, cand);
+  while ((entry = conf_index_next(cand, ncand))) {
+    aconf = entry->item;
+    if (!iline_match(aconf, cptr))
       continue;
     if (IPcheck_nr(cptr) > aconf->maximum)
       return ACR_TOO_MANY_FROM_IP;
@@ -740,11 +817,12 @@ struct ConfItem* find_conf_byip(struct SLink* lp, const struct irc_in_addr* ip,
   return 0;
 }
 
-/** Free all CRules from #cruleConfList. */
-static void conf_erase_crule_list(void)
+/** Free a list of CRules.
+ * @param[in] p First rule in the list.
+ */
+static void conf_erase_crule_list(struct CRuleConf* p)
 {
   struct CRuleConf* next;
-  struct CRuleConf* p = cruleConfList;
 
   for ( ; p; p = next) {
     next = p->next;
@@ -753,7 +831,6 @@ static void conf_erase_crule_list(void)
     MyFree(p->rule);
     MyFree(p);
   }
-  cruleConfList = 0;
 }
 
 /** Return #cruleConfList.
@@ -764,11 +841,12 @@ const struct CRuleConf* conf_get_crule_list(void)
   return cruleConfList;
 }
 
-/** Free all deny rules from #denyConfList. */
-static void conf_erase_deny_list(void)
+/** Free a list of deny rules.
+ * @param[in] p First rule in the list.
+ */
+static void conf_erase_deny_list(struct DenyConf* p)
 {
   struct DenyConf* next;
-  struct DenyConf* p = denyConfList;
   for ( ; p; p = next) {
     next = p->next;
     MyFree(p->hostmask);
@@ -777,7 +855,7 @@ static void conf_erase_deny_list(void)
     MyFree(p->realmask);
     MyFree(p);
   }
-  denyConfList = 0;
+  killIndex.stale = 1;
 }
 
 /** Return #denyConfList.
@@ -820,26 +898,71 @@ find_webirc(const struct irc_in_addr *addr, const char *passwd)
   return NULL;
 }
 
-/** Free all qline structs from #GlobalQuarantineList. */
+/** Free a list of qline structs.
+ * @param[in] qline First quarantine in the list.
+ */
 static
-void clear_quarantines(void)
+void clear_quarantines(struct qline *qline)
 {
-  struct qline *qline;
-  while ((qline = GlobalQuarantineList))
+  struct qline *next;
+  for ( ; qline; qline = next)
   {
-    GlobalQuarantineList = qline->next;
+    next = qline->next;
     MyFree(qline->reason);
     MyFree(qline->chname);
     MyFree(qline);
   }
 }
 
-/** Mark everything in #GlobalWebircList stale. */
-static void webirc_mark_stale(void)
+/** Free a list of wline structs.
+ * @param[in] wline First WebIRC authorization in the list.
+ */
+static void webirc_free_list(struct wline *wline)
 {
-  struct wline *wline;
-  for (wline = GlobalWebircList; wline; wline = wline->next)
-    wline->stale = 1;
+  struct wline *next;
+  for ( ; wline; wline = next)
+  {
+    next = wline->next;
+    MyFree(wline->passwd);
+    MyFree(wline->description);
+    MyFree(wline);
+  }
+}
+
+/** Carry client references over to a newly read WebIRC list.
+ * Clients point at entries of the old list, so an old entry that is
+ * still configured takes the new settings and replaces its twin in
+ * the new list; any other old entry is marked stale.
+ * @param[in] old Previous contents of #GlobalWebircList.
+ */
+static void webirc_merge(struct wline *old)
+{
+  struct wline *wline, **pp_w, *tail;
+
+  for (tail = old; tail; tail = tail->next) {
+    tail->stale = 1;
+    for (pp_w = &GlobalWebircList; (wline = *pp_w) != NULL;
+         pp_w = &wline->next) {
+      if ((wline->bits == tail->bits)
+          && ipmask_check(&wline->ip, &tail->ip, wline->bits)
+          && (0 == strcmp(wline->passwd, tail->passwd)))
+        break;
+    }
+    if (wline) {
+      *pp_w = wline->next;
+      MyFree(tail->description);
+      tail->description = wline->description;
+      tail->hidden = wline->hidden;
+      tail->stale = 0;
+      wline->description = NULL;
+      wline->next = NULL;
+      webirc_free_list(wline);
+    }
+  }
+
+  for (pp_w = &GlobalWebircList; *pp_w; pp_w = &(*pp_w)->next)
+    ;
+  *pp_w = old;
 }
 
 /** Remove any still-stale entries in #GlobalWebircList. */
@@ -850,9 +973,8 @@ static void webirc_remove_stale(void)
   for (pp_w = &GlobalWebircList; (wline = *pp_w) != NULL; ) {
     if (wline->stale) {
       *pp_w = wline->next;
-      MyFree(wline->passwd);
-      MyFree(wline->description);
-      MyFree(wline);
+      wline->next = NULL;
+      webirc_free_list(wline);
     } else {
       pp_w = &wline->next;
     }
@@ -867,18 +989,17 @@ extern void yyparse(void);
 extern int init_lexer(const char *configfile);
 extern void deinit_lexer(void);
 
-/** Read configuration file.
+/** Read configuration file into the staging area.
+ * Must be called between conf_stage_begin() and conf_stage_commit()
+ * or conf_stage_rollback().
  * @return Zero on failure, non-zero on success. */
-int read_configuration_file(void)
+static int read_configuration_file(void)
 {
   conf_error = 0;
-  feature_unmark(); /* unmark all features for resetting later */
-  clear_nameservers(); /* clear previous list of DNS servers */
   if (!init_lexer(configfile))
     return 0;
   yyparse();
   deinit_lexer();
-  feature_mark(); /* reset unmarked features */
   conf_already_read = 1;
   return 1;
 }
@@ -965,21 +1086,20 @@ update_uworld_flags(struct Client *cptr)
     update_uworld_flags(lp->value.cptr);
 }
 
-/** Empty the list of known UWorld servers. */
+/** Free a list of UWorld server names.
+ * @param[in] sp First name in the list.
+ */
 static void
-conf_erase_uworld_list(void)
+conf_erase_uworld_list(struct SLink *sp)
 {
-  struct SLink *sp;
+  struct SLink *next;
 
-  while (uworlds)
+  for ( ; sp; sp = next)
   {
-    sp = uworlds;
-    uworlds = sp->next;
+    next = sp->next;
     MyFree(sp->value.cp);
     free_link(sp);
   }
-
-  update_uworld_flags(&me);
 }
 
 /** Record the name of a server having UWorld privileges.
@@ -1029,20 +1149,422 @@ void free_mapping(struct s_map *smap)
   MyFree(smap);
 }
 
-/** Unregister and free all current service mappings. */
-static void close_mappings(void)
+/** Unregister and free a list of service mappings.
+ * @param[in] map First mapping in the list.
+ * @param[in] registered If non-zero, the mappings are in the
+ *   command table and must be removed from it first.
+ */
+static void close_mappings(struct s_map *map, int registered)
 {
-  struct s_map *map, *next;
+  struct s_map *next;
 
-  for (map = GlobalServiceMapList; map; map = next) {
+  for ( ; map; map = next) {
     next = map->next;
-    unregister_mapping(map);
+    if (registered)
+      unregister_mapping(map);
     free_mapping(map);
   }
+}
+
+/** Kinds of configuration entry that act on running subsystems, and
+ * so are only carried out once the new configuration is installed.
+ */
+enum ConfActionType {
+  CA_JUPE,        /**< Jupe a nickname. */
+  CA_NAMESERVER,  /**< Add a DNS server. */
+  CA_PORT,        /**< Open (or keep) a listener. */
+  CA_MOTD,        /**< Add a host-specific MOTD. */
+  CA_FEATURE,     /**< Set a feature. */
+  CA_IAUTH        /**< Start (or keep) the IAuth program. */
+};
+
+/** A configuration entry waiting to be installed. */
+struct ConfAction {
+  struct ConfAction    *next;     /**< Next action, in file order. */
+  enum ConfActionType   type;     /**< What to do. */
+  int                   num;      /**< Port number or IAuth workers. */
+  struct ListenerFlags  flags;    /**< Listener flags for CA_PORT. */
+  int                   argc;     /**< Number of arguments. */
+  char                 *argv[1];  /**< Arguments (NULL terminated). */
+};
+
+/** The running configuration, set aside while a new one is read.
+ * The parser builds the new lists in the usual globals; this holds
+ * what they contained before, so a file with errors can be dropped
+ * without having touched anything the server is using.
+ */
+static struct {
+  int                  active;      /**< Non-zero between begin and end. */
+  struct ConfItem     *conf;        /**< Saved #GlobalConfList. */
+  struct DenyConf     *deny;        /**< Saved #denyConfList. */
+  struct CRuleConf    *crule;       /**< Saved #cruleConfList. */
+  struct SLink        *uworld;      /**< Saved #uworlds. */
+  struct qline        *quarantine;  /**< Saved #GlobalQuarantineList. */
+  struct s_map        *mapping;     /**< Saved #GlobalServiceMapList. */
+  struct wline        *webirc;      /**< Saved #GlobalWebircList. */
+  struct LocalConf     local;       /**< Copy of #localConf strings. */
+  struct irc_sockaddr  vhost_v4;    /**< Saved #VirtualHost_v4. */
+  struct irc_sockaddr  vhost_v6;    /**< Saved #VirtualHost_v6. */
+  struct irc_sockaddr  dns_v4;      /**< Saved #VirtualHost_dns_v4. */
+  struct irc_sockaddr  dns_v6;      /**< Saved #VirtualHost_dns_v6. */
+  struct ConfAction   *actions;     /**< Deferred actions from the file. */
+  struct ConfAction  **tail;        /**< Where to append the next action. */
+} confStage;
+
+/** Duplicate a string that may be NULL.
+ * @param[in] str String to copy.
+ * @return Newly allocated copy of \a str, or NULL.
+ */
+static char *conf_dup(const char *str)
+{
+  char *copy = NULL;
+
+  if (str)
+    DupString(copy, str);
+  return copy;
+}
+
+/** Record an action to carry out when the configuration is installed.
+ * @param[in] type Kind of action.
+ * @param[in] num Numeric argument.
+ * @param[in] flags Listener flags, or NULL.
+ * @param[in] argc Number of strings in \a argv.
+ * @param[in] argv Strings for the action; they are copied.
+ */
+static void conf_defer(enum ConfActionType type, int num,
+                       const struct ListenerFlags *flags,
+                       int argc, const char * const *argv)
+{
+  struct ConfAction *act;
+  int ii;
+
+  assert(confStage.active);
+  act = MyCalloc(1, sizeof(*act) + argc * sizeof(act->argv[0]));
+  act->type = type;
+  act->num = num;
+  if (flags)
+    memcpy(&act->flags, flags, sizeof(act->flags));
+  act->argc = argc;
+  for (ii = 0; ii < argc; ++ii)
+    act->argv[ii] = conf_dup(argv[ii]);
+  *confStage.tail = act;
+  confStage.tail = &act->next;
+}
+
+/** Jupe a nickname list once the configuration is installed.
+ * @param[in] nicks Comma-separated nicknames.
+ */
+void conf_defer_jupe(const char *nicks)
+{
+  conf_defer(CA_JUPE, 0, NULL, 1, &nicks);
+}
+
+/** Add a DNS server once the configuration is installed.
+ * @param[in] server Address of the server.
+ */
+void conf_defer_nameserver(const char *server)
+{
+  conf_defer(CA_NAMESERVER, 0, NULL, 1, &server);
+}
+
+/** Open a listener once the configuration is installed.
+ * @param[in] port Port number.
+ * @param[in] vhost Address to bind to.
+ * @param[in] mask Hostmask for accepted connections, or NULL.
+ * @param[in] flags Listener flags.
+ */
+void conf_defer_port(int port, const char *vhost, const char *mask,
+                     const struct ListenerFlags *flags)
+{
+  const char *argv[2];
+
+  argv[0] = vhost;
+  argv[1] = mask;
+  conf_defer(CA_PORT, port, flags, 2, argv);
+}
+
+/** Add a MOTD once the configuration is installed.
+ * @param[in] hostmask Host or class the MOTD is for.
+ * @param[in] path File containing the MOTD.
+ */
+void conf_defer_motd(const char *hostmask, const char *path)
+{
+  const char *argv[2];
+
+  argv[0] = hostmask;
+  argv[1] = path;
+  conf_defer(CA_MOTD, 0, NULL, 2, argv);
+}
+
+/** Set a feature once the configuration is installed.
+ * @param[in] argc Number of strings in \a argv.
+ * @param[in] argv Feature name and values.
+ */
+void conf_defer_feature(int argc, const char * const *argv)
+{
+  conf_defer(CA_FEATURE, 0, NULL, argc, argv);
+}
+
+/** Start the IAuth program once the configuration is installed.
+ * @param[in] argc Number of strings in \a argv.
+ * @param[in] argv Program and its arguments.
+ * @param[in] workers Number of worker processes.
+ */
+void conf_defer_iauth(int argc, const char * const *argv, int workers)
+{
+  conf_defer(CA_IAUTH, workers, NULL, argc, argv);
+}
+
+/** Free the list of deferred actions. */
+static void conf_free_actions(void)
+{
+  struct ConfAction *act, *next;
+  int ii;
+
+  for (act = confStage.actions; act; act = next) {
+    next = act->next;
+    for (ii = 0; ii < act->argc; ++ii)
+      MyFree(act->argv[ii]);
+    MyFree(act);
+  }
+  confStage.actions = NULL;
+  confStage.tail = &confStage.actions;
+}
+
+/** Free the saved copies of the #localConf strings. */
+static void conf_free_local(struct LocalConf *local)
+{
+  MyFree(local->name);
+  MyFree(local->description);
+  MyFree(local->location1);
+  MyFree(local->location2);
+  MyFree(local->contact);
+}
+
+/** Set the running configuration aside so a new one can be read.
+ * Nothing the server is using is changed; the parser fills empty
+ * lists and records anything with side effects for later.
+ */
+static void conf_stage_begin(void)
+{
+  assert(!confStage.active);
+  confStage.active = 1;
+
+  confStage.conf = GlobalConfList;
+  GlobalConfList = NULL;
+  confStage.deny = denyConfList;
+  denyConfList = NULL;
+  confStage.crule = cruleConfList;
+  cruleConfList = NULL;
+  confStage.uworld = uworlds;
+  uworlds = NULL;
+  confStage.quarantine = GlobalQuarantineList;
+  GlobalQuarantineList = NULL;
+  confStage.mapping = GlobalServiceMapList;
   GlobalServiceMapList = NULL;
+  confStage.webirc = GlobalWebircList;
+  GlobalWebircList = NULL;
+  ilineIndex.stale = 1;
+  killIndex.stale = 1;
+
+  confStage.local.name = conf_dup(localConf.name);
+  confStage.local.description = conf_dup(localConf.description);
+  confStage.local.numeric = localConf.numeric;
+  confStage.local.location1 = conf_dup(localConf.location1);
+  confStage.local.location2 = conf_dup(localConf.location2);
+  confStage.local.contact = conf_dup(localConf.contact);
+  confStage.vhost_v4 = VirtualHost_v4;
+  confStage.vhost_v6 = VirtualHost_v6;
+  confStage.dns_v4 = VirtualHost_dns_v4;
+  confStage.dns_v6 = VirtualHost_dns_v6;
+  /* Like the DNS servers, the DNS vhosts start out empty each time. */
+  memset(&VirtualHost_dns_v4, 0, sizeof(VirtualHost_dns_v4));
+  memset(&VirtualHost_dns_v6, 0, sizeof(VirtualHost_dns_v6));
+
+  confStage.tail = &confStage.actions;
+  class_save_all();
+  class_mark_delete();
+}
+
+/** Throw away whatever was read and restore the running configuration. */
+static void conf_stage_rollback(void)
+{
+  struct ConfItem *aconf;
+
+  assert(confStage.active);
+  confStage.active = 0;
+
+  while ((aconf = GlobalConfList)) {
+    GlobalConfList = aconf->next;
+    free_conf(aconf);
+  }
+  GlobalConfList = confStage.conf;
+  conf_erase_deny_list(denyConfList);
+  denyConfList = confStage.deny;
+  conf_erase_crule_list(cruleConfList);
+  cruleConfList = confStage.crule;
+  conf_erase_uworld_list(uworlds);
+  uworlds = confStage.uworld;
+  clear_quarantines(GlobalQuarantineList);
+  GlobalQuarantineList = confStage.quarantine;
+  close_mappings(GlobalServiceMapList, 0);
+  GlobalServiceMapList = confStage.mapping;
+  webirc_free_list(GlobalWebircList);
+  GlobalWebircList = confStage.webirc;
+  ilineIndex.stale = 1;
+  killIndex.stale = 1;
+
+  conf_free_local(&localConf);
+  localConf = confStage.local;
+  VirtualHost_v4 = confStage.vhost_v4;
+  VirtualHost_v6 = confStage.vhost_v6;
+  VirtualHost_dns_v4 = confStage.dns_v4;
+  VirtualHost_dns_v6 = confStage.dns_v6;
+
+  class_restore_all();
+  conf_free_actions();
+}
+
+/** Install the configuration that was just read.
+ * Entries still used by local clients are kept until they leave;
+ * everything else from the old configuration is freed.
+ */
+static void conf_stage_commit(void)
+{
+  struct ConfItem *aconf;
+  struct ConfAction *act;
+  struct s_map **pp_map, *map;
+  struct irc_sockaddr dns_v4, dns_v6;
+
+  assert(confStage.active);
+  confStage.active = 0;
+
+  while ((aconf = confStage.conf)) {
+    confStage.conf = aconf->next;
+    if (aconf->clients) {
+      /* Still in use by some local clients, cannot delete it--mark
+       * it so that it will be deleted when the last client exits.
+       */
+      aconf->next = NULL;
+      aconf->status |= CONF_ILLEGAL;
+    }
+    else
+      free_conf(aconf);
+  }
+  conf_erase_deny_list(confStage.deny);
+  conf_erase_crule_list(confStage.crule);
+  conf_erase_uworld_list(confStage.uworld);
+  clear_quarantines(confStage.quarantine);
+  close_mappings(confStage.mapping, 1);
+  for (pp_map = &GlobalServiceMapList; (map = *pp_map) != NULL; ) {
+    if (register_mapping(map))
+      pp_map = &map->next;
+    else {
+      *pp_map = map->next;
+      map->next = NULL;
+      close_mappings(map, 0);
+    }
+  }
+  webirc_merge(confStage.webirc);
+
+  conf_free_local(&confStage.local);
+  if (localConf.description)
+    intern_set(&cli_info(&me), localConf.description, REALLEN);
+
+  /* clear_nameservers() also forgets the DNS vhosts just read. */
+  dns_v4 = VirtualHost_dns_v4;
+  dns_v6 = VirtualHost_dns_v6;
+  clear_nameservers();
+  VirtualHost_dns_v4 = dns_v4;
+  VirtualHost_dns_v6 = dns_v6;
+  feature_unmark(); /* unmark all features for resetting later */
+  motd_clear();
+  clearNickJupes();
+  mark_listeners_closing();
+  auth_mark_closing();
+
+  for (act = confStage.actions; act; act = act->next) {
+    switch (act->type) {
+    case CA_JUPE:
+      addNickJupes(act->argv[0]);
+      break;
+    case CA_NAMESERVER:
+      add_nameserver(act->argv[0]);
+      break;
+    case CA_PORT:
+      add_listener(act->num, act->argv[0], act->argv[1], &act->flags);
+      break;
+    case CA_MOTD:
+      motd_add(act->argv[0], act->argv[1]);
+      break;
+    case CA_FEATURE:
+      feature_set(NULL, (const char * const *)act->argv, act->argc);
+      break;
+    case CA_IAUTH:
+      auth_spawn(act->argc, act->argv, act->num);
+      break;
+    }
+  }
+  conf_free_actions();
+  feature_mark(); /* reset unmarked features */
+
+  auth_close_unused();
+  close_listeners();
+  class_forget_saved();
+  class_delete_marked();
+}
+
+/** Timings of configuration reloads. */
+static struct {
+  time_t        last;     /**< When the last rehash finished. */
+  unsigned int  count;    /**< Number of rehashes since startup. */
+  unsigned int  checked;  /**< Local clients checked by the last rehash. */
+  unsigned long parse;    /**< Microseconds spent reading the file. */
+  unsigned long apply;    /**< Microseconds spent installing it. */
+  unsigned long check;    /**< Microseconds spent checking clients. */
+  unsigned long slowest;  /**< Longest rehash so far, in microseconds. */
+} rehashStats;
+
+/** Measure time elapsed since a timestamp and advance the timestamp.
+ * @param[in,out] tv Start of the interval; set to the current time.
+ * @return Microseconds since \a tv.
+ */
+static unsigned long
+rehash_lap(struct timeval *tv)
+{
+  struct timeval now;
+  long usec;
+
+  gettimeofday(&now, NULL);
+  usec = (now.tv_sec - tv->tv_sec) * 1000000 + (now.tv_usec - tv->tv_usec);
+  *tv = now;
+  return usec > 0 ? usec : 0;
+}
+
+/** Report how long the last configuration reload took.
+ * @param[in] to Client requesting statistics.
+ */
+void
+report_rehash(struct Client *to)
+{
+  if (!rehashStats.count)
+    return;
+  send_reply(to, SND_EXPLICIT | RPL_STATSCONN,
+             ":Last rehash %Tu seconds ago: parse %lu.%03lu ms, apply "
+             "%lu.%03lu ms, check %lu.%03lu ms (%u clients); %u rehashes, "
+             "slowest %lu.%03lu ms",
+             CurrentTime - rehashStats.last,
+             rehashStats.parse / 1000, rehashStats.parse % 1000,
+             rehashStats.apply / 1000, rehashStats.apply % 1000,
+             rehashStats.check / 1000, rehashStats.check % 1000,
+             rehashStats.checked, rehashStats.count,
+             rehashStats.slowest / 1000, rehashStats.slowest % 1000);
 }
 
 /** Reload the configuration file.
+ * The file is read into staging lists while the running configuration
+ * stays in place.  A file with errors is dropped as a whole; otherwise
+ * the new configuration replaces the old one in a single step.
  * @param cptr Client that requested rehash (if a signal, &me).
  * @param sig Type of rehash (0 = oper-requested, 1 = signal, 2 =
  *   oper-requested but do not restart resolver)
@@ -1051,84 +1573,41 @@ static void close_mappings(void)
  */
 int rehash(struct Client *cptr, int sig)
 {
-  struct ConfItem** tmp = &GlobalConfList;
-  struct ConfItem*  tmp2;
   struct Client*    acptr;
   int               i;
   int               ret = 0;
   int               found_g = 0;
+  struct timeval    tv;
 
   if (1 == sig)
     sendto_opmask(0, SNO_OLDSNO,
                   "Got signal SIGHUP, reloading ircd conf. file");
 
-  while ((tmp2 = *tmp)) {
-    if (tmp2->clients) {
-      /*
-       * Configuration entry is still in use by some
-       * local clients, cannot delete it--mark it so
-       * that it will be deleted when the last client
-       * exits...
-       */
-      if (CONF_CLIENT == (tmp2->status & CONF_CLIENT))
-        tmp = &tmp2->next;
-      else {
-        *tmp = tmp2->next;
-        tmp2->next = 0;
-      }
-      tmp2->status |= CONF_ILLEGAL;
-    }
-    else {
-      *tmp = tmp2->next;
-      free_conf(tmp2);
-    }
+  gettimeofday(&tv, NULL);
+  conf_stage_begin();
+  if (!read_configuration_file() || conf_error) {
+    conf_stage_rollback();
+    log_write(LS_CONFIG, L_ERROR, 0, "Configuration file %s has errors; "
+              "keeping the current configuration", configfile);
+    sendto_opmask(0, SNO_OLDSNO, "Configuration file %s has errors; "
+                  "keeping the current configuration", configfile);
+    return 0;
   }
-  conf_erase_uworld_list();
-  conf_erase_crule_list();
-  conf_erase_deny_list();
-  motd_clear();
+  rehashStats.parse = rehash_lap(&tv);
 
-  /*
-   * delete the juped nicks list
-   */
-  clearNickJupes();
-
-  clear_quarantines();
-
-  class_mark_delete();
-  mark_listeners_closing();
-  auth_mark_closing();
-  webirc_mark_stale();
-  close_mappings();
-
-  read_configuration_file();
+  conf_stage_commit();
 
   if (sig != 2)
     restart_resolver();
 
   log_reopen(); /* reopen log files */
+  rehashStats.apply = rehash_lap(&tv);
 
-  auth_close_unused();
-  close_listeners();
-  class_delete_marked();         /* unless it fails */
-
-  /*
-   * Flush out deleted I and P lines although still in use.
-   */
-  for (tmp = &GlobalConfList; (tmp2 = *tmp);) {
-    if (CONF_ILLEGAL == (tmp2->status & CONF_ILLEGAL)) {
-      *tmp = tmp2->next;
-      tmp2->next = NULL;
-      if (!tmp2->clients)
-        free_conf(tmp2);
-    }
-    else
-      tmp = &tmp2->next;
-  }
-
+  rehashStats.checked = 0;
   for (i = 0; i <= HighestFd; i++) {
     if ((acptr = LocalClientArray[i])) {
       const struct wline *wline;
+      rehashStats.checked++;
       assert(!IsMe(acptr));
       if (IsServer(acptr))
         det_confs_butmask(acptr, ~(CONF_ILLEGAL));
@@ -1155,16 +1634,45 @@ int rehash(struct Client *cptr, int sig)
 
   update_uworld_flags(&me);
   webirc_remove_stale();
+  rehashStats.check = rehash_lap(&tv);
+
+  rehashStats.last = CurrentTime;
+  rehashStats.count++;
+  if (rehashStats.parse + rehashStats.apply + rehashStats.check
+      > rehashStats.slowest)
+    rehashStats.slowest = rehashStats.parse + rehashStats.apply
+      + rehashStats.check;
 
   return ret;
 }
 
+/** Check that the configuration file would load.
+ * The file is parsed and then discarded, so nothing is started or
+ * opened on its behalf.
+ * @param[in] client If not NULL, report which Client block this
+ *   client specifier would match.
+ * @return Non-zero if the file is usable, zero otherwise.
+ */
+int conf_check(const char *client)
+{
+  int ok;
+
+  conf_stage_begin();
+  ok = read_configuration_file() && !conf_error
+    && localConf.name && localConf.numeric;
+  if (ok && client)
+    conf_debug_iline(client);
+  conf_stage_rollback();
+  return ok;
+}
+
 /** Read configuration file for the very first time.
  * @return Non-zero on success, zero on failure.
  */
 
 int init_conf(void)
 {
+  conf_stage_begin();
   if (read_configuration_file()) {
     /*
      * make sure we're sane to start if the config
@@ -1172,10 +1680,11 @@ int init_conf(void)
      * XXX - should any of these abort the server?
      * TODO: add warning messages
      */
-    if (0 == localConf.name || 0 == localConf.numeric)
-      return 0;
-    if (conf_error)
+    if (0 == localConf.name || 0 == localConf.numeric || conf_error) {
+      conf_stage_rollback();
       return 0;
+    }
+    conf_stage_commit();
 
     if (0 == localConf.location1)
       DupString(localConf.location1, "");
@@ -1186,6 +1695,7 @@ int init_conf(void)
 
     return 1;
   }
+  conf_stage_rollback();
   return 0;
 }
 
@@ -1202,6 +1712,9 @@ int find_kill(struct Client *cptr)
   const char*      realname;
   struct DenyConf* deny;
   struct Gline*    agline = NULL;
+  struct ConfIndexEntry* cand[CONF_INDEX_CANDIDATES];
+  struct ConfIndexEntry* entry;
+  int              ncand;
 
   assert(0 != cptr);
 
@@ -1216,10 +1729,14 @@ int find_kill(struct Client *cptr)
   assert((name ? strlen(name) : 0) <= HOSTLEN);
   assert((realname ? strlen(realname) : 0) <= REALLEN);
 
-  /* 2000-07-14: Rewrote this loop for massive speed increases.
-   *             -- Isomer
+  /* Only look at Kill blocks that the index says could match, in the
+   * same order as a scan of denyConfList would.
    */
-  for (deny = denyConfList; deny; deny = deny->next) {
+  if (killIndex.stale)
+    kill_build_index();
+  ncand = conf_index_lookup(&killIndex, &cli_ip(cptr), host, realname, cand);
+  while ((entry = conf_index_next(cand, ncand))) {
+    deny = entry->item;
     if (deny->usermask && match(deny->usermask, name))
       continue;
     if (deny->realmask && match(deny->realmask, realname))
@@ -30,6 +30,7 @@
 #include "hash.h"
 #include "ircd_alloc.h"
 #include "ircd_features.h"
+#include "ircd_intern.h"
 #include "ircd_log.h"
 #include "ircd_osdep.h"
 #include "ircd_reply.h"
@@ -211,6 +212,8 @@ void count_memory(struct Client *cptr, const struct StatDesc *sd,
   struct ConfItem *aconf;
   const struct ConnectionClass* cltmp;
   struct Membership* member;
+  const struct SlabCache *slab;
+  unsigned int hist[SLAB_BUCKETS];
 
   int acc = 0,                  /* accounts */
       c = 0,                    /* clients */
@@ -218,6 +221,7 @@ void count_memory(struct Client *cptr, const struct StatDesc *sd,
       ch = 0,                   /* channels */
       lcc = 0,                  /* local client conf links */
       chb = 0,                  /* channel bans */
+      chn = 0,                  /* channel NAMES caches */
       wwu = 0,                  /* whowas users */
       cl = 0,                   /* classes */
       co = 0,                   /* conf lines */
@@ -232,6 +236,7 @@ void count_memory(struct Client *cptr, const struct StatDesc *sd,
 
   size_t chm = 0,               /* memory used by channels */
       chbm = 0,                 /* memory used by channel bans */
+      chnm = 0,                 /* memory used by NAMES caches */
       cm = 0,                   /* memory used by clients */
       cnm = 0,                  /* memory used by connections */
       us = 0,                   /* user structs */
@@ -248,6 +253,9 @@ void count_memory(struct Client *cptr, const struct StatDesc *sd,
       msgbuf_allocated = 0,	/* memory used by struct MsgBuf */
       listenersm = 0,           /* memory used by listetners */
       rm = 0,                   /* res memory used */
+      isc = 0,                  /* interned strings */
+      isr = 0,                  /* references to interned strings */
+      ism = 0,                  /* memory used by interned strings */
       totcl = 0, totch = 0, totww = 0, tot = 0;
 
   count_whowas_memory(&wwu, &wwm, &wwa, &wwam);
@@ -282,16 +290,28 @@ void count_memory(struct Client *cptr, const struct StatDesc *sd,
   cm = c * sizeof(struct Client);
   cnm = cn * sizeof(struct Connection);
   user_count_memory(&us, &usm);
+  intern_count_memory(&isc, &isr, &ism);
 
   for (chptr = GlobalChannelList; chptr; chptr = chptr->next)
   {
     ch++;
     chm += (strlen(chptr->chname) + sizeof(struct Channel));
+    chm += chptr->members_size * sizeof(*chptr->members)
+      + chptr->locals_size * sizeof(*chptr->locals)
+      + chptr->links_size * sizeof(*chptr->links);
     for (ban = chptr->banlist; ban; ban = ban->next)
     {
       chb++;
       chbm += strlen(ban->who) + strlen(ban->banstr) + 2 + sizeof(*ban);
     }
+    if (chptr->names_cache)
+    {
+      int i;
+      chn++;
+      chnm += sizeof(struct NamesCache);
+      for (i = 0; i < NAMES_VARIANTS; i++)
+        chnm += chptr->names_cache->size[i];
+    }
   }
 
   for (aconf = GlobalConfList; aconf; aconf = aconf->next)
@@ -315,9 +335,12 @@ void count_memory(struct Client *cptr, const struct StatDesc *sd,
   send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
 	     ":User channels %d(%zu) Aways %d(%zu)", memberships,
 	     memberships * sizeof(struct Membership), aw, awm);
+  send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
+	     ":Interned strings %zu(%zu) references %zu", isc, ism, isr);
 
   totcl = cm + cnm + us * sizeof(struct User) + memberships * sizeof(struct Membership) + awm;
   totcl += lcc * sizeof(struct SLink) + usi * sizeof(struct SLink);
+  totcl += ism;
 
   send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG, ":Conflines %d(%zu) Attached %d(%zu) Classes %d(%zu)",
              co, com, lcc, lcc * sizeof(struct SLink),
@@ -326,10 +349,10 @@ void count_memory(struct Client *cptr, const struct StatDesc *sd,
   send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
 	     ":Channels %d(%zu) Bans %d(%zu)", ch, chm, chb, chbm);
   send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
-	     ":Channel Members %d(%zu)", memberships,
-	     memberships * sizeof(struct Membership));
+	     ":Channel Members %d(%zu) Names caches %d(%zu)", memberships,
+	     memberships * sizeof(struct Membership), chn, chnm);
 
-  totch = chm + chbm;
+  totch = chm + chbm + chnm;
 
   send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
 	     ":Whowas Users %d(%zu) Away %d(%zu) Array %u(%zu)",
@@ -372,6 +395,21 @@ void count_memory(struct Client *cptr, const struct StatDesc *sd,
 
   rm = cres_mem(cptr);
 
+  log_count_memory(cptr);
+
+  for (slab = slab_cache_list(); slab; slab = slab->sc_next) {
+    slab_occupancy(slab, hist);
+    send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
+               ":Slab %s size %zu slabs %u(%zu) used %zu/%zu peak %zu",
+               slab->sc_name, slab->sc_size, slab->sc_slabs,
+               (size_t)slab->sc_slabs * SLAB_SIZE, slab->sc_inuse,
+               (size_t)slab->sc_slabs * slab->sc_per_slab, slab->sc_peak);
+    send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
+               ":Slab %s occupancy empty %u <25%% %u <50%% %u <75%% %u "
+               "<100%% %u full %u", slab->sc_name, hist[0], hist[1], hist[2],
+               hist[3], hist[4], hist[5]);
+  }
+
   tot =
       totww + totch + totcl + com + cl * sizeof(struct ConnectionClass) +
       dbufs_allocated + msg_allocated + msgbuf_allocated + rm;
@@ -49,6 +49,7 @@
 #include "s_bsd.h"
 #include "s_conf.h"
 #include "s_debug.h"
+#include "s_serv.h"
 #include "s_stats.h"
 #include "s_user.h"
 #include "send.h"
@@ -182,7 +183,7 @@ static void exit_one_client(struct Client* bcptr, const char* comment)
   struct Invite *ip;
   struct Ban *bp;
 
-  if (cli_serv(bcptr) && cli_serv(bcptr)->client_list)  /* Was SetServerYXX called ? */
+  if (cli_serv(bcptr) && cli_serv(bcptr)->nn_pages)  /* Was SetServerYXX called ? */
     ClearServerYXX(bcptr);      /* Removes server from server_list[] */
   if (IsUser(bcptr)) {
     /*
@@ -216,6 +217,7 @@ static void exit_one_client(struct Client* bcptr, const char* comment)
       cli_user(bcptr)->silence = bp->next;
       free_ban(bp);
     }
+    silence_changed(cli_user(bcptr));
 
     /* Clean up snotice lists */
     if (MyUser(bcptr))
@@ -240,6 +242,10 @@ static void exit_one_client(struct Client* bcptr, const char* comment)
     remove_dlink(&(cli_serv(cli_serv(bcptr)->up))->down, cli_serv(bcptr)->updown);
     cli_serv(bcptr)->updown = 0;
 
+    /* Stop sending it our burst */
+    if (cli_bursting(bcptr))
+      burst_abort(bcptr);
+
     if (MyConnect(bcptr))
       Count_serverdisconnects(UserStats);
     else
@@ -260,12 +266,11 @@ static void exit_one_client(struct Client* bcptr, const char* comment)
     IPcheck_disconnect(bcptr);
 
   /* 
-   * Remove from serv->client_list
+   * Remove from the server's client table
    * NOTE: user is *always* NULL if this is a server
    */
   if (cli_user(bcptr)) {
     assert(!IsServer(bcptr));
-    /* bcptr->user->server->serv->client_list[IndexYXX(bcptr)] = NULL; */
     RemoveYXXClient(cli_user(bcptr)->server, cli_yxx(bcptr));
   }
 
@@ -295,8 +300,10 @@ static void exit_downlinks(struct Client *cptr, struct Client *sptr, char *comme
   struct Client *acptr;
   struct DLink *next;
   struct DLink *lp;
-  struct Client **acptrp;
+  struct NumNickPage *page;
+  struct NumNickPage *next_page;
   unsigned int i;
+  unsigned int left;
 
   /* Run over all its downlinks */
   for (lp = cli_serv(cptr)->down; lp; lp = next)
@@ -308,11 +315,16 @@ static void exit_downlinks(struct Client *cptr, struct Client *sptr, char *comme
     /* Remove the downlink itself */
     exit_one_client(acptr, cli_name(&me));
   }
-  /* Remove all clients of this server */
-  acptrp = cli_serv(cptr)->client_list;
-  for (i = 0; i <= cli_serv(cptr)->nn_mask; ++acptrp, ++i) {
-    if (*acptrp)
-      exit_one_client(*acptrp, comment);
+  /* Remove all clients of this server.  Exiting the last client in
+   * a page frees the page, so stop looking at it once that is done. */
+  for (page = cli_serv(cptr)->nn_live; page; page = next_page) {
+    next_page = page->next;
+    for (i = 0, left = page->count; left; ++i) {
+      if (page->slots[i]) {
+        --left;
+        exit_one_client(page->slots[i], comment);
+      }
+    }
   }
 }
 
@@ -375,6 +387,7 @@ int exit_client(struct Client *cptr,
                     ircd_ntoa(&cli_ip(victim)),
                     NumNick(victim) /* two %s's */);
     update_load();
+    log_event(EVENTLOG_EXIT, victim);
 
     on_for = CurrentTime - cli_firsttime(victim);
 
@@ -593,7 +606,8 @@ void tstats(struct Client *cptr, const struct StatDesc *sd, char *param)
   send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
 	     ":numerics seen %u mode fakes %u", sp->is_num, sp->is_fake);
   send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG,
-	     ":auth successes %u fails %u", sp->is_asuc, sp->is_abad);
+	     ":auth successes %u fails %u queued %u skipped %u", sp->is_asuc,
+	     sp->is_abad, sp->is_aqueue, sp->is_askip);
   send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG, ":local connections %u",
 	     sp->is_loc);
   send_reply(cptr, SND_EXPLICIT | RPL_STATSDEBUG, ":Client server");
@@ -65,6 +65,17 @@ unsigned int max_connection_count = 0;
 /** Maximum (local) client count since last restart. */
 unsigned int max_client_count = 0;
 
+/** State of the channel part of a burst that is being sent as the
+ * link's sendq drains.  Only one link is fed this way at a time; a
+ * link that completes its handshake while another is still being fed
+ * gets its channels all at once, as before.
+ */
+static struct {
+  struct Client*  link;  /**< Server being sent channels, or NULL. */
+  struct Channel* next;  /**< Next channel in GlobalChannelList to look at. */
+  unsigned int    mark;  /**< Channel::burst_mark of channels not yet sent. */
+} ChanBurst;
+
 /** Squit a new (pre-burst) server.
  * @param cptr Local client that tried to introduce the server.
  * @param sptr Server to disconnect.
@@ -257,6 +268,24 @@ int server_estab(struct Client *cptr, struct ConfItem *aconf)
    */
   {
     struct Channel *chptr;
+
+    if (!ChanBurst.link) {
+      /* Mark every existing channel as unsent, then let the sendq
+       * pull the channels out as it drains.
+       */
+      if (!++ChanBurst.mark)
+        ++ChanBurst.mark;
+      for (chptr = GlobalChannelList; chptr; chptr = chptr->next)
+        chptr->burst_mark = ChanBurst.mark;
+      ChanBurst.link = cptr;
+      ChanBurst.next = GlobalChannelList;
+      cli_serv(cptr)->flags |= SFLAG_BURSTING;
+      burst_next_channels(cptr);
+      if (!IsDead(cptr))
+        update_write(cptr);
+      return 0;
+    }
+
     for (chptr = GlobalChannelList; chptr; chptr = chptr->next)
       send_channel_modes(cptr, chptr);
   }
@@ -264,3 +293,67 @@ int server_estab(struct Client *cptr, struct ConfItem *aconf)
   return 0;
 }
 
+/** Send more channels to a server whose burst is in progress.
+ * Channels are sent until the link's sendq holds #BURST_SENDQ bytes;
+ * when the last one has gone, END_OF_BURST follows.
+ * @param[in] cptr Server being sent its burst.
+ */
+void burst_next_channels(struct Client *cptr)
+{
+  struct Channel *chptr;
+
+  assert(cptr == ChanBurst.link);
+
+  while (ChanBurst.next && !IsDead(cptr)
+         && MsgQLength(&(cli_sendQ(cptr))) < BURST_SENDQ) {
+    chptr = ChanBurst.next;
+    ChanBurst.next = chptr->next;
+    if (chptr->burst_mark == ChanBurst.mark) {
+      chptr->burst_mark = 0;
+      send_channel_modes(cptr, chptr);
+    }
+  }
+
+  if (!ChanBurst.next) {
+    ChanBurst.link = 0;
+    cli_serv(cptr)->flags &= ~SFLAG_BURSTING;
+    sendcmdto_one(&me, CMD_END_OF_BURST, cptr, "");
+  }
+}
+
+/** Make sure a channel has been sent to a server whose burst is in
+ * progress.  This must be called before sending a server message
+ * about \a chptr, so that the receiving server never hears about a
+ * channel's modes or members before the channel's BURST line.
+ * @param[in] chptr Channel about to be mentioned to other servers.
+ */
+void burst_channel(struct Channel *chptr)
+{
+  if (ChanBurst.link && chptr->burst_mark == ChanBurst.mark) {
+    chptr->burst_mark = 0;
+    send_channel_modes(ChanBurst.link, chptr);
+  }
+}
+
+/** Note that a channel is being destroyed, so a burst in progress
+ * does not look at it again.
+ * @param[in] chptr Channel being destroyed.
+ */
+void burst_forget_channel(struct Channel *chptr)
+{
+  if (ChanBurst.next == chptr)
+    ChanBurst.next = chptr->next;
+}
+
+/** Stop sending channels to a server that is going away.
+ * @param[in] cptr Server being removed.
+ */
+void burst_abort(struct Client *cptr)
+{
+  if (ChanBurst.link == cptr) {
+    ChanBurst.link = 0;
+    ChanBurst.next = 0;
+    cli_serv(cptr)->flags &= ~SFLAG_BURSTING;
+  }
+}
+
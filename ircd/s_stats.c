@@ -179,7 +179,7 @@ static struct StatDesc statsinfo[] = {
     "Service server information." },
   { 'u', "uptime", (STAT_FLAG_OPERFEAT | STAT_FLAG_CASESENS), &FEAT_HIS_STATS_UPTIME,
     stats_uptime, 0,
-    "Current uptime & highest connection count." },
+    "Current uptime, highest connection count & rehash times." },
   { 'v', "vservers", (STAT_FLAG_OPERFEAT | STAT_FLAG_VARPARAM | STAT_FLAG_CASESENS), &FEAT_HIS_STATS_VSERVERS,
     stats_servers_verbose, 1,
     "Verbose server information." },
@@ -549,7 +549,7 @@ stats_mapping(struct Client *to, const struct StatDesc* sd, char* param)
   }
 }
 
-/** Report server uptime and maximum connection/client counts.
+/** Report server uptime, maximum connection/client counts and rehash times.
  * @param[in] to Client requesting statistics.
  * @param[in] sd Stats descriptor for request (ignored).
  * @param[in] param Extra parameter from user (ignored).
@@ -563,6 +563,7 @@ stats_uptime(struct Client* to, const struct StatDesc* sd, char* param)
   send_reply(to, RPL_STATSUPTIME, nowr / 86400, (nowr / 3600) % 24,
              (nowr / 60) % 60, nowr % 60);
   send_reply(to, RPL_STATSCONN, max_connection_count, max_client_count);
+  report_rehash(to);
 }
 
 /** Verbosely report on servers connected to the network.
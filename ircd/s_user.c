@@ -35,6 +35,7 @@
 #include "ircd_alloc.h"
 #include "ircd_chattr.h"
 #include "ircd_features.h"
+#include "ircd_intern.h"
 #include "ircd_log.h"
 #include "ircd_reply.h"
 #include "ircd_snprintf.h"
@@ -57,6 +58,7 @@
 #include "s_serv.h" /* max_client_count */
 #include "send.h"
 #include "struct.h"
+#include "target.h"
 #include "userload.h"
 #include "version.h"
 #include "whowas.h"
@@ -73,6 +75,12 @@
 /** Count of allocated User structures. */
 static int userCount = 0;
 
+/** Slab cache for User structures. */
+static struct SlabCache userSlab = SLAB_CACHE_INIT("User", struct User);
+
+/** Last value given to a User's mask_stamp. */
+static unsigned int last_mask_stamp;
+
 static
 void send_umode(struct Client *cptr, struct Client *sptr, struct Flags *old,
                 int sendset);
@@ -89,11 +97,16 @@ struct User *make_user(struct Client *cptr)
   assert(0 != cptr);
 
   if (!cli_user(cptr)) {
-    cli_user(cptr) = (struct User*) MyMalloc(sizeof(struct User));
+    cli_user(cptr) = (struct User*) slab_alloc(&userSlab);
     assert(0 != cli_user(cptr));
 
     /* All variables are 0 by default */
     memset(cli_user(cptr), 0, sizeof(struct User));
+    cli_user(cptr)->username = intern_empty;
+    cli_user(cptr)->host = intern_empty;
+    cli_user(cptr)->realhost = intern_empty;
+    cli_user(cptr)->account = intern_empty;
+    cli_user(cptr)->mask_stamp = ++last_mask_stamp;
     ++userCount;
     cli_user(cptr)->refcnt = 1;
   }
@@ -113,6 +126,11 @@ void free_user(struct User* user)
   if (--user->refcnt == 0) {
     if (user->away)
       MyFree(user->away);
+    intern_release(user->username);
+    intern_release(user->host);
+    intern_release(user->realhost);
+    intern_release(user->account);
+    silence_changed(user);
     /*
      * sanity check
      */
@@ -120,12 +138,21 @@ void free_user(struct User* user)
     assert(0 == user->invited);
     assert(0 == user->channel);
 
-    MyFree(user);
+    slab_free(&userSlab, user);
     assert(userCount>0);
     --userCount;
   }
 }
 
+/** Note that the nick, host or account of \a cptr changed.
+ * Cached silence results for \a cptr as a sender are then ignored.
+ * @param[in] cptr User whose mask changed.
+ */
+static void user_mask_changed(struct Client *cptr)
+{
+  cli_user(cptr)->mask_stamp = ++last_mask_stamp;
+}
+
 /** Find number of User structs allocated and memory used by them.
  * @param[out] count_out Receives number of User structs allocated.
  * @param[out] bytes_out Receives number of bytes used by User structs.
@@ -396,6 +423,7 @@ int register_user(struct Client *cptr, struct Client *sptr)
                     cli_name(sptr), user->username, user->host,
                     cli_sock_ip(sptr), get_client_class(sptr),
                     cli_info(sptr), NumNick(cptr) /* two %s's */);
+    log_event(EVENTLOG_REGISTER, sptr);
 
     IPcheck_connect_succeeded(sptr);
     /*
@@ -561,10 +589,10 @@ int set_nick_name(struct Client* cptr, struct Client* sptr,
 
     cli_serv(sptr)->ghost = 0;        /* :server NICK means end of net.burst */
     ircd_strncpy(cli_username(new_client), parv[4], USERLEN);
-    ircd_strncpy(cli_user(new_client)->username, parv[4], USERLEN);
-    ircd_strncpy(cli_user(new_client)->host, parv[5], HOSTLEN);
-    ircd_strncpy(cli_user(new_client)->realhost, parv[5], HOSTLEN);
-    ircd_strncpy(cli_info(new_client), parv[parc - 1], REALLEN);
+    intern_set(&cli_user(new_client)->username, parv[4], USERLEN);
+    intern_set(&cli_user(new_client)->host, parv[5], HOSTLEN);
+    cli_user(new_client)->realhost = intern_ref(cli_user(new_client)->host);
+    intern_set(&cli_info(new_client), parv[parc - 1], REALLEN);
 
     Count_newremoteclient(UserStats, sptr);
 
@@ -642,6 +670,10 @@ int set_nick_name(struct Client* cptr, struct Client* sptr,
       hRemClient(sptr);
     strcpy(cli_name(sptr), nick);
     hAddClient(sptr);
+    if (IsUser(sptr)) {
+      names_cache_invalidate_user(sptr);
+      user_mask_changed(sptr);
+    }
   }
   else {
     /* Local client setting NICK the first time */
@@ -652,15 +684,6 @@ int set_nick_name(struct Client* cptr, struct Client* sptr,
   return 0;
 }
 
-/** Calculate the hash value for a target.
- * @param[in] target Pointer to target, cast to unsigned int.
- * @return Hash value constructed from the pointer.
- */
-static unsigned char hash_target(unsigned int target)
-{
-  return (unsigned char) (target >> 16) ^ (target >> 8);
-}
-
 /** Records \a target as a recent target for \a sptr.
  * @param[in] sptr User who has sent to a new target.
  * @param[in] target Target to add.
@@ -668,29 +691,10 @@ static unsigned char hash_target(unsigned int target)
 void
 add_target(struct Client *sptr, void *target)
 {
-  /* Ok, this shouldn't work esp on alpha
-  */
-  unsigned char  hash = hash_target((unsigned long) target);
-  unsigned char* targets;
-  int            i;
   assert(0 != sptr);
   assert(cli_local(sptr));
 
-  targets = cli_targets(sptr);
-
-  /* 
-   * Already in table?
-   */
-  for (i = 0; i < MAXTARGETS; ++i) {
-    if (targets[i] == hash)
-      return;
-  }
-  /*
-   * New target
-   */
-  memmove(&targets[RESERVEDTARGETS + 1],
-          &targets[RESERVEDTARGETS], MAXTARGETS - RESERVEDTARGETS - 1);
-  targets[RESERVEDTARGETS] = hash;
+  target_add_reply(cli_targets(sptr), target_hash(target));
 }
 
 /** Check whether \a sptr can send to or join \a target yet.
@@ -703,57 +707,36 @@ add_target(struct Client *sptr, void *target)
 int check_target_limit(struct Client *sptr, void *target, const char *name,
     int created)
 {
-  unsigned char hash = hash_target((unsigned long) target);
-  int            i;
-  unsigned char* targets;
+  unsigned int hash = target_hash(target);
 
   assert(0 != sptr);
   assert(cli_local(sptr));
-  targets = cli_targets(sptr);
 
   /* If user is invited to channel, give him/her a free target */
   if (IsChannelName(name) && is_invited(sptr, target))
     return 0;
 
   /*
-   * Same target as last time?
+   * Same target as recently?
    */
-  if (targets[0] == hash)
+  if (target_find(cli_targets(sptr), hash))
     return 0;
-  for (i = 1; i < MAXTARGETS; ++i) {
-    if (targets[i] == hash) {
-      memmove(&targets[1], &targets[0], i);
-      targets[0] = hash;
-      return 0;
-    }
-  }
   /*
    * New target
    */
   if (!created) {
-    if (CurrentTime < cli_nexttarget(sptr)) {
-      /* If user is invited to channel, give him/her a free target */
-      if (IsChannelName(name) && is_invited(sptr, target))
-        return 0;
-
-      if (cli_nexttarget(sptr) - CurrentTime < TARGET_DELAY + 8) {
-        /*
-         * No server flooding
-         */
-        cli_nexttarget(sptr) += 2;
-        send_reply(sptr, ERR_TARGETTOOFAST, name,
-                   cli_nexttarget(sptr) - CurrentTime);
-      }
+    switch (target_use(&cli_nexttarget(sptr), CurrentTime)) {
+    case TARGET_OK:
+      break;
+    case TARGET_TOOFAST:
+      send_reply(sptr, ERR_TARGETTOOFAST, name,
+                 cli_nexttarget(sptr) - CurrentTime);
+      return 1;
+    case TARGET_TOOFAST_QUIET:
       return 1;
-    }
-    else {
-      cli_nexttarget(sptr) += TARGET_DELAY;
-      if (cli_nexttarget(sptr) < CurrentTime - (TARGET_DELAY * (MAXTARGETS - 1)))
-        cli_nexttarget(sptr) = CurrentTime - (TARGET_DELAY * (MAXTARGETS - 1));
     }
   }
-  memmove(&targets[1], &targets[0], MAXTARGETS - 1);
-  targets[0] = hash;
+  target_push(cli_targets(sptr), hash);
   return 0;
 }
 
@@ -893,7 +876,9 @@ int
 hide_hostmask(struct Client *cptr, unsigned int flag)
 {
   struct Membership *chan;
+  char host[HOSTLEN + 1];
 
+  user_mask_changed(cptr);
   switch (flag) {
   case FLAG_HIDDENHOST:
     /* Local users cannot set +x unless FEAT_HOST_HIDING is true. */
@@ -915,8 +900,9 @@ hide_hostmask(struct Client *cptr, unsigned int flag)
     return 0;
 
   sendcmdto_common_channels(cptr, CMD_QUIT, cptr, ":Registered");
-  ircd_snprintf(0, cli_user(cptr)->host, HOSTLEN, "%s.%s",
+  ircd_snprintf(0, host, HOSTLEN, "%s.%s",
                 cli_user(cptr)->account, feature_str(FEAT_HIDDEN_HOST));
+  intern_set(&cli_user(cptr)->host, host, HOSTLEN);
 
   /* ok, the client is now fully hidden, so let them know -- hikari */
   if (MyConnect(cptr))
@@ -1187,10 +1173,13 @@ int set_user_mode(struct Client *cptr, struct Client *sptr, int parc,
 	      "account \"%s\", timestamp %Tu", account,
 	      cli_user(sptr)->acc_create));
       }
-      ircd_strncpy(cli_user(sptr)->account, account, len);
+      intern_set(&cli_user(sptr)->account, account, len);
+      user_mask_changed(sptr);
   }
   if (!FlagHas(&setflags, FLAG_HIDDENHOST) && do_host_hiding)
     hide_hostmask(sptr, FLAG_HIDDENHOST);
+  if (!MyConnect(sptr) && !FlagHas(&setflags, FLAG_DEAF) != !IsDeaf(sptr))
+    channel_update_deaf(sptr);
 
   if (IsRegistered(sptr)) {
     if (!FlagHas(&setflags, FLAG_OPER) && IsOper(sptr)) {
@@ -1214,9 +1203,11 @@ int set_user_mode(struct Client *cptr, struct Client *sptr, int parc,
     if (FlagHas(&setflags, FLAG_INVISIBLE) && !IsInvisible(sptr)) {
       assert(UserStats.inv_clients > 0);
       --UserStats.inv_clients;
+      names_cache_invalidate_user(sptr);
     }
     if (!FlagHas(&setflags, FLAG_INVISIBLE) && IsInvisible(sptr)) {
       ++UserStats.inv_clients;
+      names_cache_invalidate_user(sptr);
     }
     assert(UserStats.opers <= UserStats.clients + UserStats.unknowns);
     assert(UserStats.inv_clients <= UserStats.clients + UserStats.unknowns);
@@ -1249,7 +1240,7 @@ char *umode_str(struct Client *cptr)
 
   if (IsAccount(cptr))
   {
-    char* t = cli_user(cptr)->account;
+    const char* t = cli_user(cptr)->account;
 
     *m++ = ' ';
     while ((*m++ = *t++))
@@ -1260,8 +1251,9 @@ char *umode_str(struct Client *cptr)
       Debug((DEBUG_DEBUG, "Sending timestamped account in user mode for "
 	     "account \"%s\"; timestamp %Tu", cli_user(cptr)->account,
 	     cli_user(cptr)->acc_create));
-      ircd_snprintf(0, t = nbuf, sizeof(nbuf), ":%Tu",
+      ircd_snprintf(0, nbuf, sizeof(nbuf), ":%Tu",
 		    cli_user(cptr)->acc_create);
+      t = nbuf;
       m--; /* back up over previous nul-termination */
       while ((*m++ = *t++))
 	; /* Empty loop */
@@ -1447,6 +1439,70 @@ void set_snomask(struct Client *cptr, unsigned int newmask, int what)
   cli_snomask(cptr) = newmask;
 }
 
+/** Number of recent senders whose silence result is remembered. */
+#define SILENCE_RECENT 4
+
+/** A user's silence list compiled for matching, with the results for
+ * the most recent senders.
+ */
+struct SilenceMatch {
+  struct BanSet *set;           /**< Compiled silence list. */
+  unsigned int generation;      /**< feature_generation when compiled. */
+  unsigned int next;            /**< Entry in recent to replace next. */
+  /** Result of matching one sender. */
+  struct {
+    struct Client *sender;      /**< Sender that was checked. */
+    unsigned int stamp;         /**< Sender's mask_stamp at the time. */
+    struct Ban *found;          /**< Matching silence, or NULL. */
+  } recent[SILENCE_RECENT];
+};
+
+/** Forget the compiled silence list of \a user.
+ * Must be called whenever the user's silence list changes.
+ * @param[in] user User whose silence list changed.
+ */
+void silence_changed(struct User *user)
+{
+  if (!user->silence_match)
+    return;
+  banset_free(user->silence_match->set);
+  MyFree(user->silence_match);
+  user->silence_match = NULL;
+}
+
+/** Find the silence of \a user that matches \a sptr.
+ * The silence list is compiled on first use.  A sender's result stays
+ * cached until its nick, host or account changes, the silence list
+ * changes, or features are changed (FEAT_HIDDEN_HOST affects matching).
+ * @param[in] sptr User trying to send a message.
+ * @param[in] user Recipient with a non-empty silence list.
+ * @return Matching positive silence, or NULL if none.
+ */
+static struct Ban *find_silence(struct Client *sptr, struct User *user)
+{
+  struct SilenceMatch *sm = user->silence_match;
+  unsigned int stamp = cli_user(sptr)->mask_stamp, ii;
+
+  if (sm && sm->generation != feature_generation) {
+    silence_changed(user);
+    sm = NULL;
+  }
+  if (!sm) {
+    sm = user->silence_match = MyCalloc(1, sizeof(*sm));
+    sm->set = banset_create(user->silence);
+    sm->generation = feature_generation;
+  }
+  for (ii = 0; ii < SILENCE_RECENT; ++ii)
+    if (sm->recent[ii].sender == sptr && sm->recent[ii].stamp == stamp)
+      return sm->recent[ii].found;
+  ii = sm->next;
+  sm->next = (ii + 1) % SILENCE_RECENT;
+  sm->recent[ii].sender = sptr;
+  sm->recent[ii].stamp = stamp;
+  sm->recent[ii].found = banset_find(sm->set, sptr);
+  return sm->recent[ii].found;
+}
+
 /** Check whether \a sptr is allowed to send a message to \a acptr.
  * If \a sptr is a remote user, it means some server has an outdated
  * SILENCE list for \a acptr, so send the missing SILENCE mask(s) back
@@ -1462,8 +1518,8 @@ int is_silenced(struct Client *sptr, struct Client *acptr)
   size_t buf_used, slen;
   char buf[BUFSIZE];
 
-  if (IsServer(sptr) || !(user = cli_user(acptr))
-      || !(found = find_ban(sptr, user->silence)))
+  if (IsServer(sptr) || !(user = cli_user(acptr)) || !user->silence
+      || !(found = find_silence(sptr, user)))
     return 0;
   assert(!(found->flags & BAN_EXCEPTION));
   if (!MyConnect(sptr)) {
@@ -28,6 +28,7 @@
 #include "client.h"
 #include "ircd.h"
 #include "ircd_features.h"
+#include "ircd_intern.h"
 #include "ircd_log.h"
 #include "ircd_snprintf.h"
 #include "ircd_string.h"
@@ -39,6 +40,7 @@
 #include "s_bsd.h"
 #include "s_debug.h"
 #include "s_misc.h"
+#include "s_serv.h"
 #include "s_user.h"
 #include "struct.h"
 
@@ -93,7 +95,7 @@ static void dead_link(struct Client *to, char *notice)
   /*
    * Keep a copy of the last comment, for later use...
    */
-  ircd_strncpy(cli_info(to), notice, REALLEN);
+  intern_set(&cli_info(to), notice, REALLEN);
 
   if (!IsUser(to) && !IsUnknown(to) && !HasFlag(to, FLAG_CLOSING))
     sendto_opmask(0, SNO_OLDSNO, "%s for %s", cli_info(to), cli_name(to));
@@ -138,6 +140,21 @@ kill_highest_sendq(int servers_too)
     dead_link(highest_client, "Buffer allocation error");
 }
 
+/** Compact the sendQs of local connections.
+ * This should be called when buffer memory is running low, before
+ * resorting to kill_highest_sendq().  It stops once the buffer pool
+ * is back under its low watermark.
+ */
+void
+compact_sendqs(void)
+{
+  int i;
+
+  for (i = HighestFd; i >= 0 && msgq_pressure(); i--)
+    if (LocalClientArray[i] && cli_connect(LocalClientArray[i]))
+      msgq_compact(&(cli_sendQ(LocalClientArray[i])));
+}
+
 /*
  * flush_connections
  *
@@ -238,7 +255,10 @@ void send_buffer(struct Client* to, struct MsgBuf* buf, int prio)
 
   Debug((DEBUG_SEND, "Sending [%p] to %s", buf, cli_name(to)));
 
-  msgq_add(&(cli_sendQ(to)), buf, prio);
+  if (IsServer(to))
+    msgq_add_coalesced(&(cli_sendQ(to)), buf, prio);
+  else
+    msgq_add(&(cli_sendQ(to)), buf, prio);
   client_add_sendq(cli_connect(to), &send_queues);
   update_write(to);
 
@@ -486,6 +506,7 @@ void sendcmdto_common_channels(struct Client *from, const char *cmd,
   struct MsgBuf *mb;
   struct Membership *chan;
   struct Membership *member;
+  unsigned int ii;
 
   assert(0 != from);
   assert(0 != cli_from(from));
@@ -502,20 +523,20 @@ void sendcmdto_common_channels(struct Client *from, const char *cmd,
 
   bump_sentalong(from);
   /*
-   * loop through from's channels, and the members on their channels
+   * loop through from's channels, and the local members on their channels
    */
   for (chan = cli_user(from)->channel; chan; chan = chan->next_channel) {
     if (IsZombie(chan) || IsDelayedJoin(chan))
       continue;
-    for (member = chan->channel->members; member;
-	 member = member->next_member)
-      if (MyConnect(member->user)
-          && -1 < cli_fd(cli_from(member->user))
+    for (ii = 0; ii < chan->channel->nlocals; ++ii) {
+      member = chan->channel->locals[ii];
+      if (-1 < cli_fd(member->user)
           && member->user != one
           && cli_sentalong(member->user) != sentalong_marker) {
 	cli_sentalong(member->user) = sentalong_marker;
 	send_buffer(member->user, mb, 0);
       }
+    }
   }
 
   if (MyConnect(from) && from != one)
@@ -526,6 +547,9 @@ void sendcmdto_common_channels(struct Client *from, const char *cmd,
 
 /** Send a (prefixed) command to all users on this channel, except for
  * \a one and those matching \a skip.
+ * Local members are found in the channel's locals array and servers
+ * from its per-link member counts, so remote members are only walked
+ * individually for SKIP_NONOPS and SKIP_NONVOICES.
  * @warning \a pattern must not contain %v.
  * @param[in] from Client originating the command.
  * @param[in] cmd Long name of command.
@@ -541,12 +565,19 @@ void sendcmdto_channel(struct Client *from, const char *cmd,
                        const char *pattern, ...)
 {
   struct Membership *member;
+  struct ChanLink *cl;
+  struct Client *link;
   struct VarData vd;
   struct MsgBuf *user_mb;
   struct MsgBuf *serv_mb;
+  unsigned int ii;
 
   vd.vd_format = pattern;
 
+  /* Nothing to do if nobody would get the message. */
+  if (!to->nlocals && (!to->nlinks || (skip & SKIP_SERVERS)))
+    return;
+
   /* Build buffer to send to users */
   va_start(vd.vd_args, pattern);
   user_mb = msgq_make(0, skip & (SKIP_NONOPS | SKIP_NONVOICES) ? "%:#C %s @%v" : "%:#C %s %v",
@@ -558,6 +589,7 @@ void sendcmdto_channel(struct Client *from, const char *cmd,
     serv_mb = NULL;
   else
   {
+    burst_channel(to);
     va_start(vd.vd_args, pattern);
     serv_mb = msgq_make(&me, skip & SKIP_NONOPS ? "%C %s @%v" : "%C %s %v",
                         from, tok, &vd);
@@ -566,21 +598,49 @@ void sendcmdto_channel(struct Client *from, const char *cmd,
 
   /* send buffer along! */
   bump_sentalong(one);
-  for (member = to->members; member; member = member->next_member) {
+  for (ii = 0; ii < to->nlocals; ++ii) {
+    member = to->locals[ii];
     /* skip duplicates, zombies, and flagged users... */
     if (cli_sentalong(member->user) == sentalong_marker ||
         IsZombie(member) ||
         (skip & SKIP_DEAF && IsDeaf(member->user)) ||
         (skip & SKIP_NONOPS && !IsChanOp(member)) ||
         (skip & SKIP_NONVOICES && !IsChanOp(member) && !HasVoice(member)) ||
-        (skip & SKIP_BURST && IsBurstOrBurstAck(cli_from(member->user))) ||
-        !(serv_mb || MyUser(member->user)) ||
-        cli_fd(cli_from(member->user)) < 0)
+        cli_fd(member->user) < 0)
       continue;
     cli_sentalong(member->user) = sentalong_marker;
+    send_buffer(member->user, user_mb, 0);
+  }
 
-    /* pick right buffer to send */
-    send_buffer(member->user, MyConnect(member->user) ? user_mb : serv_mb, 0);
+  if (serv_mb && (skip & (SKIP_NONOPS | SKIP_NONVOICES))) {
+    /* Whether a link is needed depends on its members' channel modes. */
+    for (ii = 0; ii < to->nmembers; ++ii) {
+      member = to->members[ii];
+      link = cli_from(member->user);
+      if (MyConnect(member->user) ||
+          cli_sentalong(link) == sentalong_marker ||
+          IsZombie(member) ||
+          (skip & SKIP_DEAF && IsDeaf(member->user)) ||
+          (skip & SKIP_NONOPS && !IsChanOp(member)) ||
+          (skip & SKIP_NONVOICES && !IsChanOp(member) && !HasVoice(member)) ||
+          (skip & SKIP_BURST && IsBurstOrBurstAck(link)) ||
+          cli_fd(link) < 0)
+        continue;
+      cli_sentalong(link) = sentalong_marker;
+      send_buffer(link, serv_mb, 0);
+    }
+  } else if (serv_mb) {
+    for (ii = 0; ii < to->nlinks; ++ii) {
+      cl = &to->links[ii];
+      link = cl->link;
+      if (cli_sentalong(link) == sentalong_marker ||
+          (skip & SKIP_DEAF && cl->deaf == cl->members) ||
+          (skip & SKIP_BURST && IsBurstOrBurstAck(link)) ||
+          cli_fd(link) < 0)
+        continue;
+      cli_sentalong(link) = sentalong_marker;
+      send_buffer(link, serv_mb, 0);
+    }
   }
 
   msgq_clean(user_mb);
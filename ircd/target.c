@@ -0,0 +1,118 @@
+/*
+ * IRC - Internet Relay Chat, ircd/target.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+/** @file
+ * @brief Recent target lists and the target change rate limit.
+ */
+#include "config.h"
+
+#include "target.h"
+#include "ircd_defs.h"
+#include "ircd_log.h"
+#include "s_user.h"
+
+/* #include <assert.h> -- Now using assert in ircd_log.h */
+#include <string.h>
+
+/** Calculate the hash value for a target.
+ * Distinct live targets get distinct hashes unless their addresses
+ * differ only above the low 32 bits.
+ * @param[in] target Client or channel that is the target.
+ * @return Non-zero hash value for \a target.
+ */
+unsigned int target_hash(const void *target)
+{
+  unsigned long val = (unsigned long) target;
+  unsigned int hash;
+
+  /* Two shifts, so this is not undefined with a 32-bit long. */
+  hash = (unsigned int) val ^ (unsigned int) (val >> 16 >> 16);
+  return hash ? hash : 1; /* zero marks an unused entry */
+}
+
+/** Look for a target in a recent target list.
+ * If found, it becomes the most recent target.
+ * @param[in,out] targets Recent target list (MAXTARGETS entries).
+ * @param[in] hash Hash of the target, from target_hash().
+ * @return Non-zero if \a hash was in the list, zero if not.
+ */
+int target_find(unsigned int *targets, unsigned int hash)
+{
+  unsigned int ii;
+
+  if (targets[0] == hash)
+    return 1;
+  for (ii = 1; ii < MAXTARGETS; ++ii) {
+    if (targets[ii] == hash) {
+      memmove(&targets[1], &targets[0], ii * sizeof(*targets));
+      targets[0] = hash;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/** Add a new target to the front of a recent target list.
+ * The oldest target drops off the end.
+ * @param[in,out] targets Recent target list (MAXTARGETS entries).
+ * @param[in] hash Hash of the target, from target_hash().
+ */
+void target_push(unsigned int *targets, unsigned int hash)
+{
+  memmove(&targets[1], &targets[0], (MAXTARGETS - 1) * sizeof(*targets));
+  targets[0] = hash;
+}
+
+/** Note that someone sent to the owner of a recent target list.
+ * Unless already present, the sender is added after the owner's
+ * RESERVEDTARGETS most recent targets, so answering it is free.
+ * @param[in,out] targets Recent target list (MAXTARGETS entries).
+ * @param[in] hash Hash of the sender, from target_hash().
+ */
+void target_add_reply(unsigned int *targets, unsigned int hash)
+{
+  unsigned int ii;
+
+  for (ii = 0; ii < MAXTARGETS; ++ii)
+    if (targets[ii] == hash)
+      return;
+  memmove(&targets[RESERVEDTARGETS + 1], &targets[RESERVEDTARGETS],
+          (MAXTARGETS - RESERVEDTARGETS - 1) * sizeof(*targets));
+  targets[RESERVEDTARGETS] = hash;
+}
+
+/** Try to use up a free target.
+ * @param[in,out] next_target Time when the next target change is allowed.
+ * @param[in] now Current time.
+ * @return TARGET_OK if a free target was used; TARGET_TOOFAST if none
+ * was free and the user should be told (\a next_target is delayed a
+ * little more for flooding); TARGET_TOOFAST_QUIET if none was free
+ * and the user was already told enough.
+ */
+enum TargetResult target_use(time_t *next_target, time_t now)
+{
+  if (now < *next_target) {
+    if (*next_target - now >= TARGET_DELAY + 8)
+      return TARGET_TOOFAST_QUIET;
+    *next_target += 2; /* No server flooding */
+    return TARGET_TOOFAST;
+  }
+  *next_target += TARGET_DELAY;
+  if (*next_target < now - (TARGET_DELAY * (MAXTARGETS - 1)))
+    *next_target = now - (TARGET_DELAY * (MAXTARGETS - 1));
+  return TARGET_OK;
+}
@@ -0,0 +1,438 @@
+/*
+ * ircd_conf_index_t.c - test configuration indexes against a list scan
+ *
+ * Builds Client and Kill block indexes the way s_conf.c does and
+ * checks that, for every test client, the blocks the index hands out
+ * (and so the first one that matches) are the same as a scan of the
+ * block list would find, for fixed tables of overlapping CIDR,
+ * "*.domain", realname and wildcard blocks and for randomly generated
+ * ones.
+ */
+
+#include "conf_index.h"
+#include "ircd_log.h"
+#include "ircd_string.h"
+#include "match.h"
+#include "res.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** A Client block, reduced to the fields attach_iline() checks. */
+struct iline_test {
+  const char *username;         /**< Username mask, or NULL. */
+  const char *host;             /**< Host mask, or NULL. */
+  const char *ip;               /**< IP mask, or NULL. */
+  struct irc_in_addr addr;      /**< Parsed form of #ip. */
+  unsigned char addrbits;       /**< Bits in #addr; 0 if no #ip. */
+};
+
+/** A Kill block, reduced to the fields find_kill() checks. */
+struct kill_test {
+  const char *usermask;         /**< Username mask, or NULL. */
+  const char *hostmask;         /**< Host or IP mask, or NULL. */
+  const char *realmask;         /**< Realname mask, or NULL. */
+  struct irc_in_addr address;   /**< Parsed form of #hostmask. */
+  unsigned char bits;           /**< Bits in #address; 0 if not an IP mask. */
+};
+
+/** A registering client, and the block it should get. */
+struct client_test {
+  const char *username;
+  const char *sockhost;
+  const char *ip;
+  const char *realname;
+  int first;
+};
+
+/** Function to check whether a block matches a client. */
+typedef int (*block_match_f)(const void *block, const struct client_test *cli,
+                             const struct irc_in_addr *ip);
+
+struct iline_test iline_blocks[] = {
+  { NULL, NULL, "10.1.0.0/16" },                /* 0 */
+  { NULL, "*.example.com", NULL },              /* 1 */
+  { "~*", NULL, "10.0.0.0/8" },                 /* 2 */
+  { NULL, "shell.example.com", NULL },          /* 3 */
+  { NULL, NULL, "10.1.2.0/24" },                /* 4 */
+  { NULL, "*.EXAMPLE.org", NULL },              /* 5 */
+  { NULL, "*.sub.example.org", NULL },          /* 6 */
+  { NULL, "host?.example.net", NULL },          /* 7 */
+  { NULL, NULL, "2001:db8::/32" },              /* 8 */
+  { NULL, NULL, "10.1.2.3" },                   /* 9 */
+  { "trusted", "*", NULL },                     /* 10 */
+  { NULL, NULL, "0.0.0.0/0" },                  /* 11 */
+  { NULL, "*", NULL },                          /* 12 */
+  { NULL, NULL, NULL }
+};
+
+const struct client_test iline_clients[] = {
+  { "joe", "a.b.example.com", "10.1.2.3", NULL, 0 },
+  { "joe", "a.b.example.com", "192.0.2.1", NULL, 1 },
+  { "~joe", "host.isp.net", "10.9.9.9", NULL, 2 },
+  { "joe", "host.isp.net", "10.9.9.9", NULL, 11 },
+  { "joe", "SHELL.example.COM", "192.0.2.7", NULL, 1 },
+  { "joe", "www.sub.example.org", "192.0.2.8", NULL, 5 },
+  { "joe", "hostx.example.net", "192.0.2.9", NULL, 7 },
+  { "joe", "host.example.net", "192.0.2.9", NULL, 11 },
+  { "joe", "2001:db8::1", "2001:db8::1", NULL, 8 },
+  { "trusted", "2001:db9::1", "2001:db9::1", NULL, 10 },
+  { "joe", "2001:db9::1", "2001:db9::1", NULL, 12 },
+  { "joe", "example.com", "192.0.2.10", NULL, 11 },
+  { NULL, NULL, NULL, NULL, 0 }
+};
+
+struct kill_test kill_blocks[] = {
+  { "*", "10.2.0.0/16", NULL },                 /* 0 */
+  { NULL, NULL, "*trojan*" },                   /* 1 */
+  { "*", "*.bad.example", NULL },               /* 2 */
+  { "*", "*.example.net", "Spam Bot" },         /* 3 */
+  { "~*", "10.2.3.0/24", NULL },                /* 4 */
+  { "*", "shell.bad.example", NULL },           /* 5 */
+  { NULL, NULL, "Spam Bot" },                   /* 6 */
+  { "evil", "*", NULL },                        /* 7 */
+  { "*", "host?.example.org", NULL },           /* 8 */
+  { "*", "*", "x*" },                           /* 9 */
+  { "*", "2001:db8::/32", NULL },               /* 10 */
+  { "~*", "10.3.0.0/16", "Joe" },               /* 11 */
+  { NULL, NULL, NULL }
+};
+
+const struct client_test kill_clients[] = {
+  { "joe", "a.bad.example", "192.0.2.1", "Joe", 2 },
+  { "joe", "shell.bad.example", "192.0.2.1", "Joe", 2 },
+  { "joe", "host.isp.net", "10.2.9.9", "Joe", 0 },
+  { "~joe", "host.isp.net", "10.2.3.4", "Joe", 0 },
+  { "~joe", "host.isp.net", "10.3.3.4", "Joe", 11 },
+  { "~joe", "host.isp.net", "10.3.3.4", "Joey", -1 },
+  { "joe", "a.example.net", "192.0.2.2", "Spam Bot", 3 },
+  { "joe", "host.isp.net", "192.0.2.3", "Spam Bot", 6 },
+  { "joe", "host.isp.net", "192.0.2.3", "SPAM bot", 6 },
+  { "evil", "host.isp.net", "192.0.2.4", "Joe", 7 },
+  { "joe", "host1.example.org", "192.0.2.5", "Joe", 8 },
+  { "joe", "host.isp.net", "192.0.2.6", "xavier", 9 },
+  { "joe", "2001:db8::5", "2001:db8::5", "Joe", 10 },
+  { "joe", "a.bad.example", "192.0.2.7", "My trojan", 1 },
+  { "joe", "host.isp.net", "192.0.2.8", "Joe", -1 },
+  { NULL, NULL, NULL, NULL, 0 }
+};
+
+static unsigned long rand_state = 1;
+
+/** Return a pseudo-random number, the same on every platform. */
+static unsigned int next_rand(void)
+{
+  rand_state = rand_state * 1103515245 + 12345;
+  return (rand_state >> 16) & 0x7fff;
+}
+
+/** Check a Client block the way iline_match() does, minus the port. */
+static int iline_matches(const void *block, const struct client_test *cli,
+                         const struct irc_in_addr *ip)
+{
+  const struct iline_test *blk = block;
+
+  if (blk->username && match(blk->username, cli->username))
+    return 0;
+  if (blk->host && match(blk->host, cli->sockhost))
+    return 0;
+  if (!ipmask_check(ip, &blk->addr, blk->addrbits))
+    return 0;
+  return 1;
+}
+
+/** Parse the IP masks of a block list and index it like
+ * iline_build_index().
+ */
+static void iline_index(struct ConfIndex *ci, struct iline_test *blocks,
+                        unsigned int count)
+{
+  unsigned int ii;
+
+  conf_index_init(ci, count);
+  for (ii = 0; ii < count; ++ii) {
+    if (blocks[ii].ip) {
+      if (!ipmask_parse(blocks[ii].ip, &blocks[ii].addr, &blocks[ii].addrbits)) {
+        fprintf(stderr, "Bad IP mask \"%s\".\n", blocks[ii].ip);
+        assert(0);
+      }
+    } else {
+      memset(&blocks[ii].addr, 0, sizeof(blocks[ii].addr));
+      blocks[ii].addrbits = 0;
+    }
+    ci->entries[ii].item = &blocks[ii];
+  }
+  while (ii-- > 0)
+    conf_index_place(ci, ii, &blocks[ii].addr, blocks[ii].addrbits,
+                     blocks[ii].host, NULL);
+}
+
+/** Check a Kill block the way find_kill() does. */
+static int kill_matches(const void *block, const struct client_test *cli,
+                        const struct irc_in_addr *ip)
+{
+  const struct kill_test *deny = block;
+
+  if (deny->usermask && match(deny->usermask, cli->username))
+    return 0;
+  if (deny->realmask && match(deny->realmask, cli->realname))
+    return 0;
+  if (deny->bits > 0) {
+    if (!ipmask_check(ip, &deny->address, deny->bits))
+      return 0;
+  } else if (deny->hostmask && match(deny->hostmask, cli->sockhost))
+    return 0;
+  return 1;
+}
+
+/** Parse the host masks of a Kill block list and index it like
+ * kill_build_index().
+ */
+static void kill_index(struct ConfIndex *ci, struct kill_test *blocks,
+                       unsigned int count)
+{
+  unsigned int ii;
+
+  conf_index_init(ci, count);
+  for (ii = 0; ii < count; ++ii) {
+    memset(&blocks[ii].address, 0, sizeof(blocks[ii].address));
+    blocks[ii].bits = 0;
+    if (blocks[ii].hostmask)
+      ipmask_parse(blocks[ii].hostmask, &blocks[ii].address, &blocks[ii].bits);
+    ci->entries[ii].item = &blocks[ii];
+  }
+  while (ii-- > 0)
+    conf_index_place(ci, ii, &blocks[ii].address, blocks[ii].bits,
+                     blocks[ii].hostmask, blocks[ii].realmask);
+}
+
+/** Report a block that a scan of the list would have matched but
+ * that the index did not offer.
+ */
+static void skipped(const struct client_test *cli, unsigned int seq)
+{
+  fprintf(stderr, "%s@%s [%s] (%s): index skipped block %u.\n",
+          cli->username, cli->sockhost, cli->ip,
+          cli->realname ? cli->realname : "", seq);
+  assert(0);
+}
+
+/** Check that the index offers every block that matches \a cli, in
+ * list order, and return the first one (or -1).
+ */
+static int index_check(struct ConfIndex *ci, unsigned int count,
+                       block_match_f matches, const struct client_test *cli)
+{
+  struct ConfIndexEntry *cand[CONF_INDEX_CANDIDATES];
+  struct ConfIndexEntry *entry;
+  struct irc_in_addr ip;
+  unsigned int ii = 0;
+  int ncand, first = -1;
+
+  if (!ircd_aton(&ip, cli->ip)) {
+    fprintf(stderr, "Bad IP \"%s\".\n", cli->ip);
+    assert(0);
+  }
+  ncand = conf_index_lookup(ci, &ip, cli->sockhost, cli->realname, cand);
+  while ((entry = conf_index_next(cand, ncand))) {
+    assert(entry->seq < count);
+    if (!matches(entry->item, cli, &ip))
+      continue;
+    /* No block before this one may match. */
+    for (; ii < entry->seq; ++ii)
+      if (matches(ci->entries[ii].item, cli, &ip))
+        skipped(cli, ii);
+    if (first < 0)
+      first = entry->seq;
+    ii = entry->seq + 1;
+  }
+  for (; ii < count; ++ii)
+    if (matches(ci->entries[ii].item, cli, &ip))
+      skipped(cli, ii);
+  return first;
+}
+
+/** Check a fixed table of clients against an index. */
+static void do_table_test(const char *what, struct ConfIndex *ci,
+                          unsigned int count, block_match_f matches,
+                          const struct client_test *clients)
+{
+  const struct client_test *cli;
+  int res;
+
+  for (cli = clients; cli->username; ++cli) {
+    res = index_check(ci, count, matches, cli);
+    if (res != cli->first) {
+      fprintf(stderr, "%s@%s [%s] (%s) got %s block %d, expected %d.\n",
+              cli->username, cli->sockhost, cli->ip,
+              cli->realname ? cli->realname : "", what, res, cli->first);
+      assert(0);
+    }
+  }
+  printf("Passed: %u fixed clients against %s blocks\n",
+         (unsigned int)(cli - clients), what);
+}
+
+/** Generate a random client. */
+static void make_client(struct client_test *cli, char *user, char *host,
+                        char *ip, char *realname)
+{
+  unsigned int a = next_rand() % 8, b = next_rand() % 8;
+
+  sprintf(user, "%suser%u", next_rand() % 2 ? "~" : "", next_rand() % 3);
+  sprintf(ip, "10.%u.%u.%u", a, b, next_rand() % 8);
+  if (next_rand() % 3)
+    sprintf(host, "%sh%u.dom%u.NET", next_rand() % 2 ? "x." : "", b, a);
+  else
+    strcpy(host, ip);
+  sprintf(realname, "%s %u", next_rand() % 2 ? "Real" : "bot", next_rand() % 4);
+  cli->username = user;
+  cli->sockhost = host;
+  cli->ip = ip;
+  cli->realname = realname;
+}
+
+/** Check the fixed tables of Client and Kill blocks. */
+static void do_fixed_tests(void)
+{
+  struct ConfIndex ci;
+  unsigned int count;
+
+  memset(&ci, 0, sizeof(ci));
+  for (count = 0; iline_blocks[count].host || iline_blocks[count].ip; ++count) ;
+  iline_index(&ci, iline_blocks, count);
+  do_table_test("Client", &ci, count, iline_matches, iline_clients);
+  conf_index_clear(&ci);
+
+  for (count = 0; kill_blocks[count].hostmask || kill_blocks[count].realmask;
+       ++count) ;
+  kill_index(&ci, kill_blocks, count);
+  do_table_test("Kill", &ci, count, kill_matches, kill_clients);
+  conf_index_clear(&ci);
+}
+
+/** Compare random Client blocks with a scan of the list. */
+static void do_iline_random_test(unsigned int n_blocks, unsigned int n_clients)
+{
+  struct ConfIndex ci;
+  struct iline_test *blocks;
+  struct client_test cli;
+  char buf[64], user[16], host[64], ip[40], realname[16];
+  unsigned int ii, a, b, hits;
+
+  blocks = calloc(n_blocks, sizeof(*blocks));
+  for (ii = 0; ii < n_blocks; ++ii) {
+    a = next_rand() % 8;
+    b = next_rand() % 8;
+    if (next_rand() % 4 == 0)
+      blocks[ii].username = next_rand() % 2 ? "~*" : "user1";
+    switch (next_rand() % 12) {
+    case 0: snprintf(buf, sizeof(buf), "10.%u.0.0/16", a); break;
+    case 1: snprintf(buf, sizeof(buf), "10.%u.%u.0/24", a, b); break;
+    case 2: snprintf(buf, sizeof(buf), "10.%u.%u.%u", a, b, next_rand() % 8); break;
+    case 3: snprintf(buf, sizeof(buf), "*.dom%u.net", a); break;
+    case 4: snprintf(buf, sizeof(buf), "*.h%u.dom%u.net", b, a); break;
+    case 5: snprintf(buf, sizeof(buf), "h%u.dom%u.net", b, a); break;
+    case 6: snprintf(buf, sizeof(buf), "h%u*.dom%u.net", b, a); break;
+    case 7:
+      if (next_rand() % 4 == 0)
+        strcpy(buf, next_rand() % 2 ? "*" : "0.0.0.0/0");
+      else
+        snprintf(buf, sizeof(buf), "*%u.dom%u.*", b, a);
+      break;
+    default: snprintf(buf, sizeof(buf), "h%u.dom%u.org", b, a); break;
+    }
+    if (buf[0] == '1' || buf[0] == '0')
+      blocks[ii].ip = strdup(buf);
+    else
+      blocks[ii].host = strdup(buf);
+  }
+
+  memset(&ci, 0, sizeof(ci));
+  iline_index(&ci, blocks, n_blocks);
+  for (ii = hits = 0; ii < n_clients; ++ii) {
+    make_client(&cli, user, host, ip, realname);
+    hits += index_check(&ci, n_blocks, iline_matches, &cli) >= 0;
+  }
+  conf_index_clear(&ci);
+  printf("Passed: %u Client blocks, %u clients, %u matched\n", n_blocks,
+         n_clients, hits);
+
+  for (ii = 0; ii < n_blocks; ++ii) {
+    free((char *)blocks[ii].host);
+    free((char *)blocks[ii].ip);
+  }
+  free(blocks);
+}
+
+/** Compare random Kill blocks with a scan of the list. */
+static void do_kill_random_test(unsigned int n_blocks, unsigned int n_clients)
+{
+  struct ConfIndex ci;
+  struct kill_test *blocks;
+  struct client_test cli;
+  char buf[64], user[16], host[64], ip[40], realname[16];
+  unsigned int ii, a, b, hits;
+
+  blocks = calloc(n_blocks, sizeof(*blocks));
+  for (ii = 0; ii < n_blocks; ++ii) {
+    a = next_rand() % 8;
+    b = next_rand() % 8;
+    if (next_rand() % 4)
+      blocks[ii].usermask = next_rand() % 4 ? "*" : "~*";
+    switch (next_rand() % 12) {
+    case 0: snprintf(buf, sizeof(buf), "10.%u.0.0/16", a); break;
+    case 1: snprintf(buf, sizeof(buf), "10.%u.%u.0/24", a, b); break;
+    case 2: snprintf(buf, sizeof(buf), "*.dom%u.net", a); break;
+    case 3: snprintf(buf, sizeof(buf), "h%u.dom%u.net", b, a); break;
+    case 4: snprintf(buf, sizeof(buf), "h%u*.dom%u.net", b, a); break;
+    case 5:
+      if (next_rand() % 4 == 0)
+        strcpy(buf, "*");
+      else
+        snprintf(buf, sizeof(buf), "*%u.*", b);
+      break;
+    default: buf[0] = '\0'; break;
+    }
+    if (buf[0])
+      blocks[ii].hostmask = strdup(buf);
+    switch (next_rand() % 8) {
+    case 0: snprintf(buf, sizeof(buf), "Real %u", a % 4); break;
+    case 1: snprintf(buf, sizeof(buf), "BOT %u", a % 4); break;
+    case 2: strcpy(buf, "*bot*"); break;
+    case 3: snprintf(buf, sizeof(buf), "r?al %u", a % 4); break;
+    default: buf[0] = '\0'; break;
+    }
+    if (buf[0])
+      blocks[ii].realmask = strdup(buf);
+    else if (!blocks[ii].hostmask)
+      blocks[ii].realmask = strdup("Nobody");
+  }
+
+  memset(&ci, 0, sizeof(ci));
+  kill_index(&ci, blocks, n_blocks);
+  for (ii = hits = 0; ii < n_clients; ++ii) {
+    make_client(&cli, user, host, ip, realname);
+    hits += index_check(&ci, n_blocks, kill_matches, &cli) >= 0;
+  }
+  conf_index_clear(&ci);
+  printf("Passed: %u Kill blocks, %u clients, %u matched\n", n_blocks,
+         n_clients, hits);
+
+  for (ii = 0; ii < n_blocks; ++ii) {
+    free((char *)blocks[ii].hostmask);
+    free((char *)blocks[ii].realmask);
+  }
+  free(blocks);
+}
+
+int main(void)
+{
+  do_fixed_tests();
+  do_iline_random_test(20, 5000);
+  do_iline_random_test(500, 5000);
+  do_kill_random_test(20, 5000);
+  do_kill_random_test(500, 5000);
+  return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * ircd_intern_t.c - test interned strings
+ *
+ * Checks that equal strings share one copy, that maxlen truncates,
+ * that reference counts free strings after their last release, and
+ * that the table keeps working as it grows.
+ */
+
+#include "ircd_intern.h"
+#include "ircd_log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define N_STRINGS 5000
+
+/** Check that the table holds \a count strings with \a refs references. */
+static void check_counts(size_t count, size_t refs)
+{
+  size_t n_count, n_refs, n_bytes;
+
+  intern_count_memory(&n_count, &n_refs, &n_bytes);
+  if (n_count != count || n_refs != refs) {
+    fprintf(stderr, "Have %u strings and %u references, expected %u and %u.\n",
+            (unsigned int)n_count, (unsigned int)n_refs,
+            (unsigned int)count, (unsigned int)refs);
+    assert(0);
+  }
+}
+
+/** Check sharing, truncation and the empty string. */
+static void do_basic_test(void)
+{
+  const char *a, *b, *c, *field = NULL;
+  char buf[32];
+
+  a = intern_string("users.example.net", 63);
+  strcpy(buf, "users.example.net");
+  b = intern_string(buf, 63);
+  assert(a == b);
+  assert(a != buf);
+  assert(!strcmp(a, "users.example.net"));
+  c = intern_string("Users.example.net", 63);
+  assert(c != a);
+  check_counts(2, 3);
+
+  /* Truncation only looks at the first maxlen characters. */
+  assert(intern_string("users.example.net.extra", 17) == a);
+  intern_release(a);
+  assert(intern_string("abc", 0) == intern_empty);
+  assert(intern_string("", 10) == intern_empty);
+  intern_release(intern_empty);
+  intern_release(NULL);
+  assert(intern_ref(intern_empty) == intern_empty);
+  check_counts(2, 3);
+
+  /* intern_set() keeps the old value alive until the new one is made. */
+  intern_set(&field, "joe", 10);
+  intern_set(&field, field, 2);
+  assert(!strcmp(field, "jo"));
+  check_counts(3, 4);
+  intern_release(field);
+
+  intern_release(intern_ref(c));
+  intern_release(c);
+  intern_release(b);
+  check_counts(1, 1);
+  intern_release(a);
+  check_counts(0, 0);
+  printf("Passed: basic\n");
+}
+
+/** Intern many strings, twice each, to make the table grow. */
+static void do_grow_test(void)
+{
+  static const char *first[N_STRINGS];
+  char buf[32];
+  unsigned int ii;
+
+  for (ii = 0; ii < N_STRINGS; ++ii) {
+    sprintf(buf, "host%u.example.net", ii);
+    first[ii] = intern_string(buf, sizeof(buf));
+  }
+  for (ii = 0; ii < N_STRINGS; ++ii) {
+    sprintf(buf, "host%u.example.net", ii);
+    assert(intern_string(buf, sizeof(buf)) == first[ii]);
+  }
+  check_counts(N_STRINGS, 2 * N_STRINGS);
+  for (ii = 0; ii < N_STRINGS; ++ii) {
+    intern_release(first[ii]);
+    intern_release(first[ii]);
+  }
+  check_counts(0, 0);
+  printf("Passed: %u strings\n", N_STRINGS);
+}
+
+int main(void)
+{
+  do_basic_test();
+  do_grow_test();
+  return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * ircd_maskset_t.c - test and benchmark mask sets against match()
+ *
+ * With no arguments, checks that maskset_first() and maskset_all()
+ * agree with calling match() on each mask in turn, for a fixed table
+ * and for randomly generated ban-style masks, then times both ways of
+ * matching.  "ircd_maskset_t masks strings" runs the comparison and
+ * benchmark with that many masks and strings instead.
+ */
+
+#include "ircd_log.h"
+#include "match.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h> /* gettimeofday() */
+
+struct maskset_test {
+  const char *string;
+  int first;
+};
+
+const char *maskset_masks[] = {
+  "*!*@*.example.com",          /* 0 */
+  "bad*!*@*",                   /* 1 */
+  "*!~*@*",                     /* 2 */
+  "*!*@10.1.2.*",               /* 3 */
+  "*!*@host.example.com",       /* 4 */
+  "*!*\\**@*",                  /* 5 */
+  "?\?\?!*@*",                  /* 6 */
+  "*!*@*.EXAMPLE.net",          /* 7 */
+  NULL
+};
+
+const struct maskset_test maskset_tests[] = {
+  { "joe!joe@host.example.com", 0 },
+  { "joey!joe@host.example.org", -1 },
+  { "BadGuy!x@y.z", 1 },
+  { "joe!~joe@y.z", 2 },
+  { "joe!joe@10.1.2.3", 3 },
+  { "joe!a*b@y.z", 5 },
+  { "abc!abc@y.z", 6 },
+  { "joey!joe@www.example.NET", 7 },
+  { "", -1 },
+  { NULL, 0 }
+};
+
+static unsigned long rand_state = 1;
+
+/** Return a pseudo-random number, the same on every platform. */
+static unsigned int next_rand(void)
+{
+  rand_state = rand_state * 1103515245 + 12345;
+  return (rand_state >> 16) & 0x7fff;
+}
+
+/** Generate a ban-like mask. */
+static void make_mask(char *buf, size_t len)
+{
+  unsigned int dom = next_rand() % 500, host = next_rand() % 50;
+
+  switch (next_rand() % 10) {
+  case 0: snprintf(buf, len, "*!*@host%u.dom%u.net", host, dom); break;
+  case 1: snprintf(buf, len, "*!*user%u@*.dom%u.net", host, dom); break;
+  case 2: snprintf(buf, len, "nick%u*!*@*", dom); break;
+  case 3: snprintf(buf, len, "*!*@10.%u.%u.*", dom % 256, host); break;
+  case 4: snprintf(buf, len, "*!?user%u@*", dom); break;
+  case 5: snprintf(buf, len, "*nick%u!*@*.DOM%u.*", host, dom); break;
+  case 6: snprintf(buf, len, "*!*@*.dom%u.net", dom); break;
+  case 7: snprintf(buf, len, "n?ck%u!*@*", dom); break;
+  case 8: snprintf(buf, len, "*!*@*%u.dom%u.*", host, dom); break;
+  default:
+    if (next_rand() % 20)
+      snprintf(buf, len, "*!*@host%u.dom%u.org", host, dom);
+    else /* A rare mask with no literal characters at all. */
+      snprintf(buf, len, "%.*s*", 36, "????????????????????????????????????????");
+    break;
+  }
+}
+
+/** Generate a nick!user@host string. */
+static void make_string(char *buf, size_t len)
+{
+  unsigned int dom = next_rand() % 600, host = next_rand() % 60;
+
+  if (next_rand() % 4)
+    snprintf(buf, len, "Nick%u!%suser%u@host%u.dom%u.net", next_rand() % 700,
+             next_rand() % 3 ? "" : "~", next_rand() % 600, host, dom);
+  else
+    snprintf(buf, len, "nick%u!user%u@10.%u.%u.%u", next_rand() % 700,
+             next_rand() % 600, dom % 256, host, next_rand() % 256);
+}
+
+/** Return the time in microseconds. */
+static double now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+/** Check the fixed test table. */
+static void do_table_test(void)
+{
+  struct MaskSet *set;
+  const struct maskset_test *test;
+  unsigned int ii;
+  int res;
+
+  set = maskset_create();
+  for (ii = 0; maskset_masks[ii]; ++ii) {
+    res = maskset_add(set, maskset_masks[ii]);
+    assert(res == (int)ii);
+  }
+  assert(maskset_count(set) == ii);
+  for (test = maskset_tests; test->string; ++test) {
+    res = maskset_first(set, test->string);
+    if (res != test->first) {
+      fprintf(stderr, "\"%s\" matched %d, expected %d.\n", test->string,
+              res, test->first);
+      assert(0);
+    }
+  }
+  maskset_free(set);
+  printf("Passed: %u fixed strings\n", (unsigned int)(test - maskset_tests));
+}
+
+/** Compare a random mask set with linear matching, and time both. */
+static void do_random_test(unsigned int n_masks, unsigned int n_strings)
+{
+  struct MaskSet *set;
+  char **masks, **strings, buf[128];
+  unsigned int *found, ii, jj, count, hits;
+  double start, linear, indexed;
+  int first;
+
+  masks = malloc(n_masks * sizeof(*masks));
+  strings = malloc(n_strings * sizeof(*strings));
+  found = malloc(n_masks * sizeof(*found));
+  set = maskset_create();
+  for (ii = 0; ii < n_masks; ++ii) {
+    make_mask(buf, sizeof(buf));
+    masks[ii] = strdup(buf);
+    maskset_add(set, buf);
+  }
+  for (ii = 0; ii < n_strings; ++ii) {
+    make_string(buf, sizeof(buf));
+    strings[ii] = strdup(buf);
+  }
+
+  /* Correctness: both lookups must agree with a linear scan. */
+  for (ii = 0; ii < n_strings; ++ii) {
+    first = maskset_first(set, strings[ii]);
+    count = maskset_all(set, strings[ii], found, n_masks);
+    for (jj = 0; jj < n_masks && match(masks[jj], strings[ii]); ++jj) ;
+    if (first != (jj < n_masks ? (int)jj : -1)) {
+      fprintf(stderr, "\"%s\": first match %d, expected %d.\n", strings[ii],
+              first, jj < n_masks ? (int)jj : -1);
+      assert(0);
+    }
+    for (jj = hits = 0; jj < n_masks; ++jj) {
+      if (match(masks[jj], strings[ii]))
+        continue;
+      if (hits >= count || found[hits] != jj) {
+        fprintf(stderr, "\"%s\": missed mask \"%s\".\n", strings[ii],
+                masks[jj]);
+        assert(0);
+      }
+      hits++;
+    }
+    assert(hits == count);
+  }
+
+  /* Benchmark: time of first-match lookups for every string. */
+  start = now();
+  for (ii = hits = 0; ii < n_strings; ++ii) {
+    for (jj = 0; jj < n_masks && match(masks[jj], strings[ii]); ++jj) ;
+    hits += jj < n_masks;
+  }
+  linear = now() - start;
+  start = now();
+  for (ii = count = 0; ii < n_strings; ++ii)
+    count += maskset_first(set, strings[ii]) >= 0;
+  indexed = now() - start;
+  assert(count == hits);
+
+  printf("Passed: %u masks, %u strings, %u matched\n", n_masks, n_strings,
+         hits);
+  printf("  match() loop: %.3f us/string\n", linear / n_strings);
+  printf("  maskset:      %.3f us/string\n", indexed / n_strings);
+
+  for (ii = 0; ii < n_masks; ++ii)
+    free(masks[ii]);
+  for (ii = 0; ii < n_strings; ++ii)
+    free(strings[ii]);
+  free(masks);
+  free(strings);
+  free(found);
+  maskset_free(set);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc > 2) {
+    do_random_test(strtoul(argv[1], NULL, 10), strtoul(argv[2], NULL, 10));
+    return 0;
+  }
+  do_table_test();
+  do_random_test(10, 2000);
+  do_random_test(1000, 5000);
+  return 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * ircd_target_t.c - test and benchmark recent target lists
+ *
+ * Checks the order kept by recent target lists, checks the free
+ * target rate limit against the older inline code, counts how often
+ * a new target is mistaken for a recent one with the old one-byte
+ * hashes and with target_hash(), then times the target check done
+ * for each PRIVMSG both ways.  Only the recent target lookup made by
+ * check_target_limit() is timed, not the rest of the PRIVMSG path.
+ */
+
+#include "ircd_defs.h"
+#include "ircd_log.h"
+#include "s_user.h"
+#include "target.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h> /* gettimeofday() */
+
+#define N_OBJECTS 100000
+#define N_SENDS 2000000
+
+static unsigned long rand_state = 1;
+
+/** Return a pseudo-random number, the same on every platform. */
+static unsigned int next_rand(void)
+{
+  rand_state = rand_state * 1103515245 + 12345;
+  return (rand_state >> 16) & 0x7fff;
+}
+
+/** Return the time in microseconds. */
+static double now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+/** One-byte target hash, as targets were hashed before. */
+static unsigned char old_hash(unsigned int target)
+{
+  return (unsigned char) (target >> 16) ^ (target >> 8);
+}
+
+/** Target check with one-byte hashes, as check_target_limit() was. */
+static int old_check(unsigned char *targets, unsigned char hash)
+{
+  int i;
+
+  if (targets[0] == hash)
+    return 1;
+  for (i = 1; i < MAXTARGETS; ++i) {
+    if (targets[i] == hash) {
+      memmove(&targets[1], &targets[0], i);
+      targets[0] = hash;
+      return 1;
+    }
+  }
+  memmove(&targets[1], &targets[0], MAXTARGETS - 1);
+  targets[0] = hash;
+  return 0;
+}
+
+/** Free target rate limit, as check_target_limit() had it inline. */
+static enum TargetResult old_use(time_t *next, time_t now)
+{
+  if (now < *next) {
+    if (*next - now < TARGET_DELAY + 8) {
+      *next += 2;
+      return TARGET_TOOFAST;
+    }
+    return TARGET_TOOFAST_QUIET;
+  }
+  *next += TARGET_DELAY;
+  if (*next < now - (TARGET_DELAY * (MAXTARGETS - 1)))
+    *next = now - (TARGET_DELAY * (MAXTARGETS - 1));
+  return TARGET_OK;
+}
+
+/** Check that \a targets starts with the \a count values in \a expect. */
+static void check_list(const unsigned int *targets, const unsigned int *expect,
+                       unsigned int count)
+{
+  unsigned int ii;
+
+  for (ii = 0; ii < count; ++ii) {
+    if (targets[ii] != expect[ii]) {
+      fprintf(stderr, "Target %u is %u, expected %u.\n", ii, targets[ii],
+              expect[ii]);
+      assert(0);
+    }
+  }
+}
+
+/** Check the order of a recent target list. */
+static void do_list_test(void)
+{
+  unsigned int targets[MAXTARGETS], expect[MAXTARGETS], ii;
+
+  memset(targets, 0, sizeof(targets));
+  for (ii = 1; ii <= MAXTARGETS; ++ii) {
+    assert(!target_find(targets, ii));
+    target_push(targets, ii);
+  }
+  for (ii = 0; ii < MAXTARGETS; ++ii)
+    expect[ii] = MAXTARGETS - ii;
+  check_list(targets, expect, MAXTARGETS);
+
+  /* A known target moves to the front; the others keep their order. */
+  assert(target_find(targets, 5));
+  memmove(&expect[1], &expect[0], (MAXTARGETS - 5) * sizeof(*expect));
+  expect[0] = 5;
+  check_list(targets, expect, MAXTARGETS);
+  assert(target_find(targets, 5));
+  check_list(targets, expect, MAXTARGETS);
+
+  /* A new target pushes the oldest one off the end. */
+  target_push(targets, 100);
+  assert(targets[0] == 100 && targets[MAXTARGETS - 1] == 2);
+  assert(!target_find(targets, 1));
+
+  /* Senders go after the reserved targets, unless already present. */
+  target_add_reply(targets, 200);
+  assert(targets[RESERVEDTARGETS] == 200);
+  assert(targets[RESERVEDTARGETS - 1] != 200);
+  memcpy(expect, targets, sizeof(expect));
+  target_add_reply(targets, 100);
+  target_add_reply(targets, 200);
+  check_list(targets, expect, MAXTARGETS);
+  assert(target_find(targets, 200));
+  assert(targets[0] == 200);
+
+  assert(target_hash(expect) == target_hash(expect));
+  assert(target_hash(expect) != target_hash(expect + 1));
+  assert(target_hash(NULL) != 0);
+  printf("Passed: target lists\n");
+}
+
+/** Check the free target rate limit. */
+static void do_rate_test(void)
+{
+  time_t next, old_next, t;
+  unsigned int ii;
+  enum TargetResult res;
+
+  /* New clients start with STARTTARGETS free targets. */
+  t = 1000000;
+  next = t - (TARGET_DELAY * (STARTTARGETS - 1));
+  for (ii = 0; ii < STARTTARGETS; ++ii)
+    assert(target_use(&next, t) == TARGET_OK);
+  /* Then a few warnings, with a small penalty each, then silence. */
+  for (ii = 0; ii < 4; ++ii)
+    assert(target_use(&next, t) == TARGET_TOOFAST);
+  assert(target_use(&next, t) == TARGET_TOOFAST_QUIET);
+  assert(next == t + TARGET_DELAY + 8);
+  assert(target_use(&next, t + TARGET_DELAY + 8) == TARGET_OK);
+
+  /* Random use must give the same results as the old code. */
+  old_next = next;
+  for (ii = 0; ii < 100000; ++ii) {
+    t += next_rand() % 64 ? next_rand() % 8 : next_rand() % 4000;
+    res = target_use(&next, t);
+    assert(res == old_use(&old_next, t));
+    assert(next == old_next);
+  }
+  printf("Passed: free target rate\n");
+}
+
+/** Count new targets mistaken for recent targets. */
+static void do_collision_test(void)
+{
+  void **objects;
+  unsigned char old_targets[MAXTARGETS];
+  unsigned int targets[MAXTARGETS], ii, old_false = 0, new_false = 0;
+
+  objects = malloc(N_OBJECTS * sizeof(*objects));
+  for (ii = 0; ii < N_OBJECTS; ++ii)
+    objects[ii] = malloc(64 + next_rand() % 256);
+  memset(old_targets, 0, sizeof(old_targets));
+  memset(targets, 0, sizeof(targets));
+
+  /* Every object is a new target, so any hit is a false positive. */
+  for (ii = 0; ii < N_OBJECTS; ++ii) {
+    if (old_check(old_targets, old_hash((unsigned long) objects[ii])))
+      old_false++;
+    if (target_find(targets, target_hash(objects[ii])))
+      new_false++;
+    else
+      target_push(targets, target_hash(objects[ii]));
+  }
+  assert(new_false == 0);
+  printf("Passed: %u new targets, %u mistaken with one-byte hashes, %u now\n",
+         N_OBJECTS, old_false, new_false);
+
+  for (ii = 0; ii < N_OBJECTS; ++ii)
+    free(objects[ii]);
+  free(objects);
+}
+
+/** Time the recent target lookup made for each message sent, on its
+ * own: target_hash(), target_find() and target_push() against the old
+ * one-byte hash scan.
+ */
+static void do_bench(unsigned int working_set)
+{
+  void **objects;
+  unsigned int *order;
+  unsigned char old_targets[MAXTARGETS];
+  unsigned int targets[MAXTARGETS], ii, old_hits = 0, new_hits = 0;
+  double start, old_time, new_time;
+
+  objects = malloc(working_set * sizeof(*objects));
+  order = malloc(N_SENDS * sizeof(*order));
+  for (ii = 0; ii < working_set; ++ii)
+    objects[ii] = malloc(200);
+  for (ii = 0; ii < N_SENDS; ++ii)
+    order[ii] = next_rand() % working_set;
+  memset(old_targets, 0, sizeof(old_targets));
+  memset(targets, 0, sizeof(targets));
+
+  start = now();
+  for (ii = 0; ii < N_SENDS; ++ii)
+    old_hits += old_check(old_targets,
+                          old_hash((unsigned long) objects[order[ii]]));
+  old_time = now() - start;
+
+  start = now();
+  for (ii = 0; ii < N_SENDS; ++ii) {
+    unsigned int hash = target_hash(objects[order[ii]]);
+    if (target_find(targets, hash))
+      new_hits++;
+    else
+      target_push(targets, hash);
+  }
+  new_time = now() - start;
+
+  printf("Working set of %u targets: %u/%u recent hits\n", working_set,
+         new_hits, N_SENDS);
+  printf("  one-byte hashes: %.4f us/message (%u hits)\n",
+         old_time / N_SENDS, old_hits);
+  printf("  target_hash():   %.4f us/message\n", new_time / N_SENDS);
+
+  for (ii = 0; ii < working_set; ++ii)
+    free(objects[ii]);
+  free(objects);
+  free(order);
+}
+
+int main(void)
+{
+  do_list_test();
+  do_rate_test();
+  do_collision_test();
+  do_bench(8);
+  do_bench(MAXTARGETS);
+  do_bench(4 * MAXTARGETS);
+  return 0;
+}
@@ -40,6 +40,7 @@
 #include "ircd_alloc.h"
 #include "ircd_chattr.h"
 #include "ircd_features.h"
+#include "ircd_intern.h"
 #include "ircd_log.h"
 #include "ircd_string.h"
 #include "list.h"
@@ -174,16 +175,12 @@ whowas_clean(struct Whowas *ww)
   /* Free old info */
   if (ww->name)
     MyFree(ww->name);
-  if (ww->username)
-    MyFree(ww->username);
-  if (ww->hostname)
-    MyFree(ww->hostname);
-  if (ww->realhost)
-    MyFree(ww->realhost);
+  intern_release(ww->username);
+  intern_release(ww->hostname);
+  intern_release(ww->realhost);
   if (ww->servername)
     MyFree(ww->servername);
-  if (ww->realname)
-    MyFree(ww->realname);
+  intern_release(ww->realname);
   if (ww->away)
     MyFree(ww->away);
 
@@ -268,12 +265,12 @@ void add_history(struct Client *cptr, int still_on)
   ww->hashv = hash_whowas_name(cli_name(cptr)); /* initialize struct */
   ww->logoff = CurrentTime;
   DupString(ww->name, cli_name(cptr));
-  DupString(ww->username, cli_user(cptr)->username);
-  DupString(ww->hostname, cli_user(cptr)->host);
+  ww->username = intern_ref(cli_user(cptr)->username);
+  ww->hostname = intern_ref(cli_user(cptr)->host);
   if (HasHiddenHost(cptr))
-    DupString(ww->realhost, cli_user(cptr)->realhost);
+    ww->realhost = intern_ref(cli_user(cptr)->realhost);
   DupString(ww->servername, cli_name(cli_user(cptr)->server));
-  DupString(ww->realname, cli_info(cptr));
+  ww->realname = intern_ref(cli_info(cptr));
   if (cli_user(cptr)->away)
     DupString(ww->away, cli_user(cptr)->away);
 
@@ -331,8 +328,9 @@ struct Client *get_history(const char *nick)
 
 /** Count memory used by whowas list.
  * @param[out] wwu Number of entries in whowas list.
- * @param[out] wwum Total number of bytes used by nickname, username,
- * hostname and servername fields.
+ * @param[out] wwum Total number of bytes used by nickname and
+ * servername fields.  The other strings are interned and counted
+ * with the rest of the interned strings.
  * @param[out] wwa Number of away strings in whowas list.
  * @param[out] wwam Total number of bytes used by away strings.
  */
@@ -351,8 +349,6 @@ void count_whowas_memory(int *wwu, size_t *wwum, int *wwa, size_t *wwam)
   for (tmp = wwList.ww_list; tmp; tmp = tmp->wnext) {
     u++;
     um += (strlen(tmp->name) + 1);
-    um += (strlen(tmp->username) + 1);
-    um += (strlen(tmp->hostname) + 1);
     um += (strlen(tmp->servername) + 1);
     if (tmp->away) {
       a++;
@@ -0,0 +1,46 @@
+define srv1 localhost:7601
+define srv1-name irc.example.net
+define op-nick Op3rm4n
+
+# Ident lookups beyond IDENT_MAX_PENDING wait in a queue per client
+# host.  Once slots free up, queued lookups from every host must start,
+# not only those from hosts that already had a lookup running.
+#
+# This needs an identd listening on port 113 of 127.0.0.2 through
+# 127.0.0.4 that answers each query after about a second, so that the
+# lookups overlap: start "slow-identd" from this directory as root
+# first.  Clients whose lookups never start only register after the
+# auth timeout, with a ~ in their username.
+connect op %op-nick% oper %srv1% :Some IRC Operator
+:op oper oper oper
+:op raw :SET IDENT_MAX_PENDING 2
+:op raw :SET IDENT_MAX_PER_HOST 0
+:op raw :GET IDENT_MAX_PENDING
+:op expect %srv1-name% 284 %op-nick% :Integer value of IDENT_MAX_PENDING: 2
+sync op
+
+# Two clients from each of three hosts; only two lookups may run.
+connect h0:127.0.0.2 IdQu3u30 idq0 %srv1% :Queued ident
+connect h1:127.0.0.3 IdQu3u31 idq1 %srv1% :Queued ident
+connect h2:127.0.0.4 IdQu3u32 idq2 %srv1% :Queued ident
+connect h3:127.0.0.2 IdQu3u33 idq3 %srv1% :Queued ident
+connect h4:127.0.0.3 IdQu3u34 idq4 %srv1% :Queued ident
+connect h5:127.0.0.4 IdQu3u35 idq5 %srv1% :Queued ident
+:h0 raw :WHOIS IdQu3u30
+:h0 expect %srv1-name% 311 IdQu3u30 IdQu3u30 [^~]
+:h1 raw :WHOIS IdQu3u31
+:h1 expect %srv1-name% 311 IdQu3u31 IdQu3u31 [^~]
+:h2 raw :WHOIS IdQu3u32
+:h2 expect %srv1-name% 311 IdQu3u32 IdQu3u32 [^~]
+:h3 raw :WHOIS IdQu3u33
+:h3 expect %srv1-name% 311 IdQu3u33 IdQu3u33 [^~]
+:h4 raw :WHOIS IdQu3u34
+:h4 expect %srv1-name% 311 IdQu3u34 IdQu3u34 [^~]
+:h5 raw :WHOIS IdQu3u35
+:h5 expect %srv1-name% 311 IdQu3u35 IdQu3u35 [^~]
+:h0,h1,h2,h3,h4,h5 quit done
+
+# Put the defaults back.
+:op raw :SET IDENT_MAX_PENDING 1024
+:op raw :SET IDENT_MAX_PER_HOST 4
+:op quit done
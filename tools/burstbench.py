@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+#
+# burstbench.py - time how long an ircd takes to process a net burst
+#
+# Links to a running ircd as a fake P10 server, sends it a synthetic
+# burst of USERS users (N) and CHANNELS channels (B), and reports the
+# wall-clock time (and, given --pid, the CPU time of the ircd process)
+# from the start of the burst until the ircd acknowledges its end (EA).
+# The burst is generated from a fixed seed, so runs are repeatable:
+# most channels have 2-5 members, some 5-45 and 1% 100-1000, a quarter
+# of them carry up to 40 bans, and members get mixed +o/+v.
+#
+# The ircd must be a hub with a Connect block for the fake server, for
+# example (the Connect port is only used for outgoing connects):
+#
+#   Connect {
+#     name = "bench.example.net";
+#     host = "127.0.0.1";
+#     password = "bench";
+#     port = 4400;
+#     class = "Server";
+#     autoconnect = no;
+#     hub = "*";
+#   };
+#   features { "HUB" = "TRUE"; };
+#
+# and a server Port the script can connect to, such as
+#
+#   Port { server = yes; port = 4400; };
+#
+# Then run, e.g.:
+#
+#   tools/burstbench.py --pid `cat ircd.pid` 127.0.0.1 4400
+#
+# --save FILE also writes the burst to FILE for inspection.
+
+import argparse, os, re, socket, sys, time
+
+B64 = 'ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789[]'
+
+def numnick(i):
+    """Return the three-character P10 numeric for user number i."""
+    return B64[(i >> 12) & 63] + B64[(i >> 6) & 63] + B64[i & 63]
+
+class Rand:
+    """Small LCG, so every run produces the same burst."""
+    def __init__(self, seed=12345):
+        self.r = seed
+    def __call__(self, n):
+        self.r = (self.r * 1103515245 + 12345) & 0x7fffffff
+        return (self.r >> 8) % n
+
+def make_burst(srv, nusers, nchans, ts):
+    """Return the burst as a list of lines from server numeric srv."""
+    rnd = Rand()
+    out = []
+    for i in range(nusers):
+        out.append('%s N u%d 1 %d user%d host%d.example.org +i AAAAAA %s%s :bench user'
+                   % (srv, i, ts, i, i, srv, numnick(i)))
+    for c in range(nchans):
+        x = rnd(1000)
+        k = 2 + rnd(4) if x < 800 else 5 + rnd(40) if x < 990 else 100 + rnd(900)
+        base = rnd(nusers)
+        members = sorted(set((base + rnd(max(nusers // 10, 1))) % nusers
+                             for _ in range(k)))
+        groups = [[], [], [], []]
+        for i in members:
+            groups[[0, 0, 0, 1, 2, 3][rnd(6)]].append(i)
+        parts = []
+        for g, group in enumerate(groups):
+            for j, i in enumerate(group):
+                s = srv + numnick(i)
+                if j == 0 and g:
+                    s += ':' + ['', 'v', 'o', 'vo'][g]
+                parts.append(s)
+        nbans = rnd(40) if c % 4 == 0 else 0
+        bans = ['*!*@bad%d.host%d.example.com' % (rnd(100), b)
+                for b in range(nbans)]
+        modes = '+ntk key%d' % c if c % 7 == 0 else '+nt'
+        cur = '%s B #c%d %d %s' % (srv, c, ts - rnd(100000), modes)
+        sep = ' '
+        for p in parts:
+            if len(cur) + len(p) + 1 > 500:
+                out.append(cur)
+                cur = '%s B #c%d %d' % (srv, c, ts)
+                sep = ' '
+            cur += sep + p
+            sep = ','
+        sep = ' :%'
+        for b in bans:
+            if len(cur) + len(b) + 3 > 500:
+                out.append(cur)
+                cur = '%s B #c%d %d' % (srv, c, ts)
+                sep = ' :%'
+            cur += sep + b
+            sep = ' '
+        out.append(cur)
+    out.append('%s EB' % srv)
+    return out
+
+def cpu_time(pid):
+    """Return user plus system CPU seconds used by pid, or None."""
+    if not pid:
+        return None
+    fields = open('/proc/%d/stat' % pid).read().rsplit(')', 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf('SC_CLK_TCK')
+
+def main():
+    ap = argparse.ArgumentParser(description='Time net burst processing.')
+    ap.add_argument('host')
+    ap.add_argument('port', type=int)
+    ap.add_argument('--users', type=int, default=100000)
+    ap.add_argument('--channels', type=int, default=50000)
+    ap.add_argument('--name', default='bench.example.net')
+    ap.add_argument('--password', default='bench')
+    ap.add_argument('--numeric', default='AD')
+    ap.add_argument('--pid', type=int, help='ircd process to measure CPU of')
+    ap.add_argument('--save', help='also write the burst to this file')
+    args = ap.parse_args()
+
+    now = int(time.time())
+    lines = make_burst(args.numeric, args.users, args.channels, now - 1000)
+    data = ('\r\n'.join(lines) + '\r\n').encode()
+    if args.save:
+        open(args.save, 'w').write('\n'.join(lines) + '\n')
+
+    sock = socket.create_connection((args.host, args.port))
+    sock.settimeout(120)
+    sock.sendall(('PASS :%s\r\nSERVER %s 1 %d %d J10 %s]]] +h6 :burstbench\r\n'
+                  % (args.password, args.name, now, now, args.numeric)).encode())
+    # Wait for the ircd's own burst to finish before sending ours.
+    buf = b''
+    while not re.search(rb'(^|\n)\S+ EB\s', buf):
+        d = sock.recv(1 << 20)
+        if not d:
+            sys.exit('ircd closed the link: %r' % buf[-300:])
+        buf += d
+    sock.sendall(('%s EA\r\n' % args.numeric).encode())
+
+    cpu0 = cpu_time(args.pid)
+    t0 = time.time()
+    sock.sendall(data)
+    buf = b''
+    while True:
+        d = sock.recv(1 << 20)
+        if not d:
+            sys.exit('ircd closed the link during the burst: %r' % buf[-300:])
+        buf += d
+        # Answer pings so a slow burst is not mistaken for a dead link.
+        for m in re.finditer(rb'(?:^|\n)\S+ G ([^\r\n]*)\r?\n', buf):
+            sock.sendall(b'%s Z %s\r\n' % (args.numeric.encode(), m.group(1)))
+        if re.search(rb'(^|\n)\S+ EA\s', buf):
+            break
+        buf = buf[buf.rfind(b'\n') + 1:]
+    wall = time.time() - t0
+    cpu1 = cpu_time(args.pid)
+
+    print('%d users, %d channels, %d lines, %d bytes'
+          % (args.users, args.channels, len(lines), len(data)))
+    if cpu0 is None:
+        print('burst processed: wall %.2fs' % wall)
+    else:
+        print('burst processed: wall %.2fs, cpu %.2fs' % (wall, cpu1 - cpu0))
+    sock.close()
+
+if __name__ == '__main__':
+    main()
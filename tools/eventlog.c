@@ -0,0 +1,171 @@
+/*
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+/*
+ * This program reads the binary connection event log written by the
+ * server when the EVENTLOG feature is set, and prints it as text or
+ * as CSV for loading into a spreadsheet or database.  It is not built
+ * by default; compile it with something like:
+ *
+ *	cc -I../include -o eventlog eventlog.c
+ *
+ * Usage is "eventlog [-c] [-H] file...".  Each file is read in turn
+ * (rotated files have the time of rotation appended to their names).
+ * By default one line is printed per record, with the fields
+ * separated by spaces:
+ *
+ *	time type flags ip port numeric class duration sent received
+ *
+ * where time is a Unix timestamp, type is one of "connect",
+ * "register" or "exit", flags is "user", "server" or "-", and an
+ * empty numeric or class is printed as "-".  With -c the same fields
+ * are printed as comma separated values, and -H adds a line naming
+ * the columns.  Files written on a machine with a different byte
+ * order are rejected.
+ */
+#include "eventlog.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+/** Names for each EventLogType. */
+static const char *types[] = { "unknown", "connect", "register", "exit" };
+
+/** Format a stored address as text.
+ * @param[in] ip Address from an EventLogRecord.
+ * @param[out] buf Output buffer.
+ * @param[in] len Length of \a buf.
+ */
+static void
+format_ip(const unsigned char *ip, char *buf, size_t len)
+{
+  static const unsigned char zero[10];
+
+  /* IPv4 addresses are stored mapped or compatible, as the server does */
+  if (!memcmp(ip, zero, sizeof(zero))
+      && ((ip[10] == 0xff && ip[11] == 0xff)
+          || (!ip[10] && !ip[11] && (ip[12] || ip[13]))))
+    inet_ntop(AF_INET, ip + 12, buf, len);
+  else
+    inet_ntop(AF_INET6, ip, buf, len);
+}
+
+/** Print the records in one event log file.
+ * @param[in] name File name.
+ * @param[in] csv Non-zero to print comma separated values.
+ * @return Zero on success, non-zero on error.
+ */
+static int
+dump_file(const char *name, int csv)
+{
+  struct EventLogHeader hdr;
+  struct EventLogRecord er;
+  char ip[64];
+  const char *flags;
+  const char *sep = csv ? "," : " ";
+  unsigned int i;
+  FILE *fp;
+
+  if (!(fp = fopen(name, "rb"))) {
+    fprintf(stderr, "%s: %s\n", name, strerror(errno));
+    return 1;
+  }
+
+  if (fread(&hdr, sizeof(hdr), 1, fp) != 1
+      || memcmp(hdr.eh_magic, EVENTLOG_MAGIC, sizeof(hdr.eh_magic))) {
+    fprintf(stderr, "%s: not an event log\n", name);
+    fclose(fp);
+    return 1;
+  }
+  if (hdr.eh_byteorder != EVENTLOG_BYTEORDER) {
+    fprintf(stderr, "%s: written with a different byte order\n", name);
+    fclose(fp);
+    return 1;
+  }
+  if (hdr.eh_recsize != sizeof(er)) {
+    fprintf(stderr, "%s: record size %u, expected %u\n", name,
+            hdr.eh_recsize, (unsigned int)sizeof(er));
+    fclose(fp);
+    return 1;
+  }
+
+  for (i = 0; i < hdr.eh_count; i++) {
+    if (fread(&er, sizeof(er), 1, fp) != 1) {
+      fprintf(stderr, "%s: truncated after %u of %u records\n", name, i,
+              hdr.eh_count);
+      fclose(fp);
+      return 1;
+    }
+    er.er_numeric[sizeof(er.er_numeric) - 1] = '\0';
+    er.er_class[sizeof(er.er_class) - 1] = '\0';
+
+    format_ip(er.er_ip, ip, sizeof(ip));
+    if (er.er_flags & EVENTLOG_F_USER)
+      flags = "user";
+    else if (er.er_flags & EVENTLOG_F_SERVER)
+      flags = "server";
+    else
+      flags = csv ? "" : "-";
+
+    printf("%llu%s%s%s%s%s%s%s%u%s%s%s%s%s%lu%s%llu%s%llu\n",
+           (unsigned long long)er.er_time, sep,
+           er.er_type <= EVENTLOG_EXIT ? types[er.er_type] : types[0], sep,
+           flags, sep, ip, sep, er.er_port, sep,
+           *er.er_numeric || csv ? er.er_numeric : "-", sep,
+           *er.er_class || csv ? er.er_class : "-", sep,
+           (unsigned long)er.er_duration, sep,
+           (unsigned long long)er.er_sendB, sep,
+           (unsigned long long)er.er_receiveB);
+  }
+
+  fclose(fp);
+  return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  int csv = 0, header = 0, status = 0;
+  int i;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (!strcmp(argv[i], "-c"))
+      csv = 1;
+    else if (!strcmp(argv[i], "-H"))
+      header = 1;
+    else {
+      fprintf(stderr, "Usage: %s [-c] [-H] file...\n", argv[0]);
+      return 2;
+    }
+  }
+  if (i >= argc) {
+    fprintf(stderr, "Usage: %s [-c] [-H] file...\n", argv[0]);
+    return 2;
+  }
+
+  if (header)
+    printf(csv ? "time,type,flags,ip,port,numeric,class,duration,sent,"
+           "received\n" : "time type flags ip port numeric class duration "
+           "sent received\n");
+
+  for (; i < argc; i++)
+    status |= dump_file(argv[i], csv);
+
+  return status;
+}